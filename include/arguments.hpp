@@ -9,6 +9,14 @@
 #define ARGS_DEFAULT_K 64
 #endif
 
+#ifndef ARGS_DEFAULT_K_MIN
+#define ARGS_DEFAULT_K_MIN 16
+#endif
+
+#ifndef ARGS_DEFAULT_K_MAX
+#define ARGS_DEFAULT_K_MAX 256
+#endif
+
 #ifndef ARGS_DEFAULT_CPU_NTHREADS
 #define ARGS_DEFAULT_CPU_NTHREADS 0
 #endif
@@ -29,10 +37,66 @@
 #define ARGS_DEFAULT_USE_RECOMPUTE false
 #endif
 
+#ifndef ARGS_DEFAULT_USE_ADAPTIVE_K
+#define ARGS_DEFAULT_USE_ADAPTIVE_K false
+#endif
+
+#ifndef ARGS_DEFAULT_USE_RADIUS_RECOMPUTE
+#define ARGS_DEFAULT_USE_RADIUS_RECOMPUTE false
+#endif
+
+#ifndef ARGS_DEFAULT_USE_KNN_STREAM
+#define ARGS_DEFAULT_USE_KNN_STREAM false
+#endif
+
+#ifndef ARGS_DEFAULT_USE_PRECISION_RETRY
+#define ARGS_DEFAULT_USE_PRECISION_RETRY false
+#endif
+
+#ifndef ARGS_DEFAULT_USE_RECENTERING
+#define ARGS_DEFAULT_USE_RECENTERING false
+#endif
+
+#ifndef ARGS_DEFAULT_USE_PERTURBATION
+#define ARGS_DEFAULT_USE_PERTURBATION false
+#endif
+
+#ifndef ARGS_DEFAULT_USE_DUPLICATE_CHECK
+#define ARGS_DEFAULT_USE_DUPLICATE_CHECK false
+#endif
+
+#ifndef ARGS_DEFAULT_USE_DUPLICATE_MERGE
+#define ARGS_DEFAULT_USE_DUPLICATE_MERGE false
+#endif
+
+#ifndef ARGS_DEFAULT_DUPLICATE_TOLERANCE
+#define ARGS_DEFAULT_DUPLICATE_TOLERANCE 0.00
+#endif
+
+#ifndef ARGS_DEFAULT_USE_PERIODIC
+#define ARGS_DEFAULT_USE_PERIODIC false
+#endif
+
 #ifndef ARGS_DEFAULT_GRID_RESOLUTION
 #define ARGS_DEFAULT_GRID_RESOLUTION 16
 #endif
 
+#ifndef ARGS_DEFAULT_BOX_MIN
+#define ARGS_DEFAULT_BOX_MIN 0.00
+#endif
+
+#ifndef ARGS_DEFAULT_BOX_MAX
+#define ARGS_DEFAULT_BOX_MAX 1.00
+#endif
+
+#ifndef ARGS_DEFAULT_MAX_RADIUS
+#define ARGS_DEFAULT_MAX_RADIUS 0.00
+#endif
+
+#ifndef ARGS_DEFAULT_WALLS
+#define ARGS_DEFAULT_WALLS ""
+#endif
+
 #ifndef ARGS_DEFAULT_P_MAXSIZE
 #define ARGS_DEFAULT_P_MAXSIZE 32
 #endif
@@ -41,38 +105,205 @@
 #define ARGS_DEFAULT_T_MAXSIZE 32
 #endif
 
+#ifndef ARGS_DEFAULT_MIN_FACE_AREA
+#define ARGS_DEFAULT_MIN_FACE_AREA 0.00
+#endif
+
+#ifndef ARGS_DEFAULT_MESH_OUTFILE
+#define ARGS_DEFAULT_MESH_OUTFILE ""
+#endif
+
 #include <string>
 #include <unordered_map>
 #include <sstream>
 #include <stdexcept>
+#include <type_traits>
+#include <limits>
+#include <algorithm>
+#include <cmath>
 
 #include <initializer_list>
+#include <vector>
+#include <array>
 
 namespace args {
 
+// Axis-aligned box [lo, hi] that holds the points, and the resolution of the
+// grid over it along each axis. The grid has 'gr0' cells along the longest
+// axis, and along the others as many as keeps its cells closest to cubes.
+
+struct box {
+  double lo[3];
+  double hi[3];
+  int gr[3];
+
+  explicit box(const int gr0) 
+    : lo{0.00, 0.00, 0.00}, hi{1.00, 1.00, 1.00}, gr{gr0, gr0, gr0} {}
+
+  box(const double xmin, const double xmax,
+      const double ymin, const double ymax,
+      const double zmin, const double zmax,
+      const int gr0)
+    : lo{xmin, ymin, zmin}, hi{xmax, ymax, zmax}, gr{gr0, gr0, gr0} {
+    const double l = std::max({length(0), length(1), length(2)});
+    for (int c = 0; c < 3; c++) {
+      gr[c] = std::max(1, static_cast<int>(std::lround(gr0 * length(c) / l)));
+    }
+  }
+
+  double length(const int c) const { return hi[c] - lo[c]; }
+  double cell(const int c) const { return length(c) / gr[c]; }
+  int size(void) const { return gr[0] * gr[1] * gr[2]; }
+};
+
 struct xyzset {
   int grid_resolution;
-  xyzset(const int gr0) : grid_resolution(gr0) {}
+  struct box box;
+  xyzset(const int gr0) : grid_resolution(gr0), box(gr0) {}
+  xyzset(const struct box& box0, const int gr0) 
+    : grid_resolution(gr0), box(box0) {}
 };
 
+// 'periodic' wraps the box around on itself in every direction. A positive
+// 'max_radius' leaves out the points too far to reach a cell bounded as in
+// args::cc.
+
 struct knn {
   int k;
   int grid_resolution;
-  knn(const int k0, const int gr0) : k(k0), grid_resolution(gr0) {}
+  bool periodic;
+  struct box box;
+  double max_radius;
+  knn(const int k0, const int gr0, const bool pbc0 = false) 
+    : k(k0), grid_resolution(gr0), periodic(pbc0), box(gr0), 
+      max_radius(0.00) {}
+  knn(const int k0, const struct box& box0, const int gr0, 
+      const bool pbc0 = false, const double mr0 = 0.00) 
+    : k(k0), grid_resolution(gr0), periodic(pbc0), box(box0), 
+      max_radius(mr0) {}
 };
 
+// 'walls' are half-spaces (a, b, c, d) holding the points x with
+// a * x + b * y + c * z + d >= 0. Every cell starts from the box cut by all of
+// them, so that the tessellation fills their intersection. They are kept in
+// a fixed array so that the struct can be copied to the device as is.
+// A positive 'max_radius' also bounds each cell by the cube of that half side
+// around its point. With 'flag_uncertain' set, cells whose clipping hinged on
+// an orientation test too close to call are flagged with
+// cc::uncertain_orientation, to be rerun in higher precision. With
+// 'recenter' set, each cell is clipped in coordinates relative to its point.
+// With 'perturb' set, orientation tests too close to call are decided by a
+// symbolic perturbation of the points, derived from their indices, so that
+// every cell breaks a tie the same way.
+
 struct cc {
+  static constexpr int walls_maxsize = 32;
   int k;
   int p_maxsize;
   int t_maxsize;
-  cc(const int k0, const int pms0, const int tms0) 
-    : k(k0), p_maxsize(pms0), t_maxsize(tms0) {}
+  double min_face_area;
+  bool periodic;
+  struct box box;
+  int nwalls;
+  double walls[4 * walls_maxsize];
+  double max_radius;
+  bool flag_uncertain;
+  bool recenter;
+  bool perturb;
+  cc(const int k0, const int pms0, const int tms0, const double mfa0 = 0.00,
+     const bool pbc0 = false, const struct box& box0 = args::box(1),
+     const std::vector<std::array<double,4>>& walls0 = {},
+     const double mr0 = 0.00, const bool fu0 = false, 
+     const bool rc0 = false, const bool pt0 = false) 
+    : k(k0), p_maxsize(pms0), t_maxsize(tms0), min_face_area(mfa0),
+      periodic(pbc0), box(box0), nwalls(walls0.size()), walls{},
+      max_radius(mr0), flag_uncertain(fu0), recenter(rc0),
+      perturb(pt0) {
+    if (walls0.size() > walls_maxsize) {
+      throw std::invalid_argument("at most " + std::to_string(walls_maxsize) + 
+                                  " walls are supported");
+    }
+    if (pbc0 && !walls0.empty()) {
+      throw std::invalid_argument("walls cannot be used with periodicity");
+    }
+    for (int j = 0; j < nwalls; j++) {
+      std::copy(walls0[j].begin(), walls0[j].end(), walls + 4 * j);
+    }
+  }
+};
+
+// args::box, args::knn and args::cc as the SYCL kernels see them, with every
+// length made Tf on the host, so that the kernels run in Tf alone and float
+// ones do not need double support on the device.
+
+template <typename Tf>
+struct device_box {
+  Tf lo[3];
+  Tf hi[3];
+  Tf len[3];
+  Tf gl[3];
+  int gr[3];
+  explicit device_box(const struct box& box0) {
+    for (int c = 0; c < 3; c++) {
+      lo[c] = static_cast<Tf>(box0.lo[c]);
+      hi[c] = static_cast<Tf>(box0.hi[c]);
+      len[c] = static_cast<Tf>(box0.length(c));
+      gl[c] = static_cast<Tf>(box0.cell(c));
+      gr[c] = box0.gr[c];
+    }
+  }
+  Tf length(const int c) const { return len[c]; }
+  Tf cell(const int c) const { return gl[c]; }
+  int size(void) const { return gr[0] * gr[1] * gr[2]; }
+};
+
+template <typename Tf>
+struct device_knn {
+  int k;
+  int grid_resolution;
+  bool periodic;
+  struct device_box<Tf> box;
+  Tf max_radius;
+  explicit device_knn(const struct knn& args0)
+    : k(args0.k), grid_resolution(args0.grid_resolution),
+      periodic(args0.periodic), box(args0.box),
+      max_radius(static_cast<Tf>(args0.max_radius)) {}
+};
+
+template <typename Tf>
+struct device_cc {
+  int k;
+  int p_maxsize;
+  int t_maxsize;
+  Tf min_face_area;
+  bool periodic;
+  struct device_box<Tf> box;
+  int nwalls;
+  Tf walls[4 * cc::walls_maxsize];
+  Tf max_radius;
+  bool flag_uncertain;
+  bool recenter;
+  bool perturb;
+  explicit device_cc(const struct cc& args0)
+    : k(args0.k), p_maxsize(args0.p_maxsize), t_maxsize(args0.t_maxsize),
+      min_face_area(static_cast<Tf>(args0.min_face_area)),
+      periodic(args0.periodic), box(args0.box), nwalls(args0.nwalls),
+      walls{}, max_radius(static_cast<Tf>(args0.max_radius)),
+      flag_uncertain(args0.flag_uncertain), recenter(args0.recenter),
+      perturb(args0.perturb) {
+    for (int j = 0; j < 4 * nwalls; j++) {
+      walls[j] = static_cast<Tf>(args0.walls[j]);
+    }
+  }
 };
 
 } // namespace args
 
 namespace votess {
 
+// Half-spaces as (a, b, c, d), as in args::cc::walls. 
+using planes_t = std::vector<std::array<double,4>>;
+
 class vtargref {
   private:
     std::string str;
@@ -80,19 +311,56 @@ class vtargref {
     template <typename T>
     std::string to_str(const T v) const {
       std::ostringstream oss;
-      oss << v;
+      // planes are written as 4 numbers each, separated by spaces
+      if constexpr (std::is_same<T, planes_t>::value) {
+        for (const auto& plane : v) {
+          for (const double c : plane) oss << to_str(c) << " ";
+        }
+        return oss.str();
+      } else {
+        oss << v;
+      }
+      // floating point values are written with as few digits as read back
+      // the same, so that box coordinates are not rounded
+      if constexpr (std::is_floating_point<T>::value) {
+        for (int p = 7; from_str<T>(oss.str()) != v && 
+                        p <= std::numeric_limits<T>::max_digits10; p++) {
+          oss.str("");
+          oss.precision(p);
+          oss << v;
+        }
+      }
       return oss.str();
     }
 
     template <typename T>
     T from_str(const std::string& s) const {
-      std::istringstream iss(s); 
-      T v;
-      iss >> v;
-      if (iss.fail()) {
-        throw std::invalid_argument("Invalid type conversion");
+      // strings are taken whole, spaces and all, and may be empty
+      if constexpr (std::is_same<T, std::string>::value) {
+        return s;
+      } else if constexpr (std::is_same<T, planes_t>::value) {
+        // commas are read as spaces
+        std::string t = s;
+        std::replace(t.begin(), t.end(), ',', ' ');
+        std::istringstream iss(t);
+        std::vector<double> c;
+        double x;
+        while (iss >> x) c.push_back(x);
+        if (!iss.eof() || c.size() % 4 != 0) {
+          throw std::invalid_argument("Invalid type conversion");
+        }
+        T v(c.size() / 4);
+        for (size_t j = 0; j < c.size(); j++) v[j / 4][j % 4] = c[j];
+        return v;
+      } else {
+        std::istringstream iss(s); 
+        T v;
+        iss >> v;
+        if (iss.fail()) {
+          throw std::invalid_argument("Invalid type conversion");
+        }
+        return v;
       }
-      return v;
     }
   
   public:
@@ -121,6 +389,8 @@ class vtargs {
 
     void init(void) {
       map["k"] = ARGS_DEFAULT_K;
+      map["k_min"] = ARGS_DEFAULT_K_MIN;
+      map["k_max"] = ARGS_DEFAULT_K_MAX;
 
       map["cpu_nthreads"] = ARGS_DEFAULT_CPU_NTHREADS;
       map["gpu_ndsize"] = ARGS_DEFAULT_GPU_NDWORKSIZE;
@@ -129,11 +399,34 @@ class vtargs {
 
       map["use_chunking"] = ARGS_DEFAULT_USE_CHUNKING;
       map["use_recompute"] = ARGS_DEFAULT_USE_RECOMPUTE;
+      map["use_adaptive_k"] = ARGS_DEFAULT_USE_ADAPTIVE_K;
+      map["use_radius_recompute"] = ARGS_DEFAULT_USE_RADIUS_RECOMPUTE;
+      map["use_knn_stream"] = ARGS_DEFAULT_USE_KNN_STREAM;
+      map["use_precision_retry"] = ARGS_DEFAULT_USE_PRECISION_RETRY;
+      map["use_recentering"] = ARGS_DEFAULT_USE_RECENTERING;
+      map["use_perturbation"] = ARGS_DEFAULT_USE_PERTURBATION;
+      map["use_duplicate_check"] = ARGS_DEFAULT_USE_DUPLICATE_CHECK;
+      map["use_duplicate_merge"] = ARGS_DEFAULT_USE_DUPLICATE_MERGE;
+      map["duplicate_tolerance"] = ARGS_DEFAULT_DUPLICATE_TOLERANCE;
+      map["use_periodic"] = ARGS_DEFAULT_USE_PERIODIC;
 
       map["knn_grid_resolution"] = ARGS_DEFAULT_GRID_RESOLUTION;
 
+      map["box_xmin"] = ARGS_DEFAULT_BOX_MIN;
+      map["box_xmax"] = ARGS_DEFAULT_BOX_MAX;
+      map["box_ymin"] = ARGS_DEFAULT_BOX_MIN;
+      map["box_ymax"] = ARGS_DEFAULT_BOX_MAX;
+      map["box_zmin"] = ARGS_DEFAULT_BOX_MIN;
+      map["box_zmax"] = ARGS_DEFAULT_BOX_MAX;
+
+      map["max_radius"] = ARGS_DEFAULT_MAX_RADIUS;
+      map["walls"] = ARGS_DEFAULT_WALLS;
+
       map["cc_p_maxsize"] = ARGS_DEFAULT_P_MAXSIZE;
       map["cc_t_maxsize"] = ARGS_DEFAULT_T_MAXSIZE;
+      map["cc_min_face_area"] = ARGS_DEFAULT_MIN_FACE_AREA;
+
+      map["mesh_outfile"] = ARGS_DEFAULT_MESH_OUTFILE;
 
       map["dev_suppress_stdout"] = true;
 
@@ -165,22 +458,44 @@ class vtargs {
     return it->second;
   }
 
+    const struct args::box get_box(void) const {
+      int gr = (*this)["knn_grid_resolution"];
+      double xmin = (*this)["box_xmin"];
+      double xmax = (*this)["box_xmax"];
+      double ymin = (*this)["box_ymin"];
+      double ymax = (*this)["box_ymax"];
+      double zmin = (*this)["box_zmin"];
+      double zmax = (*this)["box_zmax"];
+      return args::box(xmin, xmax, ymin, ymax, zmin, zmax, gr);
+    }
+
     const struct args::xyzset get_xyzset(void) const {
       int gr = (*this)["knn_grid_resolution"];
-      return args::xyzset(gr);
+      return args::xyzset(get_box(), gr);
     }
 
     const struct args::knn get_knn(void) const {
       int gr = (*this)["knn_grid_resolution"];
       int k = (*this)["k"];
-      return args::knn(k, gr);
+      bool periodic = (*this)["use_periodic"];
+      double max_radius = (*this)["max_radius"];
+      return args::knn(k, get_box(), gr, periodic, max_radius);
     }
 
     const struct args::cc get_cc(void) const {
       int k = (*this)["k"];
       int p_maxsize = (*this)["cc_p_maxsize"];
       int t_maxsize = (*this)["cc_t_maxsize"];
-      return args::cc(k, p_maxsize, t_maxsize);
+      double min_face_area = (*this)["cc_min_face_area"];
+      bool periodic = (*this)["use_periodic"];
+      planes_t walls = (*this)["walls"];
+      double max_radius = (*this)["max_radius"];
+      bool flag_uncertain = (*this)["use_precision_retry"];
+      bool recenter = (*this)["use_recentering"];
+      bool perturb = (*this)["use_perturbation"];
+      return args::cc(k, p_maxsize, t_maxsize, min_face_area, periodic,
+                      get_box(), walls, max_radius, flag_uncertain, recenter,
+                      perturb);
     }
 
 };
@@ -28,9 +28,27 @@ struct vstatus {
 enum bstatus : unsigned char {
   success,
   unreachable,
+  overflow,
   undefined = 0xff
 };
 
+// Marks a plane that is not on the cycle. It must never be a valid plane
+// index, so each plane index type gets the largest value it can hold.
+template <typename Tu>
+inline constexpr Tu sentinel(void) {
+  return bstatus::undefined;
+}
+
+template <>
+inline constexpr uint16_t sentinel<uint16_t>(void) {
+  return 0xffff;
+}
+
+// Slots of the directed edge table used by extract(). It is kept at most half
+// full, so a removed region can have up to table_size / 6 triangles.
+inline constexpr int table_bits = 8;
+inline constexpr int table_size = 1 << table_bits;
+
 /* ------------------------------------------------------------------------- */
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -44,11 +62,11 @@ enum bstatus : unsigned char {
 template<typename Ti, typename Tu>
 inline bstatus compute(
   Tu* cycle, 
-  const Ti dr_offs,
+  const size_t dr_offs,
   const Ti dr_size,
   short int& head,
   Tu* R,
-  const Ti r_offs,
+  const size_t r_offs,
   const Ti r_size
 );
 
@@ -59,14 +77,60 @@ inline bstatus compute(
 template<typename Ti, typename Tu>
 inline bstatus compute(
   const sycl::local_accessor<Tu, 1>& cycle,
-  const Ti dr_offs,
+  const size_t dr_offs,
   const Ti dr_size,
   short int& head,
   const device_accessor_readwrite_t<Tu>& R, 
-  const Ti r_offs,
+  const size_t r_offs,
   const Ti r_size
 );
 
+///////////////////////////////////////////////////////////////////////////////
+/// Extract Boundary function 
+///////////////////////////////////////////////////////////////////////////////
+
+// Same output as compute(), i.e. cycle[a] = b for every edge (a, b) of the
+// boundary of the r_size triangles in R, with 'head' on the cycle. The
+// directed edges of the triangles are cancelled against their reverse in an
+// open addressing table, so this is linear in r_size and R is left as is.
+//
+// 'cycle' and 'table' (2 * table_size entries) must be all sentinel on entry.
+// The table is left that way, and so is the cycle on failure, so the caller
+// only has to reset the cycle entries of the boundary it walks. Returns
+// bstatus::overflow if the region is too large for the table.
+
+/* ------------------------------------------------------------------------- */
+/// CPU Implementation
+/* ------------------------------------------------------------------------- */
+
+template<typename Ti, typename Tu>
+inline bstatus extract(
+  Tu* cycle,
+  const size_t dr_offs,
+  short int& head,
+  const Tu* R,
+  const size_t r_offs,
+  const Ti r_size,
+  Tu* table,
+  const size_t tb_offs
+);
+
+/* ------------------------------------------------------------------------- */
+/// SYCL implementation
+/* ------------------------------------------------------------------------- */
+
+template<typename Ti, typename Tu>
+inline bstatus extract(
+  const sycl::local_accessor<Tu, 1>& cycle,
+  const size_t dr_offs,
+  short int& head,
+  const device_accessor_readwrite_t<Tu>& R, 
+  const size_t r_offs,
+  const Ti r_size,
+  const sycl::local_accessor<Tu, 1>& table,
+  const size_t tb_offs
+);
+
 ///////////////////////////////////////////////////////////////////////////////
 /// End
 ///////////////////////////////////////////////////////////////////////////////
@@ -8,11 +8,120 @@
 #include <planes.hpp>
 #include <sradius.hpp>
 #include <boundary.hpp>
+#include <knn.hpp>
 
 #include <libsycl.hpp>
 
 namespace cci {
 
+///////////////////////////////////////////////////////////////////////////////
+/// Snapshot
+///////////////////////////////////////////////////////////////////////////////
+
+// Clipped state of the cells that ran out of neighbors before reaching their
+// security radius, stored back to back. Kept so that these cells can be
+// resumed instead of recomputed from the initial cube.
+template <typename Ti, typename Tf, typename Tu>
+struct snapshot {
+
+  std::vector<Ti> index;      // cell index
+  std::vector<Tf> pq;         // squared distance of the last neighbor used
+  std::vector<size_t> poffs;  // planes of entry j : [poffs[j], poffs[j+1])
+  std::vector<size_t> toffs;  // triangles of entry j : [toffs[j], toffs[j+1])
+
+  std::vector<Tf> P;
+  std::vector<Ti> owner;      // neighbor that created each plane
+  std::vector<Tu> T;
+
+  snapshot();
+
+  size_t size() const;
+
+  // owners are initialized to cc::k_undefined and filled in by the caller
+  void push(
+    const Ti _index, const Tf _pq,
+    const Tf* _P, const unsigned short int p_size,
+    const Tu* _T, const unsigned short int t_size
+  );
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// Scratch
+///////////////////////////////////////////////////////////////////////////////
+
+// Clipping buffers of the cell a CPU thread works on. They start at
+// args.p_maxsize planes and args.t_maxsize triangles, and grow when a cell
+// needs more instead of the cell failing.
+template <typename Tf, typename Tu>
+struct scratch {
+
+  std::vector<Tf> P;
+  std::vector<Tu> T;
+  std::vector<Tf> V;                  // dual vertex of each triangle
+  std::vector<unsigned short int> A;  // triangle across each edge
+  std::vector<unsigned char> M;       // marks the conflict region
+  std::vector<unsigned short int> R;  // conflict region
+  std::vector<Tu> dR;                 // boundary edge leaving each plane
+  std::vector<unsigned short int> B;  // boundary edges
+  std::vector<uint32_t> U;            // planes used by the cell, one bit each
+  std::vector<Tf> F;                  // area and centroid of each face
+  std::vector<unsigned short int> S;  // a triangle on each face
+  std::vector<int64_t> O;             // point each plane was made from
+
+  unsigned short int p_maxsize;
+  unsigned short int t_maxsize;
+
+  Tf radius;                  // squared security radius of the last cell
+
+  // The volume, centroid and surface area of the last cell are only
+  // computed when 'geometry' is set.
+  bool geometry;
+  Tf volume;
+  std::array<Tf,3> centroid;
+  Tf area;
+
+  // With 'faces' set, the face shared with each neighbor written for the
+  // last cell is appended to 'records' as (area, centroid, unit normal
+  // towards the neighbor). Neighbors whose face is smaller than
+  // args.min_face_area are not written, whether 'faces' is set or not.
+  bool faces;
+  Tf min_face_area;
+  std::vector<Tf> records;
+
+  // With 'topology' set, the vertex of each triangle of the last cell is
+  // written to 'vertices' as (x, y, z), and each face to 'loops' as its
+  // number of vertices followed by the triangles around it. The faces of
+  // the neighbors written for the cell come first and in the same order,
+  // then the walls and the faces too small to be written.
+  bool topology;
+  std::vector<Tf> vertices;
+  std::vector<unsigned short int> loops;
+
+  // With 'flag_uncertain' set, as args.flag_uncertain, cells clipped with an
+  // orientation test too close to call get cc::uncertain_orientation.
+  bool flag_uncertain;
+
+  // With 'perturb' set, as args.perturb, ties are broken with the points in
+  // O, which are negative for the box and the walls.
+  bool perturb;
+
+  scratch(const struct args::cc& args);
+
+  // Doubles the buffer that overflowed in 'state' and clears its overflow
+  // bit. Returns false if it cannot grow any further.
+  bool grow(cc::state& state);
+
+  // Grows the buffers to hold at least p_size planes and t_size triangles,
+  // as far as the limits allow.
+  void reserve(const int p_size, const int t_size);
+
+  // Largest number of planes and triangles a cell can have with Tu.
+  static int p_limit(void);
+  static int t_limit(void);
+
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Convex Cell Direct Neighbors Algorithm
 ///////////////////////////////////////////////////////////////////////////////
@@ -20,17 +129,98 @@ namespace cci {
 /* ------------------------------------------------------------------------- */
 /// CPU Implementation
 /* ------------------------------------------------------------------------- */
+
+// If 'snap' is set, cells that use up all k neighbors without reaching their
+// security radius are saved to it.
 template <typename Ti, typename Tf, typename Tu>
 void compute(
   const Ti i, const Ti index,
   std::vector<cc::state>& states,
-  Tf* P, Tu* T, Tu* dR,
+  scratch<Tf, Tu>& buf,
   std::vector<Ti>& knn,
   std::vector<Ti>& dknn,
-  const std::vector<std::array<Tf,3>>& xyzset,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
   const Ti xyzsize,
-  const std::vector<std::array<Tf,3>>& refset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
   const Ti refsize,
+  const struct args::cc& args,
+  snapshot<Ti, Tf, Tu>* snap = nullptr
+);
+
+/* ------------------------------------------------------------------------- */
+
+// Same as above, for cells whose neighbors start at 'koffs' in knn and dknn
+// instead of k * i, so that each cell can have its own k.
+template <typename Ti, typename Tf, typename Tu>
+void compute(
+  const Ti i, const Ti index,
+  std::vector<cc::state>& states,
+  scratch<Tf, Tu>& buf,
+  std::vector<Ti>& knn,
+  std::vector<Ti>& dknn,
+  const size_t koffs,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const Ti xyzsize,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const Ti refsize,
+  const struct args::cc& args,
+  snapshot<Ti, Tf, Tu>* snap = nullptr
+);
+
+/* ------------------------------------------------------------------------- */
+
+// Streaming variant: neighbors are pulled from 'stream' until the security
+// radius is reached, so there is no upper bound on the number of neighbors
+// clipped against. 'dknn' maps planes to neighbors and grows with 'buf', and
+// the direct neighbors are written to 'dnn'.
+template <typename Ti, typename Tf, typename Tu>
+void compute(
+  const Ti i, const Ti index,
+  std::vector<cc::state>& states,
+  scratch<Tf, Tu>& buf,
+  knni::stream<Ti, Tf>& stream,
+  std::vector<Ti>& dknn,
+  std::vector<Ti>& dnn,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const Ti xyzsize,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const Ti refsize,
+  const struct args::cc& args
+);
+
+/* ------------------------------------------------------------------------- */
+
+// Squared distance from p to the farthest vertex of the cell, whose planes
+// are in the frame the cell of p is clipped in with 'args'.
+template <typename Tf, typename Tu>
+Tf radius(
+  const Tf* P, const Tu* T, const unsigned short int t_size,
+  const std::array<Tf,3>& p,
+  const struct args::cc& args
+);
+
+/* ------------------------------------------------------------------------- */
+
+// Resumes a cell from a clipped state. buf.P, buf.T and owner hold p_size
+// planes and t_size triangles, and grow with the cell. The first csize
+// entries of 'candidates' are clipped against in order until the security
+// radius is reached, and the direct neighbors are written to 'dnn'. The
+// candidates must include every point up to the security radius of the
+// initial state. Returns the security radius of the resumed cell, which is
+// also left in buf.radius along with the rest of its geometry, or NaN there
+// if the cell failed.
+template <typename Ti, typename Tf, typename Tu>
+Tf resume(
+  const Ti index,
+  std::vector<cc::state>& states,
+  scratch<Tf, Tu>& buf,
+  std::vector<Ti>& owner,
+  unsigned short int p_size,
+  unsigned short int t_size,
+  const std::vector<Ti>& candidates, const size_t csize,
+  std::vector<Ti>& dnn,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
   const struct args::cc& args
 );
 
@@ -40,7 +230,7 @@ void compute(
 
 template <typename Ti, typename Tf, typename Tu>
 void compute(
-  const Ti i, const Ti index,
+  const size_t i, const Ti index,
   const device_accessor_readwrite_t<cc::state>& states, 
   const device_accessor_readwrite_t<Tf>& P,
   const device_accessor_readwrite_t<Tu>& T,
@@ -48,29 +238,34 @@ void compute(
   const device_accessor_readwrite_t<Ti>& knn,
   const device_accessor_readwrite_t<Ti>& dknn,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
-  const struct args::cc& args
+  const size_t refsize,
+  const struct args::device_cc<Tf>& args
 );
 
 /* ------------------------------------------------------------------------- */
 
-
+// If 'faces' is set, the face shared with each direct neighbor is written to
+// F as 7 values, (area, centroid, unit normal towards the neighbor), in the
+// order of knn. P, knn, dknn and F hold one cell per work item, with strides
+// poffs and koffs, while refset holds all refsize points.
 template <typename Ti, typename Tf, typename Tu>
 void compute(
-  const Ti i, const Ti l_i, const Ti index,
+  const size_t i, const size_t l_i, const Ti index,
   const device_accessor_readwrite_t<cc::state>& states, 
-  const device_accessor_readwrite_t<Tf>& P,
+  const device_accessor_readwrite_t<Tf>& P, const size_t poffs,
   const device_accessor_readwrite_t<Tu>& T,
   const sycl::local_accessor<Tu, 1>& dR,
-  const device_accessor_readwrite_t<Ti>& knn, const Ti koffs,
+  const sycl::local_accessor<Tu, 1>& dE,
+  const device_accessor_readwrite_t<Ti>& knn, const size_t koffs,
   const device_accessor_readwrite_t<Ti>& dknn,
+  const device_accessor_readwrite_t<Tf>& F, const bool faces,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
-  const struct args::cc& args
+  const size_t refsize,
+  const struct args::device_cc<Tf>& args
 );
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -33,6 +33,31 @@ inline void sort(
   const size_t k
 );
 
+template <typename Ti, typename Tf>
+inline void minheapify(
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  const size_t h0,
+  const size_t s, size_t i
+);
+
+template <typename Ti, typename Tf>
+inline void minpush(
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  const size_t h0,
+  const size_t s,
+  const Ti id, const Tf pq
+);
+
+template <typename Ti, typename Tf>
+inline void minpop(
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  const size_t h0,
+  const size_t s
+);
+
 } // namespace heap
 
 /* ------------------------------------------------------------------------- */
@@ -73,7 +98,7 @@ template <typename Ti, typename Tf>
 inline void swap(
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const int s, const int i,
+  const size_t s, const size_t i,
   const int a, const int b
 );
  
@@ -81,7 +106,7 @@ template <typename Ti, typename Tf>
 inline void maxheapify(
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const int s, const int i,
+  const size_t s, const size_t i,
   const int k, int idx
 );
 
@@ -89,7 +114,7 @@ template <typename Ti, typename Tf>
 inline void sort(
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const int s, const int i,
+  const size_t s, const size_t i,
   const int k
 );
 
@@ -4,6 +4,7 @@
 #include <arguments.hpp>
 #include <xyzset.hpp>
 #include <heap.hpp>
+#include <status.hpp>
 #include <libsycl.hpp>
 
 namespace knni {
@@ -16,52 +17,165 @@ namespace knni {
 /// CPU Implementation
 /* ------------------------------------------------------------------------- */
 
+// The slots of the heap that are left empty, when fewer than k points are
+// within reach, are set to cc::k_undefined after the heap is sorted.
 template <typename Ti, typename Tf>
 void compute(
   const Ti i, const Ti index,
-  const std::vector<std::array<Tf,3>>& xyzset,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
   const Ti xyzsize,
   const std::vector<Ti>& id,
   const std::vector<Ti>& offset,
-  const std::vector<std::array<Tf,3>>& refset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
   const Ti refsize,
   std::vector<Ti>& heap_id,
   std::vector<Tf>& heap_pq,
   const struct args::knn& args
 );
 
+/* ------------------------------------------------------------------------- */
+
+// Same as above, with the heap of the query starting at 'hoffs' instead of
+// k * i.
+template <typename Ti, typename Tf>
+void compute(
+  const Ti i, const Ti index,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const Ti xyzsize,
+  const std::vector<Ti>& id,
+  const std::vector<Ti>& offset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const Ti refsize,
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq, const size_t hoffs,
+  const struct args::knn& args
+);
+
+/* ------------------------------------------------------------------------- */
+/// CPU Adaptive k
+/* ------------------------------------------------------------------------- */
+
+// k budget of a query from the occupancy of the 3x3x3 grid cells around it.
+// args.k is scaled by the density of that block relative to the mean density
+// of the grid, then clamped to [k_min, k_max] and to the number of points.
+
+template <typename Ti>
+int budget(
+  const Ti index,
+  const std::vector<Ti>& id,
+  const std::vector<Ti>& offset,
+  const int k_min, const int k_max,
+  const struct args::knn& args
+);
+
+/* ------------------------------------------------------------------------- */
+/// CPU Streaming Implementation
+/* ------------------------------------------------------------------------- */
+
+// Incremental neighbor generator. The grid is expanded shell by shell and
+// candidates are yielded in ascending distance on demand, so the consumer
+// decides how many neighbors it needs. A candidate is only released once its
+// distance is below the distance to the nearest unscanned grid cell.
+//
+// One instance is meant to be owned by one thread and reused for all the
+// queries of that thread through reset(). With args.max_radius, the stream
+// ends at the first point out of reach.
+
+template <typename Ti, typename Tf>
+class stream {
+
+  public:
+
+    stream(
+      const xyzset::span<const std::array<Tf,3>>& _xyzset,
+      const std::vector<Ti>& _id,
+      const std::vector<Ti>& _offset,
+      const struct args::knn& args
+    );
+
+    void reset(const Ti _index, const std::array<Tf,3>& q);
+    bool next(Ti& p, Tf& pq);
+
+  private:
+
+    void expand(void);
+
+    const xyzset::span<const std::array<Tf,3>> xyzset;
+    const std::vector<Ti>& id;
+    const std::vector<Ti>& offset;
+
+    const struct args::box box;
+    const int gr[3];
+    const Tf gl[3];         // length of the grid cells along each axis
+    const Tf l[3];          // length of the box along each axis
+    const bool periodic;
+    const Tf cutoff;        // squared distance past which points are left out
+
+    std::vector<Ti> heap_id;
+    std::vector<Tf> heap_pq;
+    size_t heap_size;
+
+    Ti index;
+    Tf q0, q1, q2;
+    int px, py, pz;
+    int r;
+    Tf min[3];              // distance to the faces of the grid cell of q
+    Tf bound;
+
+};
+
+/* ------------------------------------------------------------------------- */
+/// CPU Range Query
+/* ------------------------------------------------------------------------- */
+
+// Appends every point p != index with pq_min <= |pq|^2 <= pq_max to
+// (heap_id, heap_pq) starting at position 'size', growing the vectors when
+// needed. Returns the new size. The output is not sorted.
+
+template <typename Ti, typename Tf>
+size_t range(
+  const Ti index, const std::array<Tf,3>& q,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const std::vector<Ti>& offset,
+  const Tf pq_min, const Tf pq_max,
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  size_t size,
+  const struct args::knn& args
+);
+
 /* ------------------------------------------------------------------------- */
 /// SYCL Implementation
 /* ------------------------------------------------------------------------- */
 
 template <typename Ti, typename Tf>
 void compute(
-  const Ti i, const Ti index,
+  const size_t i, const Ti index,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Ti>& id,
   const device_accessor_read_t<Ti>& offset,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
+  const size_t refsize,
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const struct args::knn& args
+  const struct args::device_knn<Tf>& args
 );
 
 /* ------------------------------------------------------------------------- */
 
 template <typename Ti, typename Tf>
 void compute(
-  const Ti i, const Ti index,
+  const size_t i, const Ti index,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Ti>& id,
   const device_accessor_read_t<Ti>& offset,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
+  const size_t refsize,
   const device_accessor_readwrite_t<Ti>& heap_id,
-  const device_accessor_readwrite_t<Tf>& heap_pq, const Ti hoffs,
-  const struct args::knn& args
+  const device_accessor_readwrite_t<Tf>& heap_pq, const size_t hoffs,
+  const struct args::device_knn<Tf>& args
 );
 
 ///////////////////////////////////////////////////////////////////////////////
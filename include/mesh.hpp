@@ -0,0 +1,77 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <cstdint>
+
+namespace mesh {
+
+///////////////////////////////////////////////////////////////////////////////
+/// Writer
+///////////////////////////////////////////////////////////////////////////////
+
+enum class format { vtk, ply };
+
+// Streams cell polyhedra to a binary file, cell by cell, so that a mesh never
+// has to be held in memory. The format follows the extension of 'fname':
+// ".ply" gives a PLY polygon soup with the cell of each face as a property,
+// anything else a legacy VTK unstructured grid of polyhedra. Both formats
+// need their counts before their data, so each section is streamed to a
+// temporary file next to 'fname', and the sections are joined under the
+// header on close().
+template <typename Tf>
+class writer {
+
+  public:
+
+    writer(const std::string& _fname);
+    ~writer();
+
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+
+    // Appends cell 'index'. Its vertices are given as (x, y, z), and its
+    // faces as the number of vertices of each followed by its vertices, as
+    // in cci::scratch::loops. Both formats store indices and counts as
+    // int32, so a cell that would take one of them past 2^31 - 1 is reported
+    // and closes the writer, leaving the file unwritten.
+    void add(
+      const size_t index,
+      const std::vector<Tf>& vertices,
+      const std::vector<unsigned short int>& loops,
+      const Tf volume,
+      const int nneighbors
+    );
+
+    // Writes the file. Called by the destructor if it was not before.
+    void close(void);
+
+    bool good(void) const;
+
+  private:
+
+    std::string fname;
+    enum format format;
+    bool open;
+
+    size_t nvertices;
+    size_t ncells;
+    size_t nfaces;
+    size_t csize;         // VTK only, integers in the CELLS section
+
+    // one stream per section, in the order they are written
+    std::vector<std::string> names;
+    std::vector<std::ofstream> sections;
+
+};
+
+// Format written for 'fname'.
+inline enum format get_format(const std::string& fname);
+
+} // namespace mesh
+
+#include <mesh.ipp>
+#endif // MESH_HPP
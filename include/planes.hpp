@@ -1,6 +1,9 @@
 #ifndef PLANES_HPP
 #define PLANES_HPP
 #include <array>
+#include <limits>
+
+#include <libsycl.hpp>
 
 namespace planes {
 
@@ -28,6 +31,43 @@ inline T2 dot(
 
 /* ------------------------------------------------------------------------- */
 
+// Whether 'dotp', the dot product of the two planes, is too close to zero for
+// its sign to be trusted in T2. The bound covers the rounding of the product
+// and of the vertex it is taken with, for vertices that are not themselves
+// badly conditioned. 'cancelled' is the magnitude of any terms that cancelled
+// out in d1 or d2, such as the squared norm of the points a bisector was made
+// from. It is a filter to rerun the few doubtful cases in higher precision,
+// not a proof that the others are exact.
+template <typename T2>
+inline bool uncertain(
+  const T2 dotp,
+  const T2 a1, const T2 b1, const T2 c1, const T2 d1,
+  const T2 a2, const T2 b2, const T2 c2, const T2 d2,
+  const T2 cancelled = 0
+);
+
+/* ------------------------------------------------------------------------- */
+
+// Breaks a tie between the vertex of planes 1, 2 and 3 and the bisector q of
+// the cell of point p, by simulation of simplicity. Each point is given an
+// infinitesimal weight, larger for lower indices, which moves the bisectors
+// it was made from, and the sign of the resulting change in the dot product
+// of the vertex with q is returned: 1 if the vertex moves to the positive
+// side of q, -1 if not. o1, o2, o3 and oq are the points the planes were made
+// from, negative for planes that are not bisectors and do not move. Returns 0
+// if no weight moves the vertex, which only happens when the planes of the
+// vertex are themselves dependent up to rounding.
+template <typename T2, typename Ti>
+inline int perturbed(
+  const T2 a1, const T2 b1, const T2 c1, const Ti o1,
+  const T2 a2, const T2 b2, const T2 c2, const Ti o2,
+  const T2 a3, const T2 b3, const T2 c3, const Ti o3,
+  const T2 aq, const T2 bq, const T2 cq, const Ti oq,
+  const Ti op
+);
+
+/* ------------------------------------------------------------------------- */
+
 template <typename T2>
 inline void bisect(
   T2& dst0, T2& dst1, T2& dst2, T2& dst3,
@@ -1,6 +1,8 @@
 #ifndef SECURITY_RADIUS_HPP
 #define SECURITY_RADIUS_HPP
 
+#include <limits>
+
 namespace sr {
   
 ///////////////////////////////////////////////////////////////////////////////
@@ -25,6 +27,15 @@ inline bool is_reached(
   const T2 security_radius
 );
 
+/* ------------------------------------------------------------------------- */
+
+// Factor to widen the security radius by before is_reached, so that points
+// level with it up to rounding are still clipped against. They can only
+// touch the cell at a vertex, which matters when such ties are broken
+// symbolically, as with args::cc::perturb, and not otherwise.
+template <typename T2>
+inline T2 margin(const bool perturb);
+
 /* ------------------------------------------------------------------------- */
   
 ///////////////////////////////////////////////////////////////////////////////
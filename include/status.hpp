@@ -25,6 +25,7 @@ enum status : signed char {
   error_p_overflow,
   error_t_overflow,
   error_occurred,
+  uncertain_orientation,
 
   status_enum_size,
   k_undefined = __INTERNAL__K_UNDEFINED
@@ -9,6 +9,40 @@
 
 namespace votess {
   enum device { cpu, gpu, };
+
+  // Geometry of each cell, indexed like the points in the order xyzset is
+  // sorted to. Cells finished by the GPU kernels are reported as NaN.
+  template <typename Tf>
+  struct cells {
+    std::vector<Tf> radius;   // squared distance to the farthest vertex
+    std::vector<Tf> volume;
+    std::vector<std::array<Tf, 3>> centroid;
+    std::vector<Tf> area;     // total surface area, walls included
+  };
+
+  // Face shared by each point and each of its neighbors, aligned with
+  // dnn::list. Faces of cells that could not be completed are NaN.
+  template <typename Tf>
+  struct faces {
+    std::vector<Tf> area;
+    std::vector<std::array<Tf, 3>> centroid;
+    std::vector<std::array<Tf, 3>> normal;  // unit, towards the neighbor
+  };
+
+  // Vertices and faces of each cell, indexed like the points in the order
+  // xyzset is sorted to. Each face is a loop of vertices of its cell,
+  // counterclockwise seen from outside of it. The faces of the neighbors in
+  // dnn come first and in the same order. Cells finished by the GPU kernels,
+  // and cells that could not be completed, have neither.
+  template <typename Ti, typename Tf>
+  struct polyhedra {
+    std::vector<std::array<Tf, 3>> vertices;
+    std::vector<size_t> voffs;  // vertices of cell i : [voffs[i], voffs[i+1])
+    std::vector<size_t> foffs;  // faces of cell i : [foffs[i], foffs[i+1])
+    std::vector<size_t> loffs;  // loop of face f : [loffs[f], loffs[f+1])
+    std::vector<Ti> loops;      // vertices counted from voffs of the cell
+    std::vector<Ti> neighbor;   // across each face, -1 if there is none
+  };
 }
 
 namespace votess {
@@ -18,6 +52,71 @@ namespace votess {
     class vtargs args,
     const enum device device = device::cpu
   );
+
+  // Same as above, over the 'size' points at 'xyzset' in memory the caller
+  // owns, such as a numpy array. They are sorted and read in place there,
+  // as the other overloads do with their vector.
+  template <typename Ti, typename Tf>
+  class dnn<Ti> tesellate(
+    std::array<Tf, 3>* xyzset,
+    const size_t size,
+    class vtargs args,
+    const enum device device = device::cpu
+  );
+
+  // Same as above, also writing the squared security radius of each cell,
+  // i.e. the squared distance from its point to its farthest vertex, to
+  // 'radius'. It is indexed like the points, in the order xyzset is sorted
+  // to. Cells finished by the GPU kernels are reported as NaN.
+  template <typename Ti, typename Tf>
+  class dnn<Ti> tesellate(
+    std::vector<std::array<Tf, 3>>& xyzset,
+    std::vector<Tf>& radius,
+    class vtargs args,
+    const enum device device = device::cpu
+  );
+
+  // Same as above, also measuring the volume, centroid and surface area of
+  // each cell from its final planes. Only the overloads taking cells pay for
+  // them.
+  template <typename Ti, typename Tf>
+  class dnn<Ti> tesellate(
+    std::vector<std::array<Tf, 3>>& xyzset,
+    struct cells<Tf>& cells,
+    class vtargs args,
+    const enum device device = device::cpu
+  );
+
+  // Same as the first, also writing the face of every neighbor pair to
+  // 'faces'. On both devices, and whether faces are asked for or not,
+  // neighbors whose face is smaller than args["cc_min_face_area"] are left
+  // out.
+  template <typename Ti, typename Tf>
+  class dnn<Ti> tesellate(
+    std::vector<std::array<Tf, 3>>& xyzset,
+    struct faces<Tf>& faces,
+    class vtargs args,
+    const enum device device = device::cpu
+  );
+
+  template <typename Ti, typename Tf>
+  class dnn<Ti> tesellate(
+    std::vector<std::array<Tf, 3>>& xyzset,
+    struct cells<Tf>& cells,
+    struct faces<Tf>& faces,
+    class vtargs args,
+    const enum device device = device::cpu
+  );
+
+  // Same as the first, also writing the vertices and faces of each cell to
+  // 'polyhedra', straight from its final triangles.
+  template <typename Ti, typename Tf>
+  class dnn<Ti> tesellate(
+    std::vector<std::array<Tf, 3>>& xyzset,
+    struct polyhedra<Ti, Tf>& polyhedra,
+    class vtargs args,
+    const enum device device = device::cpu
+  );
 }
   
 #include <votess.ipp>
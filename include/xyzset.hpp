@@ -8,6 +8,10 @@
 #define XYZSET_HPP
 
 #include <algorithm>
+#include <array>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <libsycl.hpp>
 #include <arguments.hpp>
 
@@ -17,6 +21,38 @@
  */
 namespace xyzset {
 
+/**
+ * @brief A set of 3D points in memory owned elsewhere, by a vector or by the
+ * caller of votess::tesellate, which is read and sorted in place through it.
+ *
+ * @tparam T Point type, const for sets that are only read. Sets of non-const
+ * points convert to sets of const ones.
+ */
+template <typename T>
+class span {
+
+  public:
+
+    span(T* _data, const size_t _size) : ptr(_data), n(_size) {}
+
+    template <typename V, typename = std::enable_if_t<std::is_convertible<
+      decltype(std::declval<V&>().data()), T*>::value>>
+    span(V& v) : ptr(v.data()), n(v.size()) {}
+
+    T* data(void) const { return ptr; }
+    size_t size(void) const { return n; }
+    bool empty(void) const { return n == 0; }
+    T& operator[](const size_t i) const { return ptr[i]; }
+    T* begin(void) const { return ptr; }
+    T* end(void) const { return ptr + n; }
+
+  private:
+
+    T* ptr;
+    size_t n;
+
+};
+
 /**
  * @brief Calculates the squared distance between two 3D points.
  * 
@@ -35,34 +71,105 @@ inline Tf get_distance(
   const Tf q0, const Tf q1, const Tf q2
 );
 
+/**
+ * @brief Coordinate of the periodic image of a point that is nearest to
+ * another point, along one axis of the box.
+ *
+ * @tparam Tf Numeric type of the point components.
+ * @param a Coordinate of the point to take the image of, within the box.
+ * @param b Coordinate of the point the image should be nearest to, within
+ * the box.
+ * @param l Length of the box along the axis.
+ * @return a, a - l or a + l, whichever is nearest to b.
+ */
+template <typename Tf>
+inline Tf get_image(const Tf a, const Tf b, const Tf l);
+
 /**
  * @brief Sorts a set of 3D points into a grid of specified resolution.
  * 
- * The function sorts points into cells within a grid of `grid_resolution^3`
- * total cells, returning cell IDs and an offset for easy access to points in
- * each cell.
+ * The function sorts points into cells within a grid of `box.gr[0] *
+ * box.gr[1] * box.gr[2]` total cells over the box, returning cell IDs and an
+ * offset for easy access to points in each cell. Cell IDs run along x first.
  * 
  * @tparam Ti Integer type for cell ID and offset values.
  * @tparam Tf Numeric type for point components.
- * @param xyzset Reference to a vector of 3D points to be sorted.
- * @param args Struct containing arguments such as `grid_resolution`.
+ * @param xyzset 3D points to be sorted, in place.
+ * @param args Struct containing arguments such as `box`.
  * @return A pair consisting of a vector of cell IDs and a vector of offsets
  * for accessing points in each cell.
  */
 template <typename Ti, typename Tf>
 const std::pair<std::vector<Ti>, std::vector<Ti>>
-sort(std::vector<std::array<Tf, 3>>& xyzset, const args::xyzset& args);
+sort(span<std::array<Tf, 3>> xyzset, const args::xyzset& args);
 
 /**
- * @brief Validates that all points in a set are within the range (0, 1).
+ * @brief Finds the points of a set sorted by sort() that coincide with a
+ * point of lower index, up to a tolerance.
+ *
+ * Each point only searches the grid cells within `tolerance` of it, which
+ * is its own cell unless it lies that close to a face of the cell, and the
+ * points are split across threads. Points that coincide through a chain of
+ * others are grouped together, under the lowest index of the group.
+ *
+ * @tparam Ti Integer type for cell ID and offset values.
+ * @tparam Tf Numeric type for point components.
+ * @param xyzset 3D points, as sorted by sort().
+ * @param offset Offsets of the grid cells, as returned by sort().
+ * @param args Struct containing arguments such as `box` and `periodic`.
+ * @param tolerance Distance up to which points coincide. Zero only groups
+ * exact duplicates.
+ * @param nthreads Number of threads to use.
+ * @return For each point, the lowest index of the group it belongs to, i.e.
+ * the point itself if no point of lower index coincides with it.
+ */
+template <typename Ti, typename Tf>
+std::vector<Ti> duplicates(
+  const span<const std::array<Tf, 3>>& xyzset,
+  const std::vector<Ti>& offset,
+  const args::knn& args,
+  const Tf tolerance,
+  const size_t nthreads
+);
+
+/**
+ * @brief Moves the points that duplicate others to the end of a set sorted
+ * by sort(), so that the grid only covers the points they were merged into.
+ *
+ * The other points keep their order, and `id`, `offset` and `alias` are
+ * updated to the new order.
+ *
+ * @tparam Ti Integer type for cell ID and offset values.
+ * @tparam Tf Numeric type for point components.
+ * @param xyzset 3D points, as sorted by sort().
+ * @param id Cell IDs, as returned by sort().
+ * @param offset Offsets of the grid cells, as returned by sort().
+ * @param alias Groups of the points, as returned by duplicates().
+ * @return The number of points kept, which come first.
+ */
+template <typename Ti, typename Tf>
+size_t merge(
+  span<std::array<Tf, 3>> xyzset,
+  std::vector<Ti>& id,
+  std::vector<Ti>& offset,
+  std::vector<Ti>& alias
+);
+
+/**
+ * @brief Validates that all points in a set are strictly within a box, by
+ * default the unit box.
  * 
  * @tparam Tf Numeric type for point components.
- * @param xyzset Vector of 3D points to be validated.
+ * @param xyzset 3D points to be validated.
+ * @param box Box the points should be within.
  * @return True if all points are within the specified range; otherwise, false.
  */
 template <typename Tf>
 bool 
-validate_xyzset(const std::vector<std::array<Tf,3>>& xyzset);
+validate_xyzset(
+  const span<const std::array<Tf,3>>& xyzset,
+  const args::box& box = args::box(1)
+);
 
 /**
  * @brief Validates that a set of IDs is in ascending order.
@@ -97,11 +97,11 @@ boundary::vstatus::get_shared_position(void) const {
 template<typename Ti, typename Tu>
 inline boundary::bstatus boundary::compute(
   Tu* cycle, 
-  const Ti dr_offs,
+  const size_t dr_offs,
   const Ti dr_size,
   short int& head,
   Tu* R,
-  const Ti r_offs,
+  const size_t r_offs,
   const Ti r_size
 ) {
 
@@ -124,7 +124,7 @@ inline boundary::bstatus boundary::compute(
       const Tu& triangle_edge_0 = R[r_offs + j * 3 + (k + 0) % triangle_size];
       const Tu& triangle_edge_1 = R[r_offs + j * 3 + (k + 1) % triangle_size];
   
-      uint8_t edge = cycle[dr_offs + first];
+      Tu edge = cycle[dr_offs + first];
   
       Ti counter = 0;
       while (true) {
@@ -182,7 +182,7 @@ inline boundary::bstatus boundary::compute(
     } else if (nshared_edges == 2) {
       
       head = cycle[dr_offs + triangle_edge_0];
-      cycle[dr_offs + head] = boundary::bstatus::undefined;
+      cycle[dr_offs + head] = boundary::sentinel<Tu>();
                                                             
       cycle[dr_offs + triangle_edge_0] = triangle_edge_1;
       head = triangle_edge_0;
@@ -193,11 +193,11 @@ inline boundary::bstatus boundary::compute(
     }
   
     bool flag = false;
-    for (uint8_t edge_i = 0; edge_i < dr_size; edge_i++) {
-      if (cycle[dr_offs + edge_i] == boundary::bstatus::undefined) continue;
+    for (Ti edge_i = 0; edge_i < dr_size; edge_i++) {
+      if (cycle[dr_offs + edge_i] == boundary::sentinel<Tu>()) continue;
 
-      for (uint8_t edge_j = edge_i + 1; edge_j < dr_size; edge_j++) {
-        if (cycle[dr_offs + edge_j] == boundary::bstatus::undefined) continue;
+      for (Ti edge_j = edge_i + 1; edge_j < dr_size; edge_j++) {
+        if (cycle[dr_offs + edge_j] == boundary::sentinel<Tu>()) continue;
 
         const bool cond = cycle[dr_offs + edge_i] == cycle[dr_offs + edge_j];
         if (!cond) continue;
@@ -235,11 +235,11 @@ inline boundary::bstatus boundary::compute(
 template<typename Ti, typename Tu>
 inline boundary::bstatus boundary::compute(
   const sycl::local_accessor<Tu, 1>& cycle,
-  const Ti dr_offs,
+  const size_t dr_offs,
   const Ti dr_size,
   short int& head,
   const device_accessor_readwrite_t<Tu>& R, 
-  const Ti  r_offs,
+  const size_t r_offs,
   const Ti  r_size
 ) {
 
@@ -262,7 +262,7 @@ inline boundary::bstatus boundary::compute(
       const Tu& triangle_edge_0 = R[r_offs + j * 3 + (k + 0) % triangle_size];
       const Tu& triangle_edge_1 = R[r_offs + j * 3 + (k + 1) % triangle_size];
   
-      uint8_t edge = cycle[dr_offs + first];
+      Tu edge = cycle[dr_offs + first];
   
       Tu counter = 0;
       while (true) {
@@ -319,7 +319,7 @@ inline boundary::bstatus boundary::compute(
     } else if (nshared_edges == 2) {
       
       head = cycle[dr_offs + triangle_edge_0];
-      cycle[dr_offs + head] = boundary::bstatus::undefined;
+      cycle[dr_offs + head] = boundary::sentinel<Tu>();
                                                             
       cycle[dr_offs + triangle_edge_0] = triangle_edge_1;
       head = triangle_edge_0;
@@ -331,12 +331,12 @@ inline boundary::bstatus boundary::compute(
   
   
     bool flag = false;
-    for (uint8_t edge_i = 0; edge_i < dr_size; edge_i++) {
-      if (cycle[dr_offs + edge_i] == boundary::bstatus::undefined) continue;
+    for (Ti edge_i = 0; edge_i < dr_size; edge_i++) {
+      if (cycle[dr_offs + edge_i] == boundary::sentinel<Tu>()) continue;
 
 
-      for (uint8_t edge_j = edge_i + 1; edge_j < dr_size; edge_j++) {
-        if (cycle[dr_offs + edge_j] == boundary::bstatus::undefined) continue;
+      for (Ti edge_j = edge_i + 1; edge_j < dr_size; edge_j++) {
+        if (cycle[dr_offs + edge_j] == boundary::sentinel<Tu>()) continue;
 
         const bool cond = cycle[dr_offs + edge_i] == cycle[dr_offs + edge_j];
         if (!cond) continue;
@@ -365,6 +365,195 @@ inline boundary::bstatus boundary::compute(
 
 /* ------------------------------------------------------------------------- */
 
+///////////////////////////////////////////////////////////////////////////////
+/// Extract Internal                                                         //
+///////////////////////////////////////////////////////////////////////////////
+
+/* ------------------------------------------------------------------------- */
+
+// Shared by the CPU and SYCL versions, which only differ in how the cycle, R
+// and the table are accessed. A slot (a, b) is empty when both are sentinel,
+// and a cancelled edge is left as (sentinel, 0) so that probing goes on past
+// it.
+
+namespace boundary {
+namespace internal {
+
+template <typename Tu>
+inline int hash(const Tu a, const Tu b) {
+  const uint32_t h = static_cast<uint32_t>(a) * 0x9e3779b1u ^ 
+                     static_cast<uint32_t>(b) * 0x85ebca6bu;
+  return static_cast<int>(h >> (32 - table_bits));
+}
+
+template <typename Ti, typename Tu, typename Tc, typename Tr, typename Tt>
+inline bstatus extract(
+  const Tc& cycle,
+  const size_t dr_offs,
+  short int& head,
+  const Tr& R,
+  const size_t r_offs,
+  const Ti r_size,
+  const Tt& table,
+  const size_t tb_offs
+) {
+
+  constexpr Tu none = sentinel<Tu>();
+  constexpr int mask = table_size - 1;
+
+  const auto empty = [&](const int s) {
+    return table[tb_offs + 2 * s + 0] == none && 
+           table[tb_offs + 2 * s + 1] == none;
+  };
+
+  if (2 * 3 * r_size > table_size) {
+    return bstatus::overflow;
+  }
+
+  // an edge is cancelled by its reverse, so only the boundary is left
+  for (Ti j = 0; j < r_size; j++) {
+    for (int e = 0; e < 3; e++) {
+
+      const Tu a = R[r_offs + 3 * j + e];
+      const Tu b = R[r_offs + 3 * j + (e + 1) % 3];
+
+      int s = hash<Tu>(b, a);
+      bool cancelled = false;
+      while (!empty(s)) {
+        if (table[tb_offs + 2 * s + 0] == b && 
+            table[tb_offs + 2 * s + 1] == a) {
+          table[tb_offs + 2 * s + 0] = none;
+          table[tb_offs + 2 * s + 1] = 0;
+          cancelled = true;
+          break;
+        }
+        s = (s + 1) & mask;
+      }
+      if (cancelled) continue;
+
+      s = hash<Tu>(a, b);
+      while (!empty(s)) s = (s + 1) & mask;
+      table[tb_offs + 2 * s + 0] = a;
+      table[tb_offs + 2 * s + 1] = b;
+
+    }
+  }
+
+  // the edges left over are linked into the cycle
+  Ti b_size = 0;
+  bool simple = true;
+  for (Ti j = 0; j < r_size; j++) {
+    for (int e = 0; e < 3; e++) {
+
+      const Tu a = R[r_offs + 3 * j + e];
+      const Tu b = R[r_offs + 3 * j + (e + 1) % 3];
+
+      int s = hash<Tu>(a, b);
+      while (!empty(s)) {
+        if (table[tb_offs + 2 * s + 0] == a && 
+            table[tb_offs + 2 * s + 1] == b) {
+          break;
+        }
+        s = (s + 1) & mask;
+      }
+      if (empty(s)) continue;
+
+      if (cycle[dr_offs + a] != none) simple = false;
+      cycle[dr_offs + a] = b;
+      head = a;
+      b_size++;
+
+    }
+  }
+
+  // every slot that was written to is on the probe path of one of the edges,
+  // and is cleared along with it.
+  for (Ti j = 0; j < r_size; j++) {
+    for (int e = 0; e < 3; e++) {
+      const Tu a = R[r_offs + 3 * j + e];
+      const Tu b = R[r_offs + 3 * j + (e + 1) % 3];
+      for (int s = hash<Tu>(a, b); !empty(s); s = (s + 1) & mask) {
+        table[tb_offs + 2 * s + 0] = none;
+        table[tb_offs + 2 * s + 1] = none;
+      }
+    }
+  }
+
+  // the boundary has to be a single cycle through every edge
+  if (simple && b_size > 0) {
+    Ti steps = 0;
+    Tu v = head;
+    do {
+      v = cycle[dr_offs + v];
+      steps++;
+    } while (v != none && v != head && steps <= b_size);
+    simple = v == head && steps == b_size;
+  } else {
+    simple = false;
+  }
+
+  if (!simple) {
+    for (Ti j = 0; j < 3 * r_size; j++) {
+      cycle[dr_offs + R[r_offs + j]] = none;
+    }
+    return bstatus::unreachable;
+  }
+
+  return bstatus::success;
+
+}
+
+} // namespace internal
+} // namespace boundary
+
+///////////////////////////////////////////////////////////////////////////////
+/// Extract CPU Implementation                                               //
+///////////////////////////////////////////////////////////////////////////////
+
+/* ------------------------------------------------------------------------- */
+
+template<typename Ti, typename Tu>
+inline boundary::bstatus boundary::extract(
+  Tu* cycle,
+  const size_t dr_offs,
+  short int& head,
+  const Tu* R,
+  const size_t r_offs,
+  const Ti r_size,
+  Tu* table,
+  const size_t tb_offs
+) {
+  return internal::extract<Ti, Tu>(
+    cycle, dr_offs, head, R, r_offs, r_size, table, tb_offs
+  );
+}
+
+/* ------------------------------------------------------------------------- */
+
+///////////////////////////////////////////////////////////////////////////////
+/// Extract SYCL Implementation                                              //
+///////////////////////////////////////////////////////////////////////////////
+
+/* ------------------------------------------------------------------------- */
+
+template<typename Ti, typename Tu>
+inline boundary::bstatus boundary::extract(
+  const sycl::local_accessor<Tu, 1>& cycle,
+  const size_t dr_offs,
+  short int& head,
+  const device_accessor_readwrite_t<Tu>& R, 
+  const size_t r_offs,
+  const Ti r_size,
+  const sycl::local_accessor<Tu, 1>& table,
+  const size_t tb_offs
+) {
+  return internal::extract<Ti, Tu>(
+    cycle, dr_offs, head, R, r_offs, r_size, table, tb_offs
+  );
+}
+
+/* ------------------------------------------------------------------------- */
+
 ///////////////////////////////////////////////////////////////////////////////
 /// End
 ///////////////////////////////////////////////////////////////////////////////
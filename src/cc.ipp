@@ -1,191 +1,1309 @@
+#include <limits>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Snapshot                                                                ///
+///////////////////////////////////////////////////////////////////////////////
+
 template <typename Ti, typename Tf, typename Tu>
-void cci::compute(
-  const Ti i, const Ti index,
-  std::vector<cc::state>& states,
-  Tf* P,
-  Tu* T,
-  Tu* dR,
-  std::vector<Ti>& knn,
-  std::vector<Ti>& dknn,
-  const std::vector<std::array<Tf,3>>& xyzset,
-  const Ti xyzsize,
-  const std::vector<std::array<Tf,3>>& refset,
-  const Ti refsize,
-  const struct args::cc& args
+cci::snapshot<Ti, Tf, Tu>::snapshot() : poffs(1, 0), toffs(1, 0) {}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf, typename Tu>
+size_t cci::snapshot<Ti, Tf, Tu>::size() const {
+  return index.size();
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf, typename Tu>
+void cci::snapshot<Ti, Tf, Tu>::push(
+  const Ti _index, const Tf _pq,
+  const Tf* _P, const unsigned short int p_size,
+  const Tu* _T, const unsigned short int t_size
 ) {
+  this->index.push_back(_index);
+  this->pq.push_back(_pq);
+  this->P.insert(this->P.end(), _P, _P + 4 * p_size);
+  this->T.insert(this->T.end(), _T, _T + 3 * t_size);
+  this->owner.resize(this->owner.size() + p_size, cc::k_undefined);
+  this->poffs.push_back(this->poffs.back() + p_size);
+  this->toffs.push_back(this->toffs.back() + t_size);
+}
 
-  (void) xyzsize;
-  (void) refsize;
-  
-  // TODO : make this swappable for future
-  static const Tf p_init[] = { 
+///////////////////////////////////////////////////////////////////////////////
+/// Scratch
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Tf, typename Tu>
+cci::scratch<Tf, Tu>::scratch(const struct args::cc& args) 
+  : p_maxsize(std::min(args.p_maxsize, p_limit())), 
+    t_maxsize(std::min(args.t_maxsize, t_limit())),
+    radius(0.00f), 
+    geometry(false), volume(0.00f), centroid{0.00f, 0.00f, 0.00f}, 
+    area(0.00f), faces(false), min_face_area(args.min_face_area),
+    topology(false), flag_uncertain(args.flag_uncertain),
+    perturb(args.perturb) {
+  P.resize(4 * p_maxsize);
+  T.resize(3 * t_maxsize);
+  V.resize(4 * t_maxsize);
+  A.resize(3 * t_maxsize);
+  M.resize(t_maxsize, 0);
+  R.resize(t_maxsize);
+  dR.resize(p_maxsize, boundary::sentinel<Tu>());
+  B.resize(4 * p_maxsize);
+  U.resize((p_maxsize + 31) / 32);
+  F.resize(8 * p_maxsize);
+  S.resize(p_maxsize);
+  O.resize(p_maxsize, -1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf, typename Tu>
+void cci::scratch<Tf, Tu>::reserve(const int p_size, const int t_size) {
+  cc::state state;
+  state.reset();
+  while (p_maxsize < p_size) {
+    state.set_true(cc::error_p_overflow);
+    if (!grow(state)) break;
+  }
+  while (t_maxsize < t_size) {
+    state.set_true(cc::error_t_overflow);
+    if (!grow(state)) break;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+// plane indices must stay below the boundary sentinel, and both planes and
+// triangles are walked with a signed short.
+
+template <typename Tf, typename Tu>
+int cci::scratch<Tf, Tu>::p_limit(void) {
+  return std::min<int>(boundary::sentinel<Tu>(), 
+                       std::numeric_limits<short int>::max());
+}
+
+template <typename Tf, typename Tu>
+int cci::scratch<Tf, Tu>::t_limit(void) {
+  return std::numeric_limits<short int>::max();
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf, typename Tu>
+bool cci::scratch<Tf, Tu>::grow(cc::state& state) {
+
+  if (state.get(cc::error_p_overflow) && p_maxsize < p_limit()) {
+    p_maxsize = std::min(2 * p_maxsize, p_limit());
+    P.resize(4 * p_maxsize);
+    dR.resize(p_maxsize, boundary::sentinel<Tu>());
+    B.resize(4 * p_maxsize);
+    U.resize((p_maxsize + 31) / 32);
+    F.resize(8 * p_maxsize);
+    S.resize(p_maxsize);
+    O.resize(p_maxsize, -1);
+    state.set_false(cc::error_p_overflow);
+    return true;
+  }
+
+  if (state.get(cc::error_t_overflow) && t_maxsize < t_limit()) {
+    t_maxsize = std::min(2 * t_maxsize, t_limit());
+    T.resize(3 * t_maxsize);
+    V.resize(4 * t_maxsize);
+    A.resize(3 * t_maxsize);
+    M.resize(t_maxsize, 0);
+    R.resize(t_maxsize);
+    state.set_false(cc::error_t_overflow);
+    return true;
+  }
+
+  return false;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Internal                                                                ///
+///////////////////////////////////////////////////////////////////////////////
+
+namespace cci {
+namespace internal {
+
+/* ------------------------------------------------------------------------- */
+
+// P, T, V and dR point to the start of the cell, i.e. they are already offset
+// by the cell index. V caches the dual vertex of each triangle as
+// (x, y, z, squared distance to p), so that clipping only needs a dot product
+// per triangle, and so that the security radius of the cell, i.e. the largest
+// of these distances, can be kept up to date as triangles come and go.
+
+template <typename Tf, typename Tu>
+static inline void vertex(
+  const Tf* P, const Tu* T, Tf* V,
+  const unsigned short int t_index,
+  const Tf px, const Tf py, const Tf pz
+) {
+
+  const Tu& t0 = T[3 * t_index + 0];
+  const Tu& t1 = T[3 * t_index + 1];
+  const Tu& t2 = T[3 * t_index + 2];
+
+  Tf w;
+  planes::intersect<Tf>(
+    V[4 * t_index + 0], V[4 * t_index + 1], V[4 * t_index + 2], w,
+    P[4 * t0 + 0], P[4 * t0 + 1], P[4 * t0 + 2], P[4 * t0 + 3],
+    P[4 * t1 + 0], P[4 * t1 + 1], P[4 * t1 + 2], P[4 * t1 + 3],
+    P[4 * t2 + 0], P[4 * t2 + 1], P[4 * t2 + 2], P[4 * t2 + 3]
+  );
+
+  V[4 * t_index + 3] = utils::square(V[4 * t_index + 0] - px) +
+                       utils::square(V[4 * t_index + 1] - py) +
+                       utils::square(V[4 * t_index + 2] - pz);
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// A[3 * t + e] is the triangle across edge e of triangle t, which goes from
+// T[3 * t + e] to T[3 * t + (e + 1) % 3]. Neighboring triangles run through
+// their shared edge in opposite directions. This is quadratic, and only used
+// to set up a cell.
+
+template <typename Tu>
+static inline void link(
+  const Tu* T, unsigned short int* A, const unsigned short int t_size
+) {
+  for (unsigned short int t = 0; t < t_size; t++) {
+    for (int e = 0; e < 3; e++) {
+      const Tu a = T[3 * t + e];
+      const Tu b = T[3 * t + (e + 1) % 3];
+      for (unsigned short int n = 0; n < t_size; n++) {
+        if (n == t) continue;
+        if ((T[3 * n + 0] == b && T[3 * n + 1] == a) ||
+            (T[3 * n + 1] == b && T[3 * n + 2] == a) ||
+            (T[3 * n + 2] == b && T[3 * n + 0] == a)) {
+          A[3 * t + e] = n;
+          break;
+        }
+      }
+    }
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf>
+static inline Tf radius(
+  const Tf* V, const unsigned short int t_first, const unsigned short int t_last
+) {
+  Tf sradius = 0.00f;
+  for (unsigned short int j = t_first; j < t_last; j++) {
+    sradius = V[4 * j + 3] > sradius ? V[4 * j + 3] : sradius;
+  }
+  return sradius;
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Origin of the frame the cell of p is clipped in, and whose coordinates px,
+// py and pz are given in below. With args.recenter it is p itself, so that
+// bisectors are made from the differences to p and their offsets no longer
+// cancel out the position of p in the box. Otherwise it is that of the box.
+// These helpers take args::cc on the CPU and args::device_cc in the kernels,
+// and work in the type of its lengths.
+
+template <typename Tf, typename Ta>
+static inline std::array<Tf,3> origin(
+  const Ta& args, const std::array<Tf,3>& p
+) {
+  if (!args.recenter) return {0.00f, 0.00f, 0.00f};
+  return p;
+}
+
+// Offset of the initial plane 'plane', a wall facing along one axis. The
+// initial cell is the box, or with periodicity the box centered on p, whose
+// walls are the bisectors of p and its own nearest images. With a maximum
+// radius, it is also cut down to the cube of that half side around p.
+
+template <typename Tf, typename Ta>
+static inline Tf init_offset(
+  const Tf* plane, const Ta& args, 
+  const Tf px, const Tf py, const Tf pz,
+  const std::array<Tf,3>& o
+) {
+  using Tl = decltype(args.max_radius);
+  const int c = plane[0] != 0 ? 0 : (plane[1] != 0 ? 1 : 2);
+  const Tf p[3] = {px, py, pz};
+  const Tl r = args.max_radius > 0 ? args.max_radius : args.box.length(c);
+  if (args.periodic) {
+    const Tl h = std::min<Tl>(args.box.length(c) / 2, r);
+    return static_cast<Tf>(h) - plane[c] * p[c];
+  }
+  const Tl lo = args.box.lo[c] - o[c];
+  const Tl hi = args.box.hi[c] - o[c];
+  return static_cast<Tf>(plane[c] > 0 ? -std::max(lo, p[c] - r)
+                                      : std::min(hi, p[c] + r));
+}
+
+// Wall j as a plane to clip with. clip() keeps the negative side, so the
+// wall is negated, and its offset is moved to the frame of origin o.
+
+template <typename Tf, typename Ta>
+static inline void wall(
+  Tf* plane, const Ta& args, const int j, 
+  const std::array<Tf,3>& o
+) {
+  const auto* w = args.walls + 4 * j;
+  plane[0] = static_cast<Tf>(-w[0]);
+  plane[1] = static_cast<Tf>(-w[1]);
+  plane[2] = static_cast<Tf>(-w[2]);
+  plane[3] = static_cast<Tf>(-(w[3] + w[0] * o[0] + w[1] * o[1] + 
+                                      w[2] * o[2]));
+}
+
+// Moves neighbor q to its image nearest to p, with periodicity.
+
+template <typename Tf, typename Ta>
+static inline void image(
+  const Ta& args, 
+  Tf& qx, Tf& qy, Tf& qz,
+  const Tf px, const Tf py, const Tf pz
+) {
+  if (!args.periodic) return;
+  qx = xyzset::get_image<Tf>(qx, px, args.box.length(0));
+  qy = xyzset::get_image<Tf>(qy, py, args.box.length(1));
+  qz = xyzset::get_image<Tf>(qz, pz, args.box.length(2));
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Point the kernels made plane j of a cell from, looked up among its first
+// 'count' neighbors, which lie 'stride' apart from 'offs' in knn and dknn.
+// Negative for the box and the walls, which are not in dknn.
+
+template <typename Ti>
+static inline Ti owner(
+  const device_accessor_readwrite_t<Ti>& knn,
+  const device_accessor_readwrite_t<Ti>& dknn,
+  const size_t offs, const size_t stride, const Ti count,
+  const Ti j
+) {
+  for (Ti n = 0; n < count; n++) {
+    if (dknn[offs + stride * n] == j) return knn[offs + stride * n];
+  }
+  return -1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Finds the triangle whose vertex lies farthest on the far side of the
+// bisector b, by walking from the last triangle along increasing distances.
+// On a convex cell that walk can only stop at the farthest vertex, unless
+// several triangles share it up to rounding, in which case all of them are
+// scanned. Starting from the farthest vertex rather than the first one found
+// keeps vertices that are only past b by rounding from seeding the conflict
+// region. Returns that farthest triangle, which is only cut if its vertex
+// lies on the positive side.
+
+template <typename Tf>
+static inline unsigned short int conflict(
+  const Tf* V, const unsigned short int* A,
+  const unsigned short int t_size,
+  const Tf* b
+) {
+
+  const auto distance = [&](const unsigned short int t) {
+    return planes::dot<Tf>(
+      V[4 * t + 0], V[4 * t + 1], V[4 * t + 2], 1.00f, b[0], b[1], b[2], b[3]
+    );
+  };
+
+  // vertices this close along b are taken to be the same vertex
+  const Tf eps = std::numeric_limits<Tf>::epsilon() * 1024;
+
+  unsigned short int t = t_size - 1;
+  Tf d = distance(t);
+  bool tied = false;
+
+  while (true) {
+
+    unsigned short int next = t;
+    Tf d_next = d;
+    tied = false;
+
+    for (int e = 0; e < 3; e++) {
+      const unsigned short int n = A[3 * t + e];
+      const Tf d_n = distance(n);
+      if (d_n > d_next) {
+        next = n;
+        d_next = d_n;
+      }
+      tied = tied || d_n >= d - eps * (std::fabs(d) + std::fabs(b[3]));
+    }
+
+    if (next == t) break;
+    t = next;
+    d = d_next;
+
+  }
+
+  if (!tied) return t;
+
+  for (unsigned short int n = 0; n < t_size; n++) {
+    const Tf d_n = distance(n);
+    if (d_n > d) {
+      t = n;
+      d = d_n;
+    }
+  }
+  return t;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Clips the cell with 'plane', keeping the side where it is negative. Returns
+// false if the cell ended up in an unrecoverable state, in which case the
+// error bits are set in 'state'. On success, p_size is incremented if and
+// only if the plane contributed a new face, whose index is then p_size - 1.
+//
+// The triangles cut off by the bisector form a connected region, so it is
+// flood filled from a single conflicting triangle through the adjacency, and
+// its boundary is read off the edges that leave it. The hole is then closed
+// with a fan around the new plane, reusing the slots of the removed
+// triangles. Overflows are detected before anything is written, so the cell
+// is left untouched and the caller can grow 'buf' and clip again.
+//
+// 'sradius' is the security radius of the cell and is updated in place. Only
+// the new triangles are looked at, unless a removed triangle held the
+// maximum, in which case it is recomputed from the remaining ones.
+//
+// 'p_index' and 'q_index' are the points the bisector was made from, and
+// q_index is negative for a plane that is not a bisector.
+
+template <typename Ti, typename Tf, typename Tu>
+static inline bool clip(
+  cc::state& state,
+  scratch<Tf, Tu>& buf,
+  unsigned short int& p_size,
+  unsigned short int& t_size,
+  const Tf px, const Tf py, const Tf pz,
+  const Tf* bisector,
+  const int64_t p_index, const int64_t q_index,
+  Tf& sradius
+) {
+
+  Tf* P = buf.P.data();
+  Tu* T = buf.T.data();
+  Tf* V = buf.V.data();
+  Tu* dR = buf.dR.data();
+  unsigned short int* A = buf.A.data();
+  unsigned char* M = buf.M.data();
+  unsigned short int* R = buf.R.data();
+  unsigned short int* B = buf.B.data();
+
+  const auto distance = [&](const unsigned short int t) {
+    return planes::dot<Tf>(
+      V[4 * t + 0], V[4 * t + 1], V[4 * t + 2], 1.00f,
+      bisector[0], bisector[1], bisector[2], bisector[3]
+    );
+  };
+
+  // With buf.flag_uncertain, the tests that decide which triangles go are
+  // checked, and the cell is flagged if any of them is too close to call.
+  // With buf.perturb, such ties with a bisector are broken symbolically
+  // instead. The offset of a bisector loses the squared norm of p to
+  // cancellation.
+  const bool perturb = buf.perturb && q_index >= 0;
+  const Tf cancelled = px * px + py * py + pz * pz;
+  bool uncertain = false;
+  bool tied = false;
+  const auto cut = [&](const unsigned short int t) {
+    const Tf d = distance(t);
+    tied = (buf.flag_uncertain || perturb) && planes::uncertain<Tf>(
+      d, V[4 * t + 0], V[4 * t + 1], V[4 * t + 2], 1.00f,
+      bisector[0], bisector[1], bisector[2], bisector[3], cancelled
+    );
+    uncertain = uncertain || (tied && buf.flag_uncertain);
+    if (tied && perturb) {
+      const Tu t0 = T[3 * t + 0];
+      const Tu t1 = T[3 * t + 1];
+      const Tu t2 = T[3 * t + 2];
+      const int sign = planes::perturbed<Tf, int64_t>(
+        P[4 * t0 + 0], P[4 * t0 + 1], P[4 * t0 + 2], buf.O[t0],
+        P[4 * t1 + 0], P[4 * t1 + 1], P[4 * t1 + 2], buf.O[t1],
+        P[4 * t2 + 0], P[4 * t2 + 1], P[4 * t2 + 2], buf.O[t2],
+        bisector[0], bisector[1], bisector[2], q_index, p_index
+      );
+      if (sign != 0) return sign > 0;
+    }
+    return d > 0.00f;
+  };
+  const auto flag = [&]() {
+    if (uncertain) state.set_true(cc::uncertain_orientation);
+  };
+
+  unsigned short int t_first = conflict<Tf>(V, A, t_size, bisector);
+  bool seeded = cut(t_first);
+
+  // a vertex level with the farthest one can be cut while it is not
+  if (!seeded && perturb && tied) {
+    for (unsigned short int t = 0; t < t_size && !seeded; t++) {
+      if (cut(t)) {
+        t_first = t;
+        seeded = true;
+      }
+    }
+  }
+
+  if (!seeded) {
+    flag();
+    return true;
+  }
+
+  /* ---------------------------------------------------------------------- */
+  /// Conflict region
+  /* ---------------------------------------------------------------------- */
+
+  unsigned short int r_size = 0;
+  bool lost = false;
+
+  R[r_size++] = t_first;
+  M[t_first] = 1;
+  for (unsigned short int c = 0; c < r_size; c++) {
+    const unsigned short int r = R[c];
+    lost = lost || V[4 * r + 3] >= sradius;
+    for (int e = 0; e < 3; e++) {
+      const unsigned short int n = A[3 * r + e];
+      if (M[n] || !cut(n)) continue;
+      M[n] = 1;
+      R[r_size++] = n;
+    }
+  }
+  flag();
+
+  /* ---------------------------------------------------------------------- */
+  /// Hole boundary
+  /* ---------------------------------------------------------------------- */
+
+  // B holds (from, to, outer triangle, edge of the outer triangle) for each
+  // edge of the boundary, and dR maps a plane to the edge that leaves it.
+  // dR is all sentinel between clips, and only the entries used are reset.
+
+  unsigned short int b_size = 0;
+  bool closed = true;
+
+  for (unsigned short int c = 0; c < r_size && closed; c++) {
+    const unsigned short int r = R[c];
+    for (int e = 0; e < 3; e++) {
+      const unsigned short int n = A[3 * r + e];
+      if (M[n]) continue;
+      const Tu a = T[3 * r + e];
+      const Tu b = T[3 * r + (e + 1) % 3];
+      if (dR[a] != boundary::sentinel<Tu>()) {
+        closed = false;
+        break;
+      }
+      dR[a] = b_size;
+      B[4 * b_size + 0] = a;
+      B[4 * b_size + 1] = b;
+      B[4 * b_size + 2] = n;
+      B[4 * b_size + 3] = T[3 * n + 0] == b ? 0 : T[3 * n + 1] == b ? 1 : 2;
+      b_size++;
+    }
+  }
+
+  // the boundary has to be a single cycle through every edge
+  if (closed && b_size > 0) {
+    unsigned short int j = 0;
+    unsigned short int steps = 0;
+    do {
+      j = dR[B[4 * j + 1]];
+      steps++;
+    } while (j != boundary::sentinel<Tu>() && j != 0 && steps <= b_size);
+    closed = j == 0 && steps == b_size;
+  } else {
+    closed = false;
+  }
+
+  const auto restore = [&]() {
+    for (unsigned short int j = 0; j < b_size; j++) {
+      dR[B[4 * j + 0]] = boundary::sentinel<Tu>();
+    }
+    for (unsigned short int c = 0; c < r_size; c++) {
+      M[R[c]] = 0;
+    }
+  };
+
+  if (!closed) {
+    restore();
+    state.set_true(cc::error_infinite_boundary);
+    state.set_true(cc::error_occurred);
+    return false;
+  }
+
+  if (p_size >= buf.p_maxsize) {
+    restore();
+    state.set_true(cc::error_p_overflow);
+    return false;
+  }
+
+  if (t_size - r_size + b_size > buf.t_maxsize) {
+    restore();
+    state.set_true(cc::error_t_overflow);
+    return false;
+  }
+
+  /* ---------------------------------------------------------------------- */
+  /// Fan
+  /* ---------------------------------------------------------------------- */
+
+  P[4 * p_size + 0] = bisector[0];
+  P[4 * p_size + 1] = bisector[1];
+  P[4 * p_size + 2] = bisector[2];
+  P[4 * p_size + 3] = bisector[3];
+  buf.O[p_size] = q_index;
+  const Tu plane = p_size;
+  p_size += 1;
+
+  // the j-th edge of the cycle gets the j-th removed slot, or a new one
+  const auto slot = [&](const unsigned short int j) -> unsigned short int {
+    return j < r_size ? R[j] : t_size + (j - r_size);
+  };
+
+  Tf nradius = 0.00f;
+
+  for (unsigned short int j = 0, e = 0; j < b_size; j++) {
+
+    const unsigned short int s = slot(j);
+    const unsigned short int n = B[4 * e + 2];
+
+    T[3 * s + 0] = B[4 * e + 0];
+    T[3 * s + 1] = B[4 * e + 1];
+    T[3 * s + 2] = plane;
+    A[3 * s + 0] = n;
+    A[3 * s + 1] = slot(j + 1 < b_size ? j + 1 : 0);
+    A[3 * s + 2] = slot(j > 0 ? j - 1 : b_size - 1);
+    A[3 * n + B[4 * e + 3]] = s;
+    M[s] = 0;
+
+    vertex<Tf, Tu>(P, T, V, s, px, py, pz);
+    nradius = V[4 * s + 3] > nradius ? V[4 * s + 3] : nradius;
+
+    dR[B[4 * e + 0]] = boundary::sentinel<Tu>();
+    e = dR[B[4 * e + 1]];
+
+  }
+
+  /* ---------------------------------------------------------------------- */
+  /// Compaction
+  /* ---------------------------------------------------------------------- */
+
+  // removed triangles left over are filled from the end of T
+  unsigned short int t_end = b_size > r_size ? t_size + (b_size - r_size)
+                                             : t_size;
+
+  for (unsigned short int c = b_size; c < r_size; c++) {
+
+    while (t_end > 0 && M[t_end - 1]) {
+      M[--t_end] = 0;
+    }
+
+    const unsigned short int h = R[c];
+    if (h >= t_end) continue;
+
+    const unsigned short int m = --t_end;
+    T[3 * h + 0] = T[3 * m + 0];
+    T[3 * h + 1] = T[3 * m + 1];
+    T[3 * h + 2] = T[3 * m + 2];
+    V[4 * h + 0] = V[4 * m + 0];
+    V[4 * h + 1] = V[4 * m + 1];
+    V[4 * h + 2] = V[4 * m + 2];
+    V[4 * h + 3] = V[4 * m + 3];
+    M[h] = 0;
+
+    for (int e = 0; e < 3; e++) {
+      const unsigned short int n = A[3 * m + e];
+      A[3 * h + e] = n;
+      for (int f = 0; f < 3; f++) {
+        if (A[3 * n + f] == m) A[3 * n + f] = h;
+      }
+    }
+
+  }
+
+  t_size = t_end;
+
+  if (lost) {
+    sradius = radius<Tf>(V, 0, t_size);
+  } else {
+    sradius = nradius > sradius ? nradius : sradius;
+  }
+
+  return true;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Same as above, growing 'buf' instead of failing when the cell overflows it.
+
+template <typename Ti, typename Tf, typename Tu>
+static inline bool clip_or_grow(
+  cc::state& state,
+  scratch<Tf, Tu>& buf,
+  unsigned short int& p_size,
+  unsigned short int& t_size,
+  const Tf px, const Tf py, const Tf pz,
+  const Tf* plane,
+  const int64_t p_index, const int64_t q_index,
+  Tf& sradius
+) {
+  while (!clip<Ti, Tf, Tu>(
+    state, buf, p_size, t_size, px, py, pz, plane, p_index, q_index, sradius
+  )) {
+    if (!buf.grow(state)) return false;
+  }
+  return true;
+}
+
+// Same as above, with the bisector of (p, q), made from the points p_index
+// and q_index.
+
+template <typename Ti, typename Tf, typename Tu>
+static inline bool clip_or_grow(
+  cc::state& state,
+  scratch<Tf, Tu>& buf,
+  unsigned short int& p_size,
+  unsigned short int& t_size,
+  const Tf px, const Tf py, const Tf pz,
+  const Tf qx, const Tf qy, const Tf qz,
+  const int64_t p_index, const int64_t q_index,
+  Tf& sradius
+) {
+  Tf bisector[4];
+  planes::bisect<Tf>(
+    bisector[0], bisector[1], bisector[2], bisector[3],
+    qx, qy, qz, px, py, pz
+  );
+  return clip_or_grow<Ti, Tf, Tu>(
+    state, buf, p_size, t_size, px, py, pz, bisector, p_index, q_index, 
+    sradius
+  );
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Sets up the initial cell, the box cut by the walls, and its security
+// radius, in the frame of origin o. Returns false if the walls overflow 'buf'
+// beyond its limits.
+
+template <typename Ti, typename Tf, typename Tu>
+static inline bool init(
+  cc::state& state,
+  scratch<Tf, Tu>& buf,
+  unsigned short int& p_size,
+  unsigned short int& t_size,
+  const struct args::cc& args,
+  const Tf px, const Tf py, const Tf pz,
+  const std::array<Tf,3>& o,
+  Tf& sradius
+) {
+
+  static const Tf p_init[] = {
     1,0,0,0, -1,0,0,1,
     0,1,0,0, 0,-1,0,1,
-    0,0,1,0, 0,0,-1,1 
+    0,0,1,0, 0,0,-1,1
   };
-  static const Tu t_init[] = { 
-    2,5,0, 5,3,0, 1,5,2, 5,1,3, 
-    4,2,0, 4,0,3, 2,4,1, 4,3,1 
+  static const Tu t_init[] = {
+    2,5,0, 5,3,0, 1,5,2, 5,1,3,
+    4,2,0, 4,0,3, 2,4,1, 4,3,1
   };
-  
+
   const unsigned short int p_initsize = sizeof(p_init) / (sizeof(*p_init) * 4);
   const unsigned short int t_initsize = sizeof(t_init) / (sizeof(*t_init) * 3);
 
-  const unsigned short int k = args.k;
-  const unsigned short int p_maxsize = args.p_maxsize;
-  const unsigned short int t_maxsize = args.t_maxsize;
+  static const auto a_init = []() {
+    std::array<unsigned short int, 3 * t_initsize> a;
+    link<Tu>(t_init, a.data(), t_initsize);
+    return a;
+  }();
 
-  unsigned short int p_size = p_initsize;
-  unsigned short int t_size = t_initsize; 
-  unsigned short int r_size = 0; 
+  Tf* P = buf.P.data();
+  Tu* T = buf.T.data();
+  Tf* V = buf.V.data();
 
-  cc::state& state = states[index];
+  std::copy(p_init, p_init + 4 * p_initsize, P);
+  for (unsigned short int j = 0; j < p_initsize; j++) {
+    P[4 * j + 3] = init_offset<Tf>(p_init + 4 * j, args, px, py, pz, o);
+  }
+  std::copy(t_init, t_init + 3 * t_initsize, T);
+  std::copy(a_init.begin(), a_init.end(), buf.A.begin());
+  std::fill(buf.O.begin(), buf.O.begin() + p_initsize, -1);
 
-  Tf vertex[4];
-  Tf bisector[4];
+  p_size = p_initsize;
+  t_size = t_initsize;
 
-  const Tf px = refset[index][0];
-  const Tf py = refset[index][1];
-  const Tf pz = refset[index][2];
- 
-  for (Ti j = 0; j < p_initsize; j++) {
-    P[4 * p_maxsize * i + 4 * j + 0] = p_init[4 * j + 0];
-    P[4 * p_maxsize * i + 4 * j + 1] = p_init[4 * j + 1];
-    P[4 * p_maxsize * i + 4 * j + 2] = p_init[4 * j + 2];
-    P[4 * p_maxsize * i + 4 * j + 3] = p_init[4 * j + 3];
+  buf.records.clear();
+  buf.vertices.clear();
+  buf.loops.clear();
+
+  for (unsigned short int j = 0; j < t_size; j++) {
+    vertex<Tf, Tu>(P, T, V, j, px, py, pz);
   }
+  sradius = radius<Tf>(V, 0, t_size);
 
-  for (Ti j = 0; j < t_initsize; j++) {
-    T[3 * t_maxsize * i + 3 * j + 0] = t_init[3 * j + 0];
-    T[3 * t_maxsize * i + 3 * j + 1] = t_init[3 * j + 1];
-    T[3 * t_maxsize * i + 3 * j + 2] = t_init[3 * j + 2];
+  for (int j = 0; j < args.nwalls; j++) {
+    Tf plane[4];
+    wall<Tf>(plane, args, j, o);
+    if (!clip_or_grow<Ti, Tf, Tu>(
+      state, buf, p_size, t_size, px, py, pz, plane, -1, -1, sradius
+    )) {
+      return false;
+    }
   }
 
-  for (Ti neighbor = 0; neighbor < k; neighbor++) {
-  
-    auto& q = knn[k * i + neighbor];
-    const Tf qx = xyzset[q][0];
-    const Tf qy = xyzset[q][1];
-    const Tf qz = xyzset[q][2];
+  return true;
 
-    r_size = 0;
-    Tf sradius = 0.00f;
-  
-    planes::bisect<Tf>(
-      bisector[0], bisector[1], bisector[2], bisector[3],
-      qx, qy, qz, px, py, pz
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Unit normal of plane f and the signed distance from p to it.
+
+template <typename Tf>
+static inline Tf distance(
+  const Tf* f, const Tf px, const Tf py, const Tf pz,
+  Tf& nx, Tf& ny, Tf& nz
+) {
+  const Tf norm = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+  nx = f[0] / norm;
+  ny = f[1] / norm;
+  nz = f[2] / norm;
+  return (f[0] * px + f[1] * py + f[2] * pz + f[3]) / norm;
+}
+
+/* ------------------------------------------------------------------------- */
+
+// A face is accumulated in 8 values: its signed area, its centroid weighted
+// by the area, relative to its first vertex, that first vertex, relative to
+// p, and whether it is set. Fanning from a vertex of the face rather than
+// from a point off it keeps small faces accurate.
+
+template <typename Tf>
+static inline void fan(
+  Tf* F,
+  const Tf nx, const Tf ny, const Tf nz, const Tf h,
+  const Tf ux, const Tf uy, const Tf uz,
+  const Tf wx, const Tf wy, const Tf wz
+) {
+
+  if (F[7] == 0.00f) {
+    F[4] = ux;
+    F[5] = uy;
+    F[6] = uz;
+    F[7] = 1.00f;
+  }
+
+  const Tf ax = ux - F[4], ay = uy - F[5], az = uz - F[6];
+  const Tf bx = wx - F[4], by = wy - F[5], bz = wz - F[6];
+
+  Tf a = 0.50f * (nx * (ay * bz - az * by) + 
+                  ny * (az * bx - ax * bz) + 
+                  nz * (ax * by - ay * bx));
+  if (h < 0.00f) a = -a;
+
+  F[0] += a;
+  F[1] += a * (ax + bx) / 3.00f;
+  F[2] += a * (ay + by) / 3.00f;
+  F[3] += a * (az + bz) / 3.00f;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Centroid of the face accumulated in 'F', relative to p.
+
+template <typename Tf>
+static inline void center(const Tf* F, Tf& cx, Tf& cy, Tf& cz) {
+  cx = F[4] + F[1] / F[0];
+  cy = F[5] + F[2] / F[0];
+  cz = F[6] + F[3] / F[0];
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Writes the face accumulated in 'F' on plane f to 'out' as (area,
+// centroid, unit normal towards the neighbor).
+
+template <typename Tf>
+static inline void pack(
+  Tf* out, const Tf* F, const Tf* f,
+  const Tf px, const Tf py, const Tf pz
+) {
+  Tf nx, ny, nz, cx, cy, cz;
+  const Tf h = distance<Tf>(f, px, py, pz, nx, ny, nz);
+  center<Tf>(F, cx, cy, cz);
+  // p is on the inner side of every plane
+  const Tf s = h < 0.00f ? 1.00f : -1.00f;
+  out[0] = std::fabs(F[0]);
+  out[1] = px + cx;
+  out[2] = py + cy;
+  out[3] = pz + cz;
+  out[4] = s * nx;
+  out[5] = s * ny;
+  out[6] = s * nz;
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Area and centroid of every face of the cell, accumulated in buf.F by plane
+// as in fan(). Each face is walked through the edges that leave each of its
+// vertices: edge e of triangle t joins the vertex of t to that of
+// A[3 * t + e] on face T[3 * t + e], so every edge of every face is visited
+// once, all in the same direction. The areas are signed by that direction,
+// which is the same for every face. Planes that are no longer on the cell
+// get a zero area.
+
+template <typename Tf, typename Tu>
+static inline void faces(
+  scratch<Tf, Tu>& buf,
+  const unsigned short int p_size,
+  const unsigned short int t_size,
+  const Tf px, const Tf py, const Tf pz
+) {
+
+  const Tf* P = buf.P.data();
+  const Tu* T = buf.T.data();
+  const Tf* V = buf.V.data();
+  const unsigned short int* A = buf.A.data();
+  Tf* F = buf.F.data();
+
+  std::fill(F, F + 8 * p_size, 0.00f);
+
+  for (unsigned short int t = 0; t < t_size; t++) {
+    for (int e = 0; e < 3; e++) {
+
+      const Tu f = T[3 * t + e];
+      const unsigned short int n = A[3 * t + e];
+
+      Tf nx, ny, nz;
+      const Tf h = distance<Tf>(P + 4 * f, px, py, pz, nx, ny, nz);
+
+      fan<Tf>(F + 8 * f, nx, ny, nz, h, 
+              V[4 * t + 0] - px, V[4 * t + 1] - py, V[4 * t + 2] - pz,
+              V[4 * n + 0] - px, V[4 * n + 1] - py, V[4 * n + 2] - pz);
+
+    }
+  }
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Volume, centroid and surface area of the cell, written to 'buf', from the
+// faces in buf.F. The cell is split into pyramids from p over its faces, the
+// centroid of each lying three quarters of the way to that of its face.
+
+template <typename Tf, typename Tu>
+static inline void measure(
+  scratch<Tf, Tu>& buf,
+  const unsigned short int p_size,
+  const Tf px, const Tf py, const Tf pz
+) {
+
+  const Tf* P = buf.P.data();
+  const Tf* F = buf.F.data();
+
+  Tf volume = 0.00f;
+  Tf area = 0.00f;
+  Tf cx = 0.00f, cy = 0.00f, cz = 0.00f;
+
+  for (unsigned short int f = 0; f < p_size; f++) {
+
+    if (F[8 * f + 0] == 0.00f) continue;
+
+    Tf nx, ny, nz, fx, fy, fz;
+    const Tf h = distance<Tf>(P + 4 * f, px, py, pz, nx, ny, nz);
+    center<Tf>(F + 8 * f, fx, fy, fz);
+    const Tf v = std::fabs(h) * F[8 * f + 0] / 3.00f;
+
+    area += F[8 * f + 0];
+    volume += v;
+    cx += 0.75f * v * fx;
+    cy += 0.75f * v * fy;
+    cz += 0.75f * v * fz;
+
+  }
+
+  buf.volume = std::fabs(volume);
+  buf.area = volume < 0.00f ? -area : area;
+  buf.centroid = {px + cx / volume, py + cy / volume, pz + cz / volume};
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Whether the neighbor that created plane f is written, given the faces in
+// buf.F.
+
+template <typename Tf, typename Tu>
+static inline bool keep(const scratch<Tf, Tu>& buf, const unsigned int f) {
+  return std::fabs(buf.F[8 * f + 0]) >= buf.min_face_area;
+}
+
+// Appends the face on plane f to buf.records.
+
+template <typename Tf, typename Tu>
+static inline void record(
+  scratch<Tf, Tu>& buf,
+  const unsigned int f,
+  const Tf px, const Tf py, const Tf pz
+) {
+
+  Tf out[7];
+  pack<Tf>(out, buf.F.data() + 8 * f, buf.P.data() + 4 * f, px, py, pz);
+  buf.records.insert(buf.records.end(), out, out + 7);
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Marks a face as listed in buf.S.
+static constexpr unsigned short int listed = 
+  std::numeric_limits<unsigned short int>::max();
+
+// Writes the vertices of the cell to buf.vertices, and one triangle on each
+// of its faces to buf.S. Faces that are no longer on the cell are marked as
+// listed, as are all of them if the cell is not complete, which then has no
+// vertices or faces.
+
+template <typename Tf, typename Tu>
+static inline void shape(
+  scratch<Tf, Tu>& buf,
+  const bool complete,
+  const unsigned short int p_size,
+  const unsigned short int t_size
+) {
+
+  const Tu* T = buf.T.data();
+  const Tf* V = buf.V.data();
+  unsigned short int* S = buf.S.data();
+
+  std::fill(S, S + p_size, listed);
+
+  buf.vertices.clear();
+  buf.loops.clear();
+  if (!complete) return;
+
+  buf.vertices.resize(3 * t_size);
+
+  for (unsigned short int t = 0; t < t_size; t++) {
+    buf.vertices[3 * t + 0] = V[4 * t + 0];
+    buf.vertices[3 * t + 1] = V[4 * t + 1];
+    buf.vertices[3 * t + 2] = V[4 * t + 2];
+    for (int e = 0; e < 3; e++) S[T[3 * t + e]] = t;
+  }
+
+}
+
+// Appends the face on plane f to buf.loops, going from triangle to triangle
+// across the edges that enter f, which turns counterclockwise seen from
+// outside of the cell, and marks it as listed.
+
+template <typename Tf, typename Tu>
+static inline void loop(scratch<Tf, Tu>& buf, const unsigned int f) {
+
+  const Tu* T = buf.T.data();
+  const unsigned short int* A = buf.A.data();
+
+  const unsigned short int t0 = buf.S[f];
+  if (t0 == listed) return;
+  buf.S[f] = listed;
+
+  const size_t head = buf.loops.size();
+  buf.loops.push_back(0);
+
+  unsigned short int t = t0;
+  do {
+    buf.loops.push_back(t);
+    int e = 0;
+    while (T[3 * t + (e + 1) % 3] != f) e++;
+    t = A[3 * t + e];
+  } while (t != t0);
+
+  buf.loops[head] = buf.loops.size() - head - 1;
+
+}
+
+// Appends the faces that are not listed yet.
+
+template <typename Tf, typename Tu>
+static inline void rest(
+  scratch<Tf, Tu>& buf, 
+  const unsigned short int p_size
+) {
+  for (unsigned short int f = 0; f < p_size; f++) loop<Tf, Tu>(buf, f);
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Wraps up a cell that reached the end of its clipping: stores its security
+// radius, and the faces, geometry and topology that were asked for.
+
+template <typename Tf, typename Tu>
+static inline void finish(
+  scratch<Tf, Tu>& buf,
+  const cc::state& state,
+  const unsigned short int p_size,
+  const unsigned short int t_size,
+  const Tf sradius,
+  const Tf px, const Tf py, const Tf pz
+) {
+  buf.radius = sradius;
+  if (buf.geometry || buf.faces || buf.min_face_area > 0.00f) {
+    faces<Tf, Tu>(buf, p_size, t_size, px, py, pz);
+  }
+  if (buf.geometry) {
+    measure<Tf, Tu>(buf, p_size, px, py, pz);
+  }
+  if (buf.topology) {
+    shape<Tf, Tu>(buf, state.get(cc::security_radius_reached), 
+                  p_size, t_size);
+  }
+}
+
+// Wraps up a cell that could not be clipped to the end. What is left in 'buf'
+// belongs to a partial cell, or to the previous one, so the cell reports NaN
+// and has no faces or polyhedron.
+
+template <typename Tf, typename Tu>
+static inline void fail(scratch<Tf, Tu>& buf) {
+  const Tf nan = std::numeric_limits<Tf>::quiet_NaN();
+  buf.radius = nan;
+  buf.volume = nan;
+  buf.centroid = {nan, nan, nan};
+  buf.area = nan;
+  buf.records.clear();
+  buf.vertices.clear();
+  buf.loops.clear();
+}
+
+// Moves what is reported of the cell from the frame of origin o back to that
+// of the box: its centroid, its vertices, and the centroids of its faces.
+// Called once the faces are recorded.
+
+template <typename Tf, typename Tu>
+static inline void shift(scratch<Tf, Tu>& buf, const std::array<Tf,3>& o) {
+  if (o[0] == 0.00f && o[1] == 0.00f && o[2] == 0.00f) return;
+  if (buf.geometry) {
+    for (int c = 0; c < 3; c++) buf.centroid[c] += o[c];
+  }
+  for (size_t j = 0; j < buf.vertices.size(); j++) {
+    buf.vertices[j] += o[j % 3];
+  }
+  for (size_t j = 0; j < buf.records.size(); j += 7) {
+    for (int c = 0; c < 3; c++) buf.records[j + 1 + c] += o[c];
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Face on plane f of the cell of SYCL work item i, written to 'out' as in
+// pack(). The kernels keep neither vertices nor adjacency, so the vertices
+// around f are recomputed and the triangle across each edge is searched for,
+// which is quadratic in the number of triangles. T starts at t_offs.
+
+template <typename Tf, typename Tu, typename Tp, typename Tt>
+static inline void face(
+  Tf* out,
+  const Tp& P, const size_t i, const size_t refsize,
+  const Tt& T, const size_t t_offs, const unsigned short int t_size,
+  const Tu f,
+  const Tf px, const Tf py, const Tf pz
+) {
+
+  const auto plane = [&](const Tu j, Tf* dst) {
+    for (int c = 0; c < 4; c++) dst[c] = P[4 * refsize * j + refsize * c + i];
+  };
+
+  const auto vertex = [&](const unsigned short int t, Tf* v) {
+    Tf p0[4], p1[4], p2[4], w;
+    plane(T[t_offs + 3 * t + 0], p0);
+    plane(T[t_offs + 3 * t + 1], p1);
+    plane(T[t_offs + 3 * t + 2], p2);
+    planes::intersect<Tf>(
+      v[0], v[1], v[2], w,
+      p0[0], p0[1], p0[2], p0[3],
+      p1[0], p1[1], p1[2], p1[3],
+      p2[0], p2[1], p2[2], p2[3]
     );
-    
-    for (short int t_index = 0; t_index < t_size; t_index++) {
-  
-      const Tu& t0 = T[3 * t_maxsize * i + 3 * t_index + 0];
-      const Tu& t1 = T[3 * t_maxsize * i + 3 * t_index + 1];
-      const Tu& t2 = T[3 * t_maxsize * i + 3 * t_index + 2];
-  
-      const Tf& plane_00 = P[4 * p_maxsize * i + 4 * t0 + 0];
-      const Tf& plane_01 = P[4 * p_maxsize * i + 4 * t0 + 1];
-      const Tf& plane_02 = P[4 * p_maxsize * i + 4 * t0 + 2];
-      const Tf& plane_03 = P[4 * p_maxsize * i + 4 * t0 + 3];
+  };
 
-      const Tf& plane_10 = P[4 * p_maxsize * i + 4 * t1 + 0];
-      const Tf& plane_11 = P[4 * p_maxsize * i + 4 * t1 + 1];
-      const Tf& plane_12 = P[4 * p_maxsize * i + 4 * t1 + 2];
-      const Tf& plane_13 = P[4 * p_maxsize * i + 4 * t1 + 3];
+  Tf fp[4];
+  plane(f, fp);
+  Tf nx, ny, nz;
+  const Tf h = distance<Tf>(fp, px, py, pz, nx, ny, nz);
 
-      const Tf& plane_20 = P[4 * p_maxsize * i + 4 * t2 + 0];
-      const Tf& plane_21 = P[4 * p_maxsize * i + 4 * t2 + 1];
-      const Tf& plane_22 = P[4 * p_maxsize * i + 4 * t2 + 2];
-      const Tf& plane_23 = P[4 * p_maxsize * i + 4 * t2 + 3];
+  Tf F[8] = {0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f};
 
-      // TODO : implement exception handling
-      planes::intersect<Tf>(
-        vertex[0], vertex[1], vertex[2], vertex[3], 
-        plane_00, plane_01, plane_02, plane_03,
-        plane_10, plane_11, plane_12, plane_13,
-        plane_20, plane_21, plane_22, plane_23
-      ); 
-      
-      const Tf& b0 = bisector[0];
-      const Tf& b1 = bisector[1];
-      const Tf& b2 = bisector[2];
-      const Tf& b3 = bisector[3];
-  
-      const Tf& v0 = vertex[0];
-      const Tf& v1 = vertex[1];
-      const Tf& v2 = vertex[2];
-      const Tf& v3 = vertex[3];
-  
-      const Tf dot_product = planes::dot(v0, v1, v2, v3, b0, b1, b2, b3);
-  
-      sradius = sr::update<Tf>(px, py, pz, v0, v1, v2, sradius);
-  
-      if (dot_product > 0.00f) {
-        t_size -= 1;
-        r_size += 1;
-        utils::swap(T[3 * t_maxsize * i + 3 * t_index + 0], 
-                    T[3 * t_maxsize * i + 3 * t_size  + 0]);
-        utils::swap(T[3 * t_maxsize * i + 3 * t_index + 1], 
-                    T[3 * t_maxsize * i + 3 * t_size  + 1]);
-        utils::swap(T[3 * t_maxsize * i + 3 * t_index + 2], 
-                    T[3 * t_maxsize * i + 3 * t_size  + 2]);
-        t_index -= 1;
+  for (unsigned short int t = 0; t < t_size; t++) {
+    for (int e = 0; e < 3; e++) {
+
+      if (T[t_offs + 3 * t + e] != f) continue;
+      const Tu b = T[t_offs + 3 * t + (e + 1) % 3];
+
+      // the triangle across runs through (b, f)
+      unsigned short int n = t;
+      for (unsigned short int m = 0; m < t_size && n == t; m++) {
+        for (int g = 0; g < 3; g++) {
+          if (T[t_offs + 3 * m + g] == b && 
+              T[t_offs + 3 * m + (g + 1) % 3] == f) {
+            n = m;
+          }
+        }
       }
+
+      Tf u[3], w[3];
+      vertex(t, u);
+      vertex(n, w);
+      fan<Tf>(F, nx, ny, nz, h, 
+              u[0] - px, u[1] - py, u[2] - pz, 
+              w[0] - px, w[1] - py, w[2] - pz);
+
+    }
+  }
+
+  pack<Tf>(out, F, fp, px, py, pz);
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+// Number of 32 bit words in a bitset over the planes of a cell.
+static inline constexpr int mask_words(const int p_size) {
+  return (p_size + 31) / 32;
+}
+
+// Sets the bit of every plane that is still used by one of the t_size
+// triangles starting at T[t_offs], after clearing the first p_size bits.
+template <typename Tt>
+static inline void mark_planes(
+  const Tt& T, const size_t t_offs, const unsigned short int t_size,
+  uint32_t* mask, const unsigned short int p_size
+) {
+  for (int w = 0; w < mask_words(p_size); w++) mask[w] = 0;
+  for (size_t j = t_offs; j < t_offs + 3 * size_t(t_size); j++) {
+    const unsigned int plane = T[j];
+    mask[plane >> 5] |= uint32_t(1) << (plane & 31);
+  }
+}
+
+static inline bool is_marked(const uint32_t* mask, const unsigned int plane) {
+  return (mask[plane >> 5] >> (plane & 31)) & 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+} // namespace internal
+} // namespace cci
+
+///////////////////////////////////////////////////////////////////////////////
+/// CPU Implementation                                                      ///
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Ti, typename Tf, typename Tu>
+void cci::compute(
+  const Ti i, const Ti index,
+  std::vector<cc::state>& states,
+  scratch<Tf, Tu>& buf,
+  std::vector<Ti>& knn,
+  std::vector<Ti>& dknn,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const Ti xyzsize,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const Ti refsize,
+  const struct args::cc& args,
+  snapshot<Ti, Tf, Tu>* snap
+) {
+  cci::compute<Ti, Tf, Tu>(
+    i, index, states, buf, knn, dknn,
+    static_cast<size_t>(args.k) * i,
+    xyzset, xyzsize, refset, refsize, args, snap
+  );
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf, typename Tu>
+void cci::compute(
+  const Ti i, const Ti index,
+  std::vector<cc::state>& states,
+  scratch<Tf, Tu>& buf,
+  std::vector<Ti>& knn,
+  std::vector<Ti>& dknn,
+  const size_t koffs,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const Ti xyzsize,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const Ti refsize,
+  const struct args::cc& args,
+  snapshot<Ti, Tf, Tu>* snap
+) {
+
+  (void) i;
+  (void) xyzsize;
+  (void) refsize;
   
-    }                                         
-    
-    if (r_size > 0) {
+  const unsigned short int k = args.k;
+  const size_t k0 = koffs;
 
-      if (p_size >= p_maxsize) {
-        state.set_true(cc::error_p_overflow);
-        return;
-      }
+  unsigned short int p_size = 0;
+  unsigned short int t_size = 0; 
 
-      P[4 * p_maxsize * i + 4 * p_size + 0] = bisector[0];
-      P[4 * p_maxsize * i + 4 * p_size + 1] = bisector[1];
-      P[4 * p_maxsize * i + 4 * p_size + 2] = bisector[2];
-      P[4 * p_maxsize * i + 4 * p_size + 3] = bisector[3];
-      dknn[k * i + neighbor] = p_size;
-      p_size += 1;
-  
-      const Ti dr_offs = p_maxsize * i;
-      for (Ti j = 0; j < p_maxsize; j++) {
-        dR[dr_offs + j] = boundary::bstatus::undefined;
-      }
+  cc::state& state = states[index];
 
-      short int head = -1;
-      boundary::bstatus bstat = boundary::compute<Ti, Tu>(
-        dR, dr_offs, p_maxsize, head,
-        T, 3 * t_maxsize * i + t_size * 3, r_size
-      );
-      r_size = 0;
-  
-      if (bstat == boundary::bstatus::unreachable) {
-        state.set_true(cc::error_infinite_boundary);
-        state.set_true(cc::error_occurred);
-        return;
-      }
-  
-      auto first = head;
-      while (true) {
+  const auto o = internal::origin<Tf>(args, refset[index]);
+  const Tf px = refset[index][0] - o[0];
+  const Tf py = refset[index][1] - o[1];
+  const Tf pz = refset[index][2] - o[2];
+ 
+  Tf sradius = 0.00f;
+  if (!internal::init<Ti, Tf, Tu>(
+    state, buf, p_size, t_size, args, px, py, pz, o, sradius
+  )) {
+    internal::fail<Tf, Tu>(buf);
+    return;
+  }
 
-        if (t_size >= t_maxsize) {
-          state.set_true(cc::error_t_overflow);
-          return;
-        }
-  
-        const auto nvertex_0 = head;
-        const auto nvertex_1 = dR[dr_offs + nvertex_0];
-        head = nvertex_1;
-  
-        T[3 * t_maxsize * i + 3 * t_size + 0] = nvertex_0;
-        T[3 * t_maxsize * i + 3 * t_size + 1] = nvertex_1;
-        T[3 * t_maxsize * i + 3 * t_size + 2] = p_size - 1;
-        
-        t_size += 1;
+  for (Ti neighbor = 0; neighbor < k; neighbor++) {
   
-        if (head == first) break;
-      }
+    // every point within reach has been clipped against
+    auto& q = knn[k0 + neighbor];
+    if (q == cc::k_undefined) {
+      state.set_true(cc::security_radius_reached);
+      break;
+    }
+    Tf qx = xyzset[q][0] - o[0];
+    Tf qy = xyzset[q][1] - o[1];
+    Tf qz = xyzset[q][2] - o[2];
+    internal::image<Tf>(args, qx, qy, qz, px, py, pz);
 
+    const unsigned short int p_prev = p_size;
+
+    if (!internal::clip_or_grow<Ti, Tf, Tu>(
+      state, buf, p_size, t_size, px, py, pz, qx, qy, qz, index, q, sradius
+    )) {
+      internal::fail<Tf, Tu>(buf);
+      return;
+    }
+
+    if (p_size > p_prev) {
+      dknn[k0 + neighbor] = p_prev;
     } else {
       state.set_true(cc::error_nonvalid_neighbor);
     }
@@ -196,37 +1314,325 @@ void cci::compute(
     if (state.get(cc::error_nonvalid_neighbor)) {
       state.set_false(cc::error_nonvalid_neighbor);
     }
-    if (sr::is_reached(px, py, pz, qx, qy, qz, sradius)) {
+    if (sr::is_reached(px, py, pz, qx, qy, qz, 
+                       sradius * sr::margin<Tf>(args.perturb))) {
       state.set_true(cc::security_radius_reached);
       break;
     }
   
   }
-  
-  for (Ti di = 0; di < k; di++) {
-    bool flag = true;
-    for (Ti ti = 0; ti < t_size; ti++) {
-      if (T[3 * t_maxsize * i + 3 * ti + 0] == dknn[k * i + di]) flag = false;
-      if (T[3 * t_maxsize * i + 3 * ti + 1] == dknn[k * i + di]) flag = false;
-      if (T[3 * t_maxsize * i + 3 * ti + 2] == dknn[k * i + di]) flag = false;
-    } if (flag) knn[k * i + di] = cc::k_undefined;
+
+  internal::finish<Tf, Tu>(buf, state, p_size, t_size, sradius, px, py, pz);
+
+  const Tf* cP = buf.P.data();
+  const Tu* cT = buf.T.data();
+
+  if (snap != nullptr && !state.get(cc::security_radius_reached)) {
+    const auto& q = xyzset[knn[k0 + k - 1]];
+    Tf qx = q[0] - o[0], qy = q[1] - o[1], qz = q[2] - o[2];
+    internal::image<Tf>(args, qx, qy, qz, px, py, pz);
+    snap->push(
+      index, xyzset::get_distance(px, py, pz, qx, qy, qz),
+      cP, p_size, cT, t_size
+    );
+    Ti* owner = snap->owner.data() + snap->poffs[snap->size() - 1];
+    for (Ti di = 0; di < k; di++) {
+      const auto plane = dknn[k0 + di];
+      if (plane == __INTERNAL__K_UNDEFINED) continue;
+      owner[plane] = knn[k0 + di];
+    }
   }
+  
+  // planes are created in neighbor order, so keeping the neighbors whose
+  // plane is still on the cell also lists them in plane order.
+  uint32_t* mask = buf.U.data();
+  internal::mark_planes(cT, 0, t_size, mask, p_size);
+
+  const bool use_faces = buf.faces || buf.min_face_area > 0.00f;
 
   Ti dnn_counter = 0;
   for (Ti di = 0; di < k; di++) {
-    if (knn[k * i + di] == cc::k_undefined) continue;
-    knn[k * i + dnn_counter] = knn[k * i + di];
+    const Ti plane = dknn[k0 + di];
+    if (plane < 0 || plane >= p_size) continue;
+    if (!internal::is_marked(mask, plane)) continue;
+    if (use_faces && !internal::keep(buf, plane)) continue;
+    if (buf.faces) internal::record<Tf, Tu>(buf, plane, px, py, pz);
+    if (buf.topology) internal::loop<Tf, Tu>(buf, plane);
+    knn[k0 + dnn_counter] = knn[k0 + di];
     dnn_counter += 1;
   }
   for (Ti di = dnn_counter; di < k; di++) {
-    knn[k * i + di] = cc::k_undefined;
+    knn[k0 + di] = cc::k_undefined;
   }
+  if (buf.topology) internal::rest<Tf, Tu>(buf, p_size);
+
+  internal::shift<Tf, Tu>(buf, o);
   
 }
 
+/* ------------------------------------------------------------------------- */
+
 template <typename Ti, typename Tf, typename Tu>
 void cci::compute(
   const Ti i, const Ti index,
+  std::vector<cc::state>& states,
+  scratch<Tf, Tu>& buf,
+  knni::stream<Ti, Tf>& stream,
+  std::vector<Ti>& dknn,
+  std::vector<Ti>& dnn,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const Ti xyzsize,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const Ti refsize,
+  const struct args::cc& args
+) {
+
+  (void) i;
+  (void) xyzsize;
+  (void) refsize;
+
+  unsigned short int p_size = 0;
+  unsigned short int t_size = 0; 
+
+  cc::state& state = states[index];
+
+  const auto o = internal::origin<Tf>(args, refset[index]);
+  const Tf px = refset[index][0] - o[0];
+  const Tf py = refset[index][1] - o[1];
+  const Tf pz = refset[index][2] - o[2];
+
+  Tf sradius = 0.00f;
+  bool success = internal::init<Ti, Tf, Tu>(
+    state, buf, p_size, t_size, args, px, py, pz, o, sradius
+  );
+  const unsigned short int p_initsize = p_size;
+
+  stream.reset(index, refset[index]);
+
+  Ti q = 0;
+  Tf pq = 0;
+  while (success) {
+
+    // every point has been clipped against, so the cell is exact.
+    if (!stream.next(q, pq)) {
+      state.set_true(cc::security_radius_reached);
+      break;
+    }
+
+    Tf qx = xyzset[q][0] - o[0];
+    Tf qy = xyzset[q][1] - o[1];
+    Tf qz = xyzset[q][2] - o[2];
+    internal::image<Tf>(args, qx, qy, qz, px, py, pz);
+
+    const unsigned short int p_prev = p_size;
+
+    if (!internal::clip_or_grow<Ti, Tf, Tu>(
+      state, buf, p_size, t_size, px, py, pz, qx, qy, qz, index, q, sradius
+    )) {
+      success = false;
+      break;
+    }
+
+    // dknn maps a plane of the cell to the neighbor that created it
+    if (p_size > p_prev) {
+      if (dknn.size() < p_size) dknn.resize(buf.p_maxsize);
+      dknn[p_prev] = q;
+    }
+
+    if (sr::is_reached(px, py, pz, qx, qy, qz, 
+                       sradius * sr::margin<Tf>(args.perturb))) {
+      state.set_true(cc::security_radius_reached);
+      break;
+    }
+
+  }
+
+  internal::finish<Tf, Tu>(buf, state, p_size, t_size, sradius, px, py, pz);
+
+  dnn.clear();
+
+  // a failed cell reports its k nearest neighbors instead, which is what the
+  // fixed size path leaves behind in the same situation.
+  if (!success) {
+    stream.reset(index, refset[index]);
+    for (int n = 0; n < args.k && stream.next(q, pq); n++) {
+      dnn.push_back(q);
+    }
+    internal::fail<Tf, Tu>(buf);
+    return;
+  }
+
+  const bool use_faces = buf.faces || buf.min_face_area > 0.00f;
+
+  uint32_t* mask = buf.U.data();
+  internal::mark_planes(buf.T.data(), 0, t_size, mask, p_size);
+  for (unsigned short int pi = p_initsize; pi < p_size; pi++) {
+    if (!internal::is_marked(mask, pi)) continue;
+    if (use_faces && !internal::keep(buf, pi)) continue;
+    if (buf.faces) internal::record<Tf, Tu>(buf, pi, px, py, pz);
+    if (buf.topology) internal::loop<Tf, Tu>(buf, pi);
+    dnn.push_back(dknn[pi]);
+  }
+  if (buf.topology) internal::rest<Tf, Tu>(buf, p_size);
+
+  internal::shift<Tf, Tu>(buf, o);
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf, typename Tu>
+Tf cci::radius(
+  const Tf* P, const Tu* T, const unsigned short int t_size,
+  const std::array<Tf,3>& q,
+  const struct args::cc& args
+) {
+
+  const auto o = internal::origin<Tf>(args, q);
+  const std::array<Tf,3> p = {q[0] - o[0], q[1] - o[1], q[2] - o[2]};
+
+  Tf vertex[4];
+  Tf sradius = 0.00f;
+
+  for (unsigned short int t_index = 0; t_index < t_size; t_index++) {
+
+    const Tu& t0 = T[3 * t_index + 0];
+    const Tu& t1 = T[3 * t_index + 1];
+    const Tu& t2 = T[3 * t_index + 2];
+
+    planes::intersect<Tf>(
+      vertex[0], vertex[1], vertex[2], vertex[3], 
+      P[4 * t0 + 0], P[4 * t0 + 1], P[4 * t0 + 2], P[4 * t0 + 3],
+      P[4 * t1 + 0], P[4 * t1 + 1], P[4 * t1 + 2], P[4 * t1 + 3],
+      P[4 * t2 + 0], P[4 * t2 + 1], P[4 * t2 + 2], P[4 * t2 + 3]
+    ); 
+
+    sradius = sr::update<Tf>(
+      p[0], p[1], p[2], vertex[0], vertex[1], vertex[2], sradius
+    );
+
+  }
+
+  return sradius;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf, typename Tu>
+Tf cci::resume(
+  const Ti index,
+  std::vector<cc::state>& states,
+  scratch<Tf, Tu>& buf,
+  std::vector<Ti>& owner,
+  unsigned short int p_size,
+  unsigned short int t_size,
+  const std::vector<Ti>& candidates, const size_t csize,
+  std::vector<Ti>& dnn,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const struct args::cc& args
+) {
+
+  cc::state& state = states[index];
+
+  const auto o = internal::origin<Tf>(args, refset[index]);
+  const Tf px = refset[index][0] - o[0];
+  const Tf py = refset[index][1] - o[1];
+  const Tf pz = refset[index][2] - o[2];
+
+  for (unsigned short int j = 0; j < t_size; j++) {
+    internal::vertex<Tf, Tu>(
+      buf.P.data(), buf.T.data(), buf.V.data(), j, px, py, pz
+    );
+  }
+  internal::link<Tu>(buf.T.data(), buf.A.data(), t_size);
+  Tf sradius = internal::radius<Tf>(buf.V.data(), 0, t_size);
+  for (unsigned short int pi = 0; pi < p_size; pi++) {
+    buf.O[pi] = owner[pi] == cc::k_undefined ? -1 : owner[pi];
+  }
+
+  size_t c = 0;
+  bool success = true;
+
+  for (; c < csize; c++) {
+
+    const Ti q = candidates[c];
+    Tf qx = xyzset[q][0] - o[0];
+    Tf qy = xyzset[q][1] - o[1];
+    Tf qz = xyzset[q][2] - o[2];
+    internal::image<Tf>(args, qx, qy, qz, px, py, pz);
+
+    const unsigned short int p_prev = p_size;
+
+    if (!internal::clip_or_grow<Ti, Tf, Tu>(
+      state, buf, p_size, t_size, px, py, pz, qx, qy, qz, index, q, sradius
+    )) {
+      success = false;
+      break;
+    }
+
+    if (p_size > p_prev) {
+      if (owner.size() < p_size) owner.resize(buf.p_maxsize);
+      owner[p_prev] = q;
+    }
+
+    if (sr::is_reached(px, py, pz, qx, qy, qz, 
+                       sradius * sr::margin<Tf>(args.perturb))) {
+      break;
+    }
+
+  }
+
+  // running out of candidates is fine, as they cover the security radius of
+  // the state the cell was resumed from.
+  if (success) {
+    state.set_true(cc::security_radius_reached);
+  }
+
+  internal::finish<Tf, Tu>(buf, state, p_size, t_size, sradius, px, py, pz);
+
+  uint32_t* mask = buf.U.data();
+  internal::mark_planes(buf.T.data(), 0, t_size, mask, p_size);
+
+  const bool use_faces = buf.faces || buf.min_face_area > 0.00f;
+
+  dnn.clear();
+  buf.records.clear();
+  for (unsigned short int pi = 0; pi < p_size; pi++) {
+    if (owner[pi] == cc::k_undefined) continue;
+    if (!internal::is_marked(mask, pi)) continue;
+    if (use_faces && !internal::keep(buf, pi)) continue;
+    if (buf.faces) internal::record<Tf, Tu>(buf, pi, px, py, pz);
+    if (buf.topology) internal::loop<Tf, Tu>(buf, pi);
+    dnn.push_back(owner[pi]);
+  }
+  if (buf.topology) internal::rest<Tf, Tu>(buf, p_size);
+
+  internal::shift<Tf, Tu>(buf, o);
+
+  // a failed cell also keeps the candidates it did not get to, so that the
+  // output stays a superset of its neighbors.
+  if (!success) {
+    internal::fail<Tf, Tu>(buf);
+    for (; c < csize; c++) {
+      dnn.push_back(candidates[c]);
+    }
+  }
+
+  return sradius;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+///////////////////////////////////////////////////////////////////////////////
+/// SYCL Implementation                                                     ///
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Ti, typename Tf, typename Tu>
+void cci::compute(
+  const size_t i, const Ti index,
   const device_accessor_readwrite_t<cc::state>& states, 
   const device_accessor_readwrite_t<Tf>& P,
   const device_accessor_readwrite_t<Tu>& T,
@@ -234,13 +1640,12 @@ void cci::compute(
   const device_accessor_readwrite_t<Ti>& knn,
   const device_accessor_readwrite_t<Ti>& dknn,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
-  const struct args::cc& args
+  const size_t refsize,
+  const struct args::device_cc<Tf>& args
 ) {
   
-  // TODO : make this swappable for future
   static const Tf p_init[] = { 
     1,0,0,0, -1,0,0,1,
     0,1,0,0, 0,-1,0,1,
@@ -267,15 +1672,19 @@ void cci::compute(
   Tf vertex[4];
   Tf bisector[4];
 
-  const Tf px = refset[refsize * 0 + index];
-  const Tf py = refset[refsize * 1 + index];
-  const Tf pz = refset[refsize * 2 + index];
+  const auto o = internal::origin<Tf>(args, {refset[refsize * 0 + index],
+                                             refset[refsize * 1 + index],
+                                             refset[refsize * 2 + index]});
+  const Tf px = refset[refsize * 0 + index] - o[0];
+  const Tf py = refset[refsize * 1 + index] - o[1];
+  const Tf pz = refset[refsize * 2 + index] - o[2];
   
   for (Ti j = 0; j < p_initsize; j++) {
     P[4 * refsize * j + refsize * 0 + i] = p_init[4 * j + 0];
     P[4 * refsize * j + refsize * 1 + i] = p_init[4 * j + 1];
     P[4 * refsize * j + refsize * 2 + i] = p_init[4 * j + 2];
-    P[4 * refsize * j + refsize * 3 + i] = p_init[4 * j + 3];
+    P[4 * refsize * j + refsize * 3 + i] = 
+      internal::init_offset<Tf>(p_init + 4 * j, args, px, py, pz, o);
   }
 
   for (Ti j = 0; j < t_initsize; j++) {
@@ -284,20 +1693,36 @@ void cci::compute(
     T[3 * t_maxsize * i + 3 * j + 2] = t_init[3 * j + 2];
   }
   
-  for (Ti neighbor = 0; neighbor < k; neighbor++) {
-  
-    auto& q = knn[k * i + neighbor];
-    const Tf qx = xyzset[xyzsize * 0 + q];
-    const Tf qy = xyzset[xyzsize * 1 + q];
-    const Tf qz = xyzset[xyzsize * 2 + q];
+  // the walls are clipped against first, in the first args.nwalls steps,
+  // keeping their positive side
+  for (Ti n = 0; n < args.nwalls + k; n++) {
+
+    const bool wall = n < args.nwalls;
+    const Ti neighbor = n - args.nwalls;
+
+    Tf qx = px, qy = py, qz = pz;
+    Ti q_index = -1;
+    if (wall) {
+      internal::wall<Tf>(bisector, args, n, o);
+    } else {
+      auto& q = knn[k * i + neighbor];
+      if (q == cc::k_undefined) {
+        state.set_true(cc::security_radius_reached);
+        break;
+      }
+      q_index = q;
+      qx = xyzset[xyzsize * 0 + q] - o[0];
+      qy = xyzset[xyzsize * 1 + q] - o[1];
+      qz = xyzset[xyzsize * 2 + q] - o[2];
+      internal::image<Tf>(args, qx, qy, qz, px, py, pz);
+      planes::bisect<Tf>(
+        bisector[0], bisector[1], bisector[2], bisector[3],
+        qx, qy, qz, px, py, pz
+      );
+    }
   
     r_size = 0;
     Tf sradius = 0.00f;
-  
-    planes::bisect<Tf>(
-      bisector[0], bisector[1], bisector[2], bisector[3],
-      qx, qy, qz, px, py, pz
-    );
     
     for (short int t_index = 0; t_index < t_size; t_index++) {
   
@@ -339,10 +1764,34 @@ void cci::compute(
       const Tf& v3 = vertex[3];
   
       const Tf dot_product = planes::dot(v0, v1, v2, v3, b0, b1, b2, b3);
+
+      if (args.flag_uncertain && planes::uncertain(
+        dot_product, v0, v1, v2, v3, b0, b1, b2, b3, 
+        px * px + py * py + pz * pz
+      )) {
+        state.set_true(cc::uncertain_orientation);
+      }
+
+      bool cut = dot_product > 0.00f;
+      if (args.perturb && !wall && planes::uncertain(
+        dot_product, v0, v1, v2, v3, b0, b1, b2, b3, 
+        px * px + py * py + pz * pz
+      )) {
+        const int sign = planes::perturbed<Tf, Ti>(
+          plane_00, plane_01, plane_02, 
+          internal::owner<Ti>(knn, dknn, k * i, 1, neighbor, t0),
+          plane_10, plane_11, plane_12, 
+          internal::owner<Ti>(knn, dknn, k * i, 1, neighbor, t1),
+          plane_20, plane_21, plane_22, 
+          internal::owner<Ti>(knn, dknn, k * i, 1, neighbor, t2),
+          b0, b1, b2, q_index, index
+        );
+        if (sign != 0) cut = sign > 0;
+      }
   
       sradius = sr::update<Tf>(px, py, pz, v0, v1, v2, sradius);
   
-      if (dot_product > 0.00f) {
+      if (cut) {
         t_size -= 1;
         r_size += 1;
         utils::swap(T[3 * t_maxsize * i + t_index * 3 + 0], 
@@ -367,12 +1816,12 @@ void cci::compute(
       P[4 * refsize * p_size + refsize * 1 + i] = bisector[1];
       P[4 * refsize * p_size + refsize * 2 + i] = bisector[2];
       P[4 * refsize * p_size + refsize * 3 + i] = bisector[3];
-      dknn[k * i + neighbor] = p_size;
+      if (!wall) dknn[k * i + neighbor] = p_size;
       p_size += 1;
   
-      const Ti dr_offs = p_maxsize * i;
+      const size_t dr_offs = p_maxsize * i;
       for (Ti j = 0; j < p_maxsize; j++) {
-        dR[dr_offs + j] = boundary::bstatus::undefined;
+        dR[dr_offs + j] = boundary::sentinel<Tu>();
       }
 
       short int head = -1;
@@ -409,7 +1858,7 @@ void cci::compute(
         if (head == first) break;
       }
 
-    } else {
+    } else if (!wall) {
       state.set_true(cc::error_nonvalid_neighbor);
     }
   
@@ -419,25 +1868,22 @@ void cci::compute(
     if (state.get(cc::error_nonvalid_neighbor)) {
       state.set_false(cc::error_nonvalid_neighbor);
     }
-    if (sr::is_reached(px, py, pz, qx, qy, qz, sradius)) {
+    if (!wall && sr::is_reached(px, py, pz, qx, qy, qz, 
+                                sradius * sr::margin<Tf>(args.perturb))) {
       state.set_true(cc::security_radius_reached);
       break;
     }
   
   }
   
-  for (Ti di = 0; di < k; di++) {
-    bool flag = true;
-    for (Ti ti = 0; ti < t_size; ti++) {
-      if (T[3 * t_maxsize * i + 3 * ti + 0] == dknn[k * i + di]) flag = false;
-      if (T[3 * t_maxsize * i + 3 * ti + 1] == dknn[k * i + di]) flag = false;
-      if (T[3 * t_maxsize * i + 3 * ti + 2] == dknn[k * i + di]) flag = false;
-    } if (flag) knn[k * i + di] = cc::k_undefined;
-  }
+  uint32_t mask[internal::mask_words(boundary::sentinel<Tu>())];
+  internal::mark_planes(T, 3 * t_maxsize * i, t_size, mask, p_size);
 
   Ti dnn_counter = 0;
   for (Ti di = 0; di < k; di++) {
-    if (knn[k * i + di] == cc::k_undefined) continue;
+    const Ti plane = dknn[k * i + di];
+    if (plane < 0 || plane >= p_size) continue;
+    if (!internal::is_marked(mask, plane)) continue;
     knn[k * i + dnn_counter] = knn[k * i + di];
     dnn_counter += 1;
   }
@@ -453,21 +1899,22 @@ void cci::compute(
 
 template <typename Ti, typename Tf, typename Tu>
 void cci::compute(
-  const Ti i, const Ti l_i, const Ti index,
+  const size_t i, const size_t l_i, const Ti index,
   const device_accessor_readwrite_t<cc::state>& states, 
-  const device_accessor_readwrite_t<Tf>& P,
+  const device_accessor_readwrite_t<Tf>& P, const size_t poffs,
   const device_accessor_readwrite_t<Tu>& T,
   const sycl::local_accessor<Tu, 1>& dR,
-  const device_accessor_readwrite_t<Ti>& knn, const Ti koffs,
+  const sycl::local_accessor<Tu, 1>& dE,
+  const device_accessor_readwrite_t<Ti>& knn, const size_t koffs,
   const device_accessor_readwrite_t<Ti>& dknn,
+  const device_accessor_readwrite_t<Tf>& F, const bool faces,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
-  const struct args::cc& args
+  const size_t refsize,
+  const struct args::device_cc<Tf>& args
 ) {
   
-  // TODO : make this swappable for future
   static const Tf p_init[] = { 
     1,0,0,0, -1,0,0,1,
     0,1,0,0, 0,-1,0,1,
@@ -494,15 +1941,19 @@ void cci::compute(
   Tf vertex[4];
   Tf bisector[4];
 
-  const Tf px = refset[refsize * 0 + index];
-  const Tf py = refset[refsize * 1 + index];
-  const Tf pz = refset[refsize * 2 + index];
+  const auto o = internal::origin<Tf>(args, {refset[refsize * 0 + index],
+                                             refset[refsize * 1 + index],
+                                             refset[refsize * 2 + index]});
+  const Tf px = refset[refsize * 0 + index] - o[0];
+  const Tf py = refset[refsize * 1 + index] - o[1];
+  const Tf pz = refset[refsize * 2 + index] - o[2];
   
   for (Ti j = 0; j < p_initsize; j++) {
-    P[4 * refsize * j + refsize * 0 + i] = p_init[4 * j + 0];
-    P[4 * refsize * j + refsize * 1 + i] = p_init[4 * j + 1];
-    P[4 * refsize * j + refsize * 2 + i] = p_init[4 * j + 2];
-    P[4 * refsize * j + refsize * 3 + i] = p_init[4 * j + 3];
+    P[4 * poffs * j + poffs * 0 + i] = p_init[4 * j + 0];
+    P[4 * poffs * j + poffs * 1 + i] = p_init[4 * j + 1];
+    P[4 * poffs * j + poffs * 2 + i] = p_init[4 * j + 2];
+    P[4 * poffs * j + poffs * 3 + i] = 
+      internal::init_offset<Tf>(p_init + 4 * j, args, px, py, pz, o);
   }
 
   for (Ti j = 0; j < t_initsize; j++) {
@@ -510,21 +1961,48 @@ void cci::compute(
     T[3 * t_maxsize * i + 3 * j + 1] = t_init[3 * j + 1];
     T[3 * t_maxsize * i + 3 * j + 2] = t_init[3 * j + 2];
   }
+
+  // the cycle and the edge table are cleared once per cell, after which
+  // boundary::extract and the fan below only reset the entries they use.
+  const size_t dr_offs = p_maxsize * l_i;
+  const size_t de_offs = 2 * boundary::table_size * l_i;
+  for (Ti j = 0; j < p_maxsize; j++) {
+    dR[dr_offs + j] = boundary::sentinel<Tu>();
+  }
+  for (Ti j = 0; j < 2 * boundary::table_size; j++) {
+    dE[de_offs + j] = boundary::sentinel<Tu>();
+  }
   
-  for (Ti neighbor = 0; neighbor < k; neighbor++) {
-  
-    auto& q = knn[koffs * neighbor + i];
-    const Tf qx = xyzset[xyzsize * 0 + q];
-    const Tf qy = xyzset[xyzsize * 1 + q];
-    const Tf qz = xyzset[xyzsize * 2 + q];
+  // the walls are clipped against first, in the first args.nwalls steps,
+  // keeping their positive side
+  for (Ti n = 0; n < args.nwalls + k; n++) {
+
+    const bool wall = n < args.nwalls;
+    const Ti neighbor = n - args.nwalls;
+
+    Tf qx = px, qy = py, qz = pz;
+    Ti q_index = -1;
+    if (wall) {
+      internal::wall<Tf>(bisector, args, n, o);
+    } else {
+      auto& q = knn[koffs * neighbor + i];
+      if (q == cc::k_undefined) {
+        state.set_true(cc::security_radius_reached);
+        break;
+      }
+      q_index = q;
+      qx = xyzset[xyzsize * 0 + q] - o[0];
+      qy = xyzset[xyzsize * 1 + q] - o[1];
+      qz = xyzset[xyzsize * 2 + q] - o[2];
+      internal::image<Tf>(args, qx, qy, qz, px, py, pz);
+      planes::bisect<Tf>(
+        bisector[0], bisector[1], bisector[2], bisector[3],
+        qx, qy, qz, px, py, pz
+      );
+    }
   
     r_size = 0;
     Tf sradius = 0.00f;
-  
-    planes::bisect<Tf>(
-      bisector[0], bisector[1], bisector[2], bisector[3],
-      qx, qy, qz, px, py, pz
-    );
     
     for (short int t_index = 0; t_index < t_size; t_index++) {
   
@@ -532,20 +2010,20 @@ void cci::compute(
       const Tu& t1 = T[3 * t_maxsize * i + t_index * 3 + 1];
       const Tu& t2 = T[3 * t_maxsize * i + t_index * 3 + 2];
   
-      const Tf& plane_00 = P[4 * refsize * t0 + refsize * 0 + i];
-      const Tf& plane_01 = P[4 * refsize * t0 + refsize * 1 + i];
-      const Tf& plane_02 = P[4 * refsize * t0 + refsize * 2 + i];
-      const Tf& plane_03 = P[4 * refsize * t0 + refsize * 3 + i];
+      const Tf& plane_00 = P[4 * poffs * t0 + poffs * 0 + i];
+      const Tf& plane_01 = P[4 * poffs * t0 + poffs * 1 + i];
+      const Tf& plane_02 = P[4 * poffs * t0 + poffs * 2 + i];
+      const Tf& plane_03 = P[4 * poffs * t0 + poffs * 3 + i];
 
-      const Tf& plane_10 = P[4 * refsize * t1 + refsize * 0 + i];
-      const Tf& plane_11 = P[4 * refsize * t1 + refsize * 1 + i];
-      const Tf& plane_12 = P[4 * refsize * t1 + refsize * 2 + i];
-      const Tf& plane_13 = P[4 * refsize * t1 + refsize * 3 + i];
+      const Tf& plane_10 = P[4 * poffs * t1 + poffs * 0 + i];
+      const Tf& plane_11 = P[4 * poffs * t1 + poffs * 1 + i];
+      const Tf& plane_12 = P[4 * poffs * t1 + poffs * 2 + i];
+      const Tf& plane_13 = P[4 * poffs * t1 + poffs * 3 + i];
 
-      const Tf& plane_20 = P[4 * refsize * t2 + refsize * 0 + i];
-      const Tf& plane_21 = P[4 * refsize * t2 + refsize * 1 + i];
-      const Tf& plane_22 = P[4 * refsize * t2 + refsize * 2 + i];
-      const Tf& plane_23 = P[4 * refsize * t2 + refsize * 3 + i];
+      const Tf& plane_20 = P[4 * poffs * t2 + poffs * 0 + i];
+      const Tf& plane_21 = P[4 * poffs * t2 + poffs * 1 + i];
+      const Tf& plane_22 = P[4 * poffs * t2 + poffs * 2 + i];
+      const Tf& plane_23 = P[4 * poffs * t2 + poffs * 3 + i];
   
       // TODO : implement exception handling
       planes::intersect<Tf>(
@@ -566,10 +2044,34 @@ void cci::compute(
       const Tf& v3 = vertex[3];
   
       const Tf dot_product = planes::dot(v0, v1, v2, v3, b0, b1, b2, b3);
+
+      if (args.flag_uncertain && planes::uncertain(
+        dot_product, v0, v1, v2, v3, b0, b1, b2, b3, 
+        px * px + py * py + pz * pz
+      )) {
+        state.set_true(cc::uncertain_orientation);
+      }
+
+      bool cut = dot_product > 0.00f;
+      if (args.perturb && !wall && planes::uncertain(
+        dot_product, v0, v1, v2, v3, b0, b1, b2, b3, 
+        px * px + py * py + pz * pz
+      )) {
+        const int sign = planes::perturbed<Tf, Ti>(
+          plane_00, plane_01, plane_02, 
+          internal::owner<Ti>(knn, dknn, i, koffs, neighbor, t0),
+          plane_10, plane_11, plane_12, 
+          internal::owner<Ti>(knn, dknn, i, koffs, neighbor, t1),
+          plane_20, plane_21, plane_22, 
+          internal::owner<Ti>(knn, dknn, i, koffs, neighbor, t2),
+          b0, b1, b2, q_index, index
+        );
+        if (sign != 0) cut = sign > 0;
+      }
   
       sradius = sr::update<Tf>(px, py, pz, v0, v1, v2, sradius);
   
-      if (dot_product > 0.00f) {
+      if (cut) {
         t_size -= 1;
         r_size += 1;
         utils::swap(T[3 * t_maxsize * i + t_index * 3 + 0], 
@@ -590,24 +2092,26 @@ void cci::compute(
         return;
       }
 
-      P[4 * refsize * p_size + refsize * 0 + i] = bisector[0];
-      P[4 * refsize * p_size + refsize * 1 + i] = bisector[1];
-      P[4 * refsize * p_size + refsize * 2 + i] = bisector[2];
-      P[4 * refsize * p_size + refsize * 3 + i] = bisector[3];
-      dknn[koffs * neighbor + i] = p_size;
+      P[4 * poffs * p_size + poffs * 0 + i] = bisector[0];
+      P[4 * poffs * p_size + poffs * 1 + i] = bisector[1];
+      P[4 * poffs * p_size + poffs * 2 + i] = bisector[2];
+      P[4 * poffs * p_size + poffs * 3 + i] = bisector[3];
+      if (!wall) dknn[koffs * neighbor + i] = p_size;
       p_size += 1;
   
-      const Ti dr_offs = p_maxsize * l_i;
-      for (Ti j = 0; j < p_maxsize; j++) {
-        dR[dr_offs + j] = boundary::bstatus::undefined;
-      }
-
       short int head = -1;
-      boundary::bstatus bstat = boundary::compute<Ti, Tu>(
-        dR, dr_offs, p_maxsize, head,
-        T, 3 * t_maxsize * i + t_size * 3, r_size
+      boundary::bstatus bstat = boundary::extract<Ti, Tu>(
+        dR, dr_offs, head,
+        T, 3 * t_maxsize * i + t_size * 3, r_size,
+        dE, de_offs
       );
       r_size = 0;
+
+      // more triangles than the edge table holds, left to the CPU
+      if (bstat == boundary::bstatus::overflow) {
+        state.set_true(cc::error_t_overflow);
+        return;
+      }
   
       if (bstat == boundary::bstatus::unreachable) {
         state.set_true(cc::error_infinite_boundary);
@@ -625,6 +2129,7 @@ void cci::compute(
   
         const auto nvertex_0 = head;
         const auto nvertex_1 = dR[dr_offs + nvertex_0];
+        dR[dr_offs + nvertex_0] = boundary::sentinel<Tu>();
         head = nvertex_1;
   
         T[3 * t_maxsize * i + t_size * 3 + 0] = nvertex_0;
@@ -636,7 +2141,7 @@ void cci::compute(
         if (head == first) break;
       }
 
-    } else {
+    } else if (!wall) {
       state.set_true(cc::error_nonvalid_neighbor);
     }
   
@@ -646,32 +2151,38 @@ void cci::compute(
     if (state.get(cc::error_nonvalid_neighbor)) {
       state.set_false(cc::error_nonvalid_neighbor);
     }
-    if (sr::is_reached(px, py, pz, qx, qy, qz, sradius)) {
+    if (!wall && sr::is_reached(px, py, pz, qx, qy, qz, 
+                                sradius * sr::margin<Tf>(args.perturb))) {
       state.set_true(cc::security_radius_reached);
       break;
     }
   
   }
  
-  for (Ti di = 0; di < k; di++) {
-    bool flag = true;
-    for (Ti ti = 0; ti < t_size; ti++) {
-      if (T[3 * t_maxsize * i + 3 * ti + 0] == dknn[koffs * di + i]) {
-        flag = false;
-      }
-      if (T[3 * t_maxsize * i + 3 * ti + 1] == dknn[koffs * di + i]) {
-        flag = false;
-      }
-      if (T[3 * t_maxsize * i + 3 * ti + 2] == dknn[koffs * di + i]) {
-        flag = false;
-      }
-      if (!flag) break;
-    } if (flag) knn[koffs * di + i] = cc::k_undefined;
-  }
+  // planes are created in neighbor order, so keeping the neighbors whose
+  // plane is still on the cell also lists them in plane order.
+  uint32_t mask[internal::mask_words(boundary::sentinel<Tu>())];
+  internal::mark_planes(T, 3 * t_maxsize * i, t_size, mask, p_size);
+
+  // faces are written to F in the order of the neighbors, as 7 values each
+  const bool use_faces = faces || args.min_face_area > 0;
 
   Ti dnn_counter = 0;
   for (Ti di = 0; di < k; di++) {
-    if (knn[koffs * di + i] == cc::k_undefined) continue;
+    const Ti plane = dknn[koffs * di + i];
+    if (plane < 0 || plane >= p_size) continue;
+    if (!internal::is_marked(mask, plane)) continue;
+    if (use_faces) {
+      Tf face[7];
+      internal::face<Tf, Tu>(
+        face, P, i, poffs, T, 3 * t_maxsize * i, t_size, plane, px, py, pz
+      );
+      if (face[0] < args.min_face_area) continue;
+      for (int c = 0; c < 3; c++) face[1 + c] += o[c];
+      for (int c = 0; faces && c < 7; c++) {
+        F[koffs * (7 * dnn_counter + c) + i] = face[c];
+      }
+    }
     knn[koffs * dnn_counter + i] = knn[koffs * di + i];
     dnn_counter += 1;
   }
@@ -12,8 +12,8 @@ class dnn {
     class proxy;
 
     dnn();
-    dnn(std::vector<Ti>& _list, std::vector<Ti>& _offs);
-    dnn(std::vector<Ti>&& _list, std::vector<Ti>&& _offs);
+    dnn(std::vector<Ti>& _list, std::vector<size_t>& _offs);
+    dnn(std::vector<Ti>&& _list, std::vector<size_t>&& _offs);
 
     const proxy operator[](const int i) const;
     proxy operator[](const int i);
@@ -22,8 +22,15 @@ class dnn {
     void print() const;
     void savetxt(const std::string& fname) const;
 
+    // Neighbors of point i : [offs[i], offs[i+1]) in list. The offsets are
+    // size_t, as the neighbors of a large set overflow Ti long before the
+    // points do.
     std::vector<Ti> list;
-    std::vector<Ti> offs;
+    std::vector<size_t> offs;
+
+    // Empty unless duplicates were checked for. alias[i] is the point that
+    // point i was merged into, and i itself for the points kept.
+    std::vector<Ti> alias;
 
   private:
 
@@ -50,13 +57,13 @@ votess::dnn<Ti>::dnn() {
 }
 
 template<typename Ti>
-votess::dnn<Ti>::dnn(std::vector<Ti>& _list, std::vector<Ti>& _offs)
+votess::dnn<Ti>::dnn(std::vector<Ti>& _list, std::vector<size_t>& _offs)
 : list(_list), offs(_offs) {
   internal::check_sinteger<Ti>();
 }
 
 template<typename Ti>
-votess::dnn<Ti>::dnn(std::vector<Ti>&& _list, std::vector<Ti>&& _offs)
+votess::dnn<Ti>::dnn(std::vector<Ti>&& _list, std::vector<size_t>&& _offs)
 : list(std::move(_list)), offs(std::move(_offs)) {
   internal::check_sinteger<Ti>();
 }
@@ -87,21 +94,16 @@ void votess::dnn<Ti>::print() const {
     return;
   }
 
-  Ti index = 0;
-  size_t counter = 1;
-  std::cout<<"{\n  {";
-  for (auto i : this->list) {
-    if (index == this->offs[counter]) {
-      if (counter < this->offs.size() - 1) {
-        counter += 1;
-      }
-      std::cout << "}\n  {";
+  // rows are walked through offs, so that empty ones are printed too
+  std::cout<<"{\n";
+  for (size_t i = 0; i < this->size(); i++) {
+    std::cout<<"  {";
+    for (size_t j = this->offs[i]; j < this->offs[i + 1]; j++) {
+      std::cout<<std::setw(1)<<this->list[j]<<", ";
     }
-
-    std::cout<<std::setw(1)<<i<<", ";
-    index += 1;
+    std::cout<<"}\n";
   }
-  std::cout << "}\n}" << std::endl;
+  std::cout << "}" << std::endl;
 
 }
 
@@ -113,7 +115,7 @@ void votess::dnn<Ti>::savetxt(const std::string& fname) const {
     return;
   }
 
-  Ti index = 0;
+  size_t index = 0;
   size_t counter = 1;
   for (auto i : this->list) {
     if (index == this->offs[counter]) {
@@ -136,18 +138,18 @@ void votess::dnn<Ti>::savetxt(const std::string& fname) const {
 template <typename T>
 class votess::dnn<T>::proxy {
   public:
-    proxy(std::vector<T>& list, std::vector<T>& offs, const size_t index);
+    proxy(std::vector<T>& list, std::vector<size_t>& offs, const size_t index);
     T& operator[](const size_t i);
     size_t size() const;
   private:
     std::vector<T>& _list;
-    std::vector<T>& _offs;
+    std::vector<size_t>& _offs;
     size_t _index;
 };
 
 template<typename T>
 votess::dnn<T>::proxy::proxy( std::vector<T>& list,
-  std::vector<T>& offs,
+  std::vector<size_t>& offs,
   const size_t index
 ) : _list(list), _offs(offs), _index(index) {}
 
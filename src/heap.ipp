@@ -67,6 +67,72 @@ inline void heap::sort(
 
 /* ------------------------------------------------------------------------- */
 
+template <typename Ti, typename Tf>
+inline void heap::minheapify(
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  const size_t h0,
+  const size_t s, size_t i
+) {
+  while (true) {
+    size_t smallest = i;
+    const size_t left = 2 * i + 1;
+    const size_t right = 2 * i + 2;
+    if ((left  < s) && (heap_pq[h0 + left] < heap_pq[h0 + smallest])) {
+      smallest = left;
+    }
+    if ((right < s) && (heap_pq[h0 + right] < heap_pq[h0 + smallest])) {
+      smallest = right;
+    }
+    if (i != smallest) {
+      swap(heap_id, heap_pq, h0, i, smallest);
+      i = smallest;
+      continue;
+    }
+    break;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+// inserts (id, pq) at position 's', i.e. the caller owns the storage and
+// the heap grows from 's' to 's + 1'.
+template <typename Ti, typename Tf>
+inline void heap::minpush(
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  const size_t h0,
+  const size_t s,
+  const Ti id, const Tf pq
+) {
+  size_t i = s;
+  heap_id[h0 + i] = id;
+  heap_pq[h0 + i] = pq;
+  while (i > 0) {
+    const size_t parent = (i - 1) / 2;
+    if (!(heap_pq[h0 + i] < heap_pq[h0 + parent])) break;
+    swap(heap_id, heap_pq, h0, i, parent);
+    i = parent;
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+// removes the root of a heap of size 's'. the heap shrinks to 's - 1'.
+template <typename Ti, typename Tf>
+inline void heap::minpop(
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  const size_t h0,
+  const size_t s
+) {
+  if (s == 0) return;
+  swap(heap_id, heap_pq, h0, 0, s - 1);
+  minheapify(heap_id, heap_pq, h0, s - 1, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* ------------------------------------------------------------------------- */
 /// SYCL Implementation
 /* ------------------------------------------------------------------------- */
@@ -149,7 +215,7 @@ template <typename Ti, typename Tf>
 inline void heap::swap(
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const int s, const int i,
+  const size_t s, const size_t i,
   const int a, const int b
 ) {
   const Ti tmpid = heap_id[s * a + i];
@@ -167,7 +233,7 @@ template <typename Ti, typename Tf>
 inline void heap::maxheapify(
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const int s, const int i,
+  const size_t s, const size_t i,
   const int k, int idx
 ) {
 #if 1
@@ -219,7 +285,7 @@ template <typename Ti, typename Tf>
 inline void heap::sort(
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const int s, const int i,
+  const size_t s, const size_t i,
   const int k
 ) {
   for (int idx = k / 2 - 1; idx >= 0; idx--) {
@@ -19,25 +19,106 @@ static inline bool is_inshell(
           (z > pz - r && z < pz + r));
 }
 
+// Grid displacements [beg, end] from grid cell c that shell r spans along one
+// axis. The grid stops at its edges, unless it is periodic, in which case
+// each grid cell is only reached through its nearest displacement, so that
+// it is scanned once.
+static inline void shell_range(
+  const int c, const int r, const int gr, const bool periodic,
+  int& beg, int& end
+) {
+  if (periodic) {
+    beg = utils::bmax(-r, -(gr - 1) / 2);
+    end = utils::bmin(r, gr / 2);
+  } else {
+    beg = utils::bmax(-r, -c);
+    end = utils::bmin(r, gr - 1 - c);
+  }
+}
+
+// Grid cell c + d along one axis, with c + d within (-gr, 2 * gr).
+static inline int wrap(const int c, const int d, const int gr) {
+  const int x = c + d;
+  return x < 0 ? x + gr : (x >= gr ? x - gr : x);
+}
+
+// Grid cell of cell id 'cid' along axis c.
+static inline int get_cell(const int cid, const int c, const int* gr) {
+  if (c == 0) return cid % gr[0];
+  if (c == 1) return (cid / gr[0]) % gr[1];
+  return cid / (gr[0] * gr[1]);
+}
+
+// Id of the grid cell at displacement (dx, dy, dz) from grid cell
+// (px, py, pz), wrapped around the grid.
+static inline int get_cid(
+  const int px, const int py, const int pz,
+  const int dx, const int dy, const int dz,
+  const int* gr
+) {
+  return gr[0] * gr[1] * wrap(pz, dz, gr[2]) + 
+         gr[0] * wrap(py, dy, gr[1]) + 
+         wrap(px, dx, gr[0]);
+}
+
+// Distance from coordinate q to the nearest face of its grid cell c, along
+// an axis whose grid starts at lo with cells of length gl.
+template <typename Tf>
+static inline Tf get_margin(const Tf q, const Tf lo, const Tf gl, const int c) {
+  const Tf d = q - lo - gl * c;
+  return d <= gl / 2 ? d : gl - d;
+}
+
+// Squared distance past which a point cannot reach a cell bounded by the cube
+// of half side r around its own point, twice the distance to the corners of
+// that cube, worked out in the type of r. Infinite if r is not positive.
+template <typename Tf, typename Tr>
+static inline Tf get_cutoff(const Tr r) {
+  return r > 0 ? static_cast<Tf>(12 * r * r) 
+               : std::numeric_limits<Tf>::infinity();
+}
+
 template <typename Ti, typename Tf>
 void knni::compute(
   const Ti i, const Ti index,
-  const std::vector<std::array<Tf,3>>& xyzset,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
   const Ti xyzsize,
   const std::vector<Ti>& id,
   const std::vector<Ti>& offset,
-  const std::vector<std::array<Tf,3>>& refset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
   const Ti refsize,
   std::vector<Ti>& heap_id,
   std::vector<Tf>& heap_pq,
   const struct args::knn& args
 ) {
+  knni::compute<Ti, Tf>(
+    i, index, xyzset, xyzsize, id, offset, refset, refsize,
+    heap_id, heap_pq, static_cast<size_t>(args.k) * i, args
+  );
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+void knni::compute(
+  const Ti i, const Ti index,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const Ti xyzsize,
+  const std::vector<Ti>& id,
+  const std::vector<Ti>& offset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  const Ti refsize,
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq, const size_t hoffs,
+  const struct args::knn& args
+) {
 
   static_assert(std::is_integral<Ti>::value,
                 "Ti must be an integral type");
   static_assert(std::is_floating_point<Tf>::value,
                 "Tf must be a floating point type");
 
+  (void) i;
   (void) xyzsize;
   (void) refsize;
 
@@ -47,47 +128,46 @@ void knni::compute(
   const Tf q2 = refset[index][2];
 
   const auto k = args.k;
-  const auto gr = args.grid_resolution;
-  const auto gl = 1.0f / args.grid_resolution;
+  const auto& box = args.box;
+  const int* gr = box.gr;
+  const Tf gl[3] = {Tf(box.cell(0)), Tf(box.cell(1)), Tf(box.cell(2))};
+  const Tf l[3] = {Tf(box.length(0)), Tf(box.length(1)), Tf(box.length(2))};
 
-  const Ti h0 = k * i;
+  const size_t h0 = hoffs;
 
   // memory access
-  const int px = (id[index]) % gr;
-  const int py = (id[index]  / gr) % gr;
-  const int pz = (id[index]) / (gr * gr);
+  const int px = get_cell(id[index], 0, gr);
+  const int py = get_cell(id[index], 1, gr);
+  const int pz = get_cell(id[index], 2, gr);
   
-  const Tf gl2 = gl / 2;
-  const Tf dx = std::fmod(q0, gl);
-  const Tf dy = std::fmod(q1, gl);
-  const Tf dz = std::fmod(q2, gl);
-  const Tf min_dx = dx * (dx <= gl2) + (gl - dx) * (dx > gl2);
-  const Tf min_dy = dy * (dy <= gl2) + (gl - dy) * (dy > gl2);
-  const Tf min_dz = dz * (dz <= gl2) + (gl - dz) * (dz > gl2);
-  const Tf min = std::min({min_dx, min_dy, min_dz});
-
-  for (auto r = 0; r < gr; r++) {
-
-    const int beg_z = std::max(pz - r, 0);
-    const int end_z = std::min(pz + r, gr - 1);
-    const int beg_y = std::max(py - r, 0);
-    const int end_y = std::min(py + r, gr - 1);
-    const int beg_x = std::max(px - r, 0);
-    const int end_x = std::min(px + r, gr - 1);
+  const Tf min_dx = get_margin<Tf>(q0, box.lo[0], gl[0], px);
+  const Tf min_dy = get_margin<Tf>(q1, box.lo[1], gl[1], py);
+  const Tf min_dz = get_margin<Tf>(q2, box.lo[2], gl[2], pz);
+
+  const bool periodic = args.periodic;
+  const int r_max = std::max({gr[0], gr[1], gr[2]});
+  const Tf cutoff = get_cutoff<Tf>(args.max_radius);
+
+  for (auto r = 0; r < r_max; r++) {
+
+    int beg_x, end_x, beg_y, end_y, beg_z, end_z;
+    shell_range(px, r, gr[0], periodic, beg_x, end_x);
+    shell_range(py, r, gr[1], periodic, beg_y, end_y);
+    shell_range(pz, r, gr[2], periodic, beg_z, end_z);
     
-    for (auto z = beg_z; z <= end_z; z++) {
-    for (auto y = beg_y; y <= end_y; y++) {
-    for (auto x = beg_x; x <= end_x; x++) {
+    for (auto dz = beg_z; dz <= end_z; dz++) {
+    for (auto dy = beg_y; dy <= end_y; dy++) {
+    for (auto dx = beg_x; dx <= end_x; dx++) {
 
-      if (is_inshell(x, y, z, px, py, pz, r)) {
+      if (is_inshell(dx, dy, dz, 0, 0, 0, r)) {
         continue; 
       }
 
-      const int cid = gr * gr * z + gr * y + x;
+      const int cid = get_cid(px, py, pz, dx, dy, dz, gr);
 
       // memory access
-      const int offs0 = offset[cid];
-      const int offs1 = offset[cid + 1];
+      const Ti offs0 = offset[cid];
+      const Ti offs1 = offset[cid + 1];
 
       for (Ti p = offs0; p < offs1; p++) {
 
@@ -96,13 +176,19 @@ void knni::compute(
         }
 
         // memory access
-        const Tf p0 = xyzset[p][0];
-        const Tf p1 = xyzset[p][1];
-        const Tf p2 = xyzset[p][2];
+        Tf p0 = xyzset[p][0];
+        Tf p1 = xyzset[p][1];
+        Tf p2 = xyzset[p][2];
+
+        if (periodic) {
+          p0 = xyzset::get_image(p0, q0, l[0]);
+          p1 = xyzset::get_image(p1, q1, l[1]);
+          p2 = xyzset::get_image(p2, q2, l[2]);
+        }
 
         const Tf pq = xyzset::get_distance(p0, p1, p2, q0, q1, q2);
 
-        if (pq < heap_pq[h0]) {
+        if (pq < heap_pq[h0] && pq < cutoff) {
 
           // memory access
           heap_id[h0] = p;
@@ -114,30 +200,318 @@ void knni::compute(
     }}}
 
     // memory access
-    if (heap_pq[h0] < utils::square(gl * r + min)) {
+    const Tf bound = std::min({gl[0] * r + min_dx, 
+                               gl[1] * r + min_dy, 
+                               gl[2] * r + min_dz});
+    if (heap_pq[h0] < utils::square(bound) || 
+        utils::square(bound) >= cutoff) {
       break; 
     }
 
   }
 
   heap::sort<Ti,Tf>(heap_id, heap_pq, h0, k);
+
+  // slots left empty, with fewer than k points within reach
+  for (size_t j = h0; j < h0 + k; j++) {
+    if (!(heap_pq[j] < cutoff)) heap_id[j] = __INTERNAL__K_UNDEFINED;
+  }
   
   return;
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/// Adaptive k
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+
+template <typename Ti>
+int knni::budget(
+  const Ti index,
+  const std::vector<Ti>& id,
+  const std::vector<Ti>& offset,
+  const int k_min, const int k_max,
+  const struct args::knn& args
+) {
+
+  const int* gr = args.box.gr;
+  const Ti xyzsize = offset[offset.size() - 1];
+
+  const int px = get_cell(id[index], 0, gr);
+  const int py = get_cell(id[index], 1, gr);
+  const int pz = get_cell(id[index], 2, gr);
+
+  size_t count = 0;
+  size_t ncells = 0;
+
+  int beg_x, end_x, beg_y, end_y, beg_z, end_z;
+  shell_range(px, 1, gr[0], args.periodic, beg_x, end_x);
+  shell_range(py, 1, gr[1], args.periodic, beg_y, end_y);
+  shell_range(pz, 1, gr[2], args.periodic, beg_z, end_z);
+
+  for (auto dz = beg_z; dz <= end_z; dz++) {
+  for (auto dy = beg_y; dy <= end_y; dy++) {
+  for (auto dx = beg_x; dx <= end_x; dx++) {
+    const int cid = get_cid(px, py, pz, dx, dy, dz, gr);
+    count += offset[cid + 1] - offset[cid];
+    ncells += 1;
+  }}}
+
+  const double mean = static_cast<double>(xyzsize) / args.box.size();
+  const double density = static_cast<double>(count) / ncells;
+
+  int k = static_cast<int>(std::lround(args.k * density / mean));
+  k = std::max(k_min, std::min(k, k_max));
+  k = std::min<int>(k, xyzsize - 1);
+
+  return k;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Stream
+///////////////////////////////////////////////////////////////////////////////
+
+#include <limits>
+
+template <typename Ti, typename Tf>
+knni::stream<Ti, Tf>::stream(
+  const xyzset::span<const std::array<Tf,3>>& _xyzset,
+  const std::vector<Ti>& _id,
+  const std::vector<Ti>& _offset,
+  const struct args::knn& args
+) : xyzset(_xyzset), id(_id), offset(_offset),
+    box(args.box), gr{box.gr[0], box.gr[1], box.gr[2]},
+    gl{Tf(box.cell(0)), Tf(box.cell(1)), Tf(box.cell(2))},
+    l{Tf(box.length(0)), Tf(box.length(1)), Tf(box.length(2))},
+    periodic(args.periodic), cutoff(get_cutoff<Tf>(args.max_radius)),
+    heap_id(args.k > 0 ? args.k : 1), heap_pq(args.k > 0 ? args.k : 1),
+    heap_size(0), index(0), q0(0), q1(0), q2(0), px(0), py(0), pz(0),
+    r(0), min{0, 0, 0}, bound(0) {
+
+  static_assert(std::is_integral<Ti>::value,
+                "Ti must be an integral type");
+  static_assert(std::is_floating_point<Tf>::value,
+                "Tf must be a floating point type");
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+void knni::stream<Ti, Tf>::reset(const Ti _index, const std::array<Tf,3>& q) {
+
+  this->index = _index;
+  this->q0 = q[0];
+  this->q1 = q[1];
+  this->q2 = q[2];
+
+  this->px = get_cell(id[index], 0, gr);
+  this->py = get_cell(id[index], 1, gr);
+  this->pz = get_cell(id[index], 2, gr);
+
+  this->min[0] = get_margin<Tf>(q0, box.lo[0], gl[0], px);
+  this->min[1] = get_margin<Tf>(q1, box.lo[1], gl[1], py);
+  this->min[2] = get_margin<Tf>(q2, box.lo[2], gl[2], pz);
+
+  this->r = 0;
+  this->bound = 0;
+  this->heap_size = 0;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+bool knni::stream<Ti, Tf>::next(Ti& p, Tf& pq) {
+
+  // a candidate is safe to release once nothing closer can be found in the
+  // shells that have not been scanned yet.
+  while ((heap_size == 0 || heap_pq[0] > bound) && bound < cutoff) {
+    expand();
+  }
+  if (heap_size == 0 || !(heap_pq[0] < cutoff)) {
+    return false;
+  }
+
+  p = heap_id[0];
+  pq = heap_pq[0];
+  heap::minpop<Ti, Tf>(heap_id, heap_pq, 0, heap_size);
+  heap_size -= 1;
+
+  return true;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+void knni::stream<Ti, Tf>::expand(void) {
+
+  int beg_x, end_x, beg_y, end_y, beg_z, end_z;
+  shell_range(px, r, gr[0], periodic, beg_x, end_x);
+  shell_range(py, r, gr[1], periodic, beg_y, end_y);
+  shell_range(pz, r, gr[2], periodic, beg_z, end_z);
+
+  for (auto dz = beg_z; dz <= end_z; dz++) {
+  for (auto dy = beg_y; dy <= end_y; dy++) {
+  for (auto dx = beg_x; dx <= end_x; dx++) {
+
+    if (is_inshell(dx, dy, dz, 0, 0, 0, r)) {
+      continue;
+    }
+
+    const int cid = get_cid(px, py, pz, dx, dy, dz, gr);
+    const Ti offs0 = offset[cid];
+    const Ti offs1 = offset[cid + 1];
+
+    for (Ti p = offs0; p < offs1; p++) {
+
+      if (p == index) {
+        continue;
+      }
+
+      Tf p0 = xyzset[p][0];
+      Tf p1 = xyzset[p][1];
+      Tf p2 = xyzset[p][2];
+
+      if (periodic) {
+        p0 = xyzset::get_image(p0, q0, l[0]);
+        p1 = xyzset::get_image(p1, q1, l[1]);
+        p2 = xyzset::get_image(p2, q2, l[2]);
+      }
+
+      const Tf pq = xyzset::get_distance(p0, p1, p2, q0, q1, q2);
+
+      if (heap_size >= heap_id.size()) {
+        heap_id.resize(2 * heap_id.size());
+        heap_pq.resize(2 * heap_pq.size());
+      }
+
+      heap::minpush<Ti, Tf>(heap_id, heap_pq, 0, heap_size, p, pq);
+      heap_size += 1;
+
+    }
+
+  }}}
+
+  const bool exhausted = (end_x - beg_x == gr[0] - 1) &&
+                         (end_y - beg_y == gr[1] - 1) &&
+                         (end_z - beg_z == gr[2] - 1);
+
+  bound = exhausted ? std::numeric_limits<Tf>::infinity()
+                    : utils::square(std::min({gl[0] * r + min[0],
+                                              gl[1] * r + min[1],
+                                              gl[2] * r + min[2]}));
+  r += 1;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Range Query
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Ti, typename Tf>
+size_t knni::range(
+  const Ti index, const std::array<Tf,3>& q,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const std::vector<Ti>& offset,
+  const Tf pq_min, const Tf pq_max,
+  std::vector<Ti>& heap_id,
+  std::vector<Tf>& heap_pq,
+  size_t size,
+  const struct args::knn& args
+) {
+
+  const auto& box = args.box;
+  const int* gr = box.gr;
+  const Tf l[3] = {Tf(box.length(0)), Tf(box.length(1)), Tf(box.length(2))};
+  const Tf r = std::sqrt(pq_max);
+
+  // with periodicity, the range may wrap around, but not past a full turn
+  int beg[3];
+  int end[3];
+  for (int c = 0; c < 3; c++) {
+    const Tf gl = box.cell(c);
+    beg[c] = static_cast<int>(std::floor((q[c] - box.lo[c] - r) / gl));
+    end[c] = static_cast<int>(std::floor((q[c] - box.lo[c] + r) / gl));
+    if (!args.periodic) {
+      beg[c] = std::max(beg[c], 0);
+      end[c] = std::min(end[c], gr[c] - 1);
+    } else if (end[c] - beg[c] >= gr[c]) {
+      beg[c] = 0;
+      end[c] = gr[c] - 1;
+    }
+  }
+
+  const auto cell = [gr](const int x, const int c) { 
+    return ((x % gr[c]) + gr[c]) % gr[c]; 
+  };
+
+  for (auto z = beg[2]; z <= end[2]; z++) {
+  for (auto y = beg[1]; y <= end[1]; y++) {
+  for (auto x = beg[0]; x <= end[0]; x++) {
+
+    const int cid = gr[0] * gr[1] * cell(z, 2) + gr[0] * cell(y, 1) + 
+                    cell(x, 0);
+    const Ti offs0 = offset[cid];
+    const Ti offs1 = offset[cid + 1];
+
+    for (Ti p = offs0; p < offs1; p++) {
+
+      if (p == index) {
+        continue;
+      }
+
+      Tf p0 = xyzset[p][0];
+      Tf p1 = xyzset[p][1];
+      Tf p2 = xyzset[p][2];
+
+      if (args.periodic) {
+        p0 = xyzset::get_image(p0, q[0], l[0]);
+        p1 = xyzset::get_image(p1, q[1], l[1]);
+        p2 = xyzset::get_image(p2, q[2], l[2]);
+      }
+
+      const Tf pq = xyzset::get_distance(p0, p1, p2, q[0], q[1], q[2]);
+
+      if (pq < pq_min || pq > pq_max) {
+        continue;
+      }
+
+      if (size >= heap_id.size()) {
+        heap_id.resize(2 * size + 1);
+        heap_pq.resize(2 * size + 1);
+      }
+
+      heap_id[size] = p;
+      heap_pq[size] = pq;
+      size += 1;
+
+    }
+
+  }}}
+
+  return size;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
 template <typename Ti, typename Tf>
 void knni::compute(
-  const Ti i, const Ti index,
+  const size_t i, const Ti index,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Ti>& id,
   const device_accessor_read_t<Ti>& offset,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
+  const size_t refsize,
   const device_accessor_readwrite_t<Ti>& heap_id,
   const device_accessor_readwrite_t<Tf>& heap_pq,
-  const struct args::knn& args
+  const struct args::device_knn<Tf>& args
 ) {
 
   static_assert(std::is_integral<Ti>::value,
@@ -151,45 +525,43 @@ void knni::compute(
   const Tf q2 = refset[refsize * 2 + index];
 
   const auto k = args.k;
-  const auto gr = args.grid_resolution;
-  const auto gl = 1.0f / args.grid_resolution;
+  const auto& box = args.box;
+  const int* gr = box.gr;
+  const Tf gl[3] = {Tf(box.cell(0)), Tf(box.cell(1)), Tf(box.cell(2))};
+  const Tf l[3] = {Tf(box.length(0)), Tf(box.length(1)), Tf(box.length(2))};
 
-  const Ti h0 = k * i;
+  const size_t h0 = k * i;
 
-  const int px = (id[index]) % gr;
-  const int py = (id[index]  / gr) % gr;
-  const int pz = (id[index]) / (gr * gr);
+  const int px = get_cell(id[index], 0, gr);
+  const int py = get_cell(id[index], 1, gr);
+  const int pz = get_cell(id[index], 2, gr);
   
-  const Tf gl2 = gl / 2;
-  const Tf dx = sycl::fmod(q0, gl);
-  const Tf dy = sycl::fmod(q1, gl);
-  const Tf dz = sycl::fmod(q2, gl);
-  const Tf min_dx = dx * (dx <= gl2) + (gl - dx) * (dx > gl2);
-  const Tf min_dy = dy * (dy <= gl2) + (gl - dy) * (dy > gl2);
-  const Tf min_dz = dz * (dz <= gl2) + (gl - dz) * (dz > gl2);
-  const Tf min = utils::bmin(min_dx, min_dy, min_dz);
-
-  for (auto r = 0; r < gr; r++) {
-
-    const int beg_z = utils::bmax(pz - r, 0);
-    const int beg_y = utils::bmax(py - r, 0);
-    const int beg_x = utils::bmax(px - r, 0);
-
-    const int end_z = utils::bmin(pz + r, gr - 1);
-    const int end_y = utils::bmin(py + r, gr - 1);
-    const int end_x = utils::bmin(px + r, gr - 1);
+  const Tf min_dx = get_margin<Tf>(q0, box.lo[0], gl[0], px);
+  const Tf min_dy = get_margin<Tf>(q1, box.lo[1], gl[1], py);
+  const Tf min_dz = get_margin<Tf>(q2, box.lo[2], gl[2], pz);
+
+  const bool periodic = args.periodic;
+  const int r_max = utils::bmax(gr[0], gr[1], gr[2]);
+  const Tf cutoff = get_cutoff<Tf>(args.max_radius);
+
+  for (auto r = 0; r < r_max; r++) {
+
+    int beg_x, end_x, beg_y, end_y, beg_z, end_z;
+    shell_range(px, r, gr[0], periodic, beg_x, end_x);
+    shell_range(py, r, gr[1], periodic, beg_y, end_y);
+    shell_range(pz, r, gr[2], periodic, beg_z, end_z);
     
-    for (auto z = beg_z; z <= end_z; z++) {
-    for (auto y = beg_y; y <= end_y; y++) {
-    for (auto x = beg_x; x <= end_x; x++) {
+    for (auto dz = beg_z; dz <= end_z; dz++) {
+    for (auto dy = beg_y; dy <= end_y; dy++) {
+    for (auto dx = beg_x; dx <= end_x; dx++) {
 
-      if (is_inshell(x, y, z, px, py, pz, r)) {
+      if (is_inshell(dx, dy, dz, 0, 0, 0, r)) {
         continue; 
       }
 
-      const int cid = gr * gr * z + gr * y + x;
-      const int offs0 = offset[cid];
-      const int offs1 = offset[cid + 1];
+      const int cid = get_cid(px, py, pz, dx, dy, dz, gr);
+      const Ti offs0 = offset[cid];
+      const Ti offs1 = offset[cid + 1];
 
       for (Ti p = offs0; p < offs1; p++) {
 
@@ -197,13 +569,19 @@ void knni::compute(
           continue;
         }
 
-        const Tf p0 = xyzset[xyzsize * 0 + p];
-        const Tf p1 = xyzset[xyzsize * 1 + p];
-        const Tf p2 = xyzset[xyzsize * 2 + p];
+        Tf p0 = xyzset[xyzsize * 0 + p];
+        Tf p1 = xyzset[xyzsize * 1 + p];
+        Tf p2 = xyzset[xyzsize * 2 + p];
+
+        if (periodic) {
+          p0 = xyzset::get_image(p0, q0, l[0]);
+          p1 = xyzset::get_image(p1, q1, l[1]);
+          p2 = xyzset::get_image(p2, q2, l[2]);
+        }
 
         const Tf pq = xyzset::get_distance(p0, p1, p2, q0, q1, q2);
 
-        const bool cond = (pq < heap_pq[h0]);
+        const bool cond = (pq < heap_pq[h0]) && (pq < cutoff);
         heap_id[h0] = !cond * heap_id[h0] + cond * p;
         heap_pq[h0] = !cond * heap_pq[h0] + cond * pq;
         heap::maxheapify<Ti, Tf>(heap_id, heap_pq, h0, cond * k, 0);
@@ -211,29 +589,37 @@ void knni::compute(
 
     }}}
 
-    if (heap_pq[h0] < utils::square(gl * r + min)) {
+    const Tf bound = utils::bmin(gl[0] * r + min_dx, 
+                                 gl[1] * r + min_dy, 
+                                 gl[2] * r + min_dz);
+    if (heap_pq[h0] < utils::square(bound) || 
+        utils::square(bound) >= cutoff) {
       break; 
     }
 
   }
 
   heap::sort<Ti,Tf>(heap_id, heap_pq, h0, k);
+
+  for (size_t j = h0; j < h0 + k; j++) {
+    if (!(heap_pq[j] < cutoff)) heap_id[j] = __INTERNAL__K_UNDEFINED;
+  }
   return;
 
 }
 
 template <typename Ti, typename Tf>
 void knni::compute(
-  const Ti i, const Ti index,
+  const size_t i, const Ti index,
   const device_accessor_read_t<Tf>& xyzset,
-  const Ti xyzsize,
+  const size_t xyzsize,
   const device_accessor_read_t<Ti>& id,
   const device_accessor_read_t<Ti>& offset,
   const device_accessor_read_t<Tf>& refset,
-  const Ti refsize,
+  const size_t refsize,
   const device_accessor_readwrite_t<Ti>& heap_id,
-  const device_accessor_readwrite_t<Tf>& heap_pq, const Ti hoffs,
-  const struct args::knn& args
+  const device_accessor_readwrite_t<Tf>& heap_pq, const size_t hoffs,
+  const struct args::device_knn<Tf>& args
 ) {
 
   static_assert(std::is_integral<Ti>::value,
@@ -247,43 +633,41 @@ void knni::compute(
   const Tf q2 = refset[refsize * 2 + index];
 
   const uint16_t k = args.k;
-  const uint8_t gr = args.grid_resolution;
-  const Tf gl = 1.0f / args.grid_resolution;
-
-  const uint16_t px = (id[index]) % gr;
-  const uint16_t py = (id[index]  / gr) % gr;
-  const uint16_t pz = (id[index]) / (gr * gr);
+  const auto& box = args.box;
+  const int* gr = box.gr;
+  const Tf gl[3] = {Tf(box.cell(0)), Tf(box.cell(1)), Tf(box.cell(2))};
+  const Tf l[3] = {Tf(box.length(0)), Tf(box.length(1)), Tf(box.length(2))};
+
+  const uint16_t px = get_cell(id[index], 0, gr);
+  const uint16_t py = get_cell(id[index], 1, gr);
+  const uint16_t pz = get_cell(id[index], 2, gr);
   
-  const Tf gl2 = gl / 2;
-  const Tf dx = sycl::fmod(q0, gl);
-  const Tf dy = sycl::fmod(q1, gl);
-  const Tf dz = sycl::fmod(q2, gl);
-  const Tf min_dx = dx * (dx <= gl2) + (gl - dx) * (dx > gl2);
-  const Tf min_dy = dy * (dy <= gl2) + (gl - dy) * (dy > gl2);
-  const Tf min_dz = dz * (dz <= gl2) + (gl - dz) * (dz > gl2);
-  const Tf min = utils::bmin(min_dx, min_dy, min_dz);
-
-  for (uint8_t r = 0; r < gr; r++) {
-
-    const uint16_t beg_z = utils::bmax(pz - r, 0);
-    const uint16_t beg_y = utils::bmax(py - r, 0);
-    const uint16_t beg_x = utils::bmax(px - r, 0);
-
-    const uint16_t end_z = utils::bmin(pz + r, gr - 1);
-    const uint16_t end_y = utils::bmin(py + r, gr - 1);
-    const uint16_t end_x = utils::bmin(px + r, gr - 1);
+  const Tf min_dx = get_margin<Tf>(q0, box.lo[0], gl[0], px);
+  const Tf min_dy = get_margin<Tf>(q1, box.lo[1], gl[1], py);
+  const Tf min_dz = get_margin<Tf>(q2, box.lo[2], gl[2], pz);
+
+  const bool periodic = args.periodic;
+  const uint8_t r_max = utils::bmax(gr[0], gr[1], gr[2]);
+  const Tf cutoff = get_cutoff<Tf>(args.max_radius);
+
+  for (uint8_t r = 0; r < r_max; r++) {
+
+    int beg_x, end_x, beg_y, end_y, beg_z, end_z;
+    shell_range(px, r, gr[0], periodic, beg_x, end_x);
+    shell_range(py, r, gr[1], periodic, beg_y, end_y);
+    shell_range(pz, r, gr[2], periodic, beg_z, end_z);
     
-    for (uint16_t z = beg_z; z <= end_z; z++) {
-    for (uint16_t y = beg_y; y <= end_y; y++) {
-    for (uint16_t x = beg_x; x <= end_x; x++) {
+    for (int dz = beg_z; dz <= end_z; dz++) {
+    for (int dy = beg_y; dy <= end_y; dy++) {
+    for (int dx = beg_x; dx <= end_x; dx++) {
 
-      if (is_inshell(x, y, z, px, py, pz, r)) {
+      if (is_inshell(dx, dy, dz, 0, 0, 0, r)) {
         continue; 
       }
 
-      const int cid = gr * gr * z + gr * y + x;
-      const int offs0 = offset[cid];
-      const int offs1 = offset[cid + 1];
+      const int cid = get_cid(px, py, pz, dx, dy, dz, gr);
+      const Ti offs0 = offset[cid];
+      const Ti offs1 = offset[cid + 1];
 
       for (Ti p = offs0; p < offs1; p++) {
 
@@ -291,13 +675,19 @@ void knni::compute(
           continue;
         }
 
-        const Tf p0 = xyzset[xyzsize * 0 + p];
-        const Tf p1 = xyzset[xyzsize * 1 + p];
-        const Tf p2 = xyzset[xyzsize * 2 + p];
+        Tf p0 = xyzset[xyzsize * 0 + p];
+        Tf p1 = xyzset[xyzsize * 1 + p];
+        Tf p2 = xyzset[xyzsize * 2 + p];
+
+        if (periodic) {
+          p0 = xyzset::get_image(p0, q0, l[0]);
+          p1 = xyzset::get_image(p1, q1, l[1]);
+          p2 = xyzset::get_image(p2, q2, l[2]);
+        }
 
         const Tf pq = xyzset::get_distance(p0, p1, p2, q0, q1, q2);
 
-        const bool cond = (pq < heap_pq[i]);
+        const bool cond = (pq < heap_pq[i]) && (pq < cutoff);
         heap_id[i] = !cond * heap_id[i] + cond * p;
         heap_pq[i] = !cond * heap_pq[i] + cond * pq;
         heap::maxheapify<Ti, Tf>(heap_id, heap_pq, hoffs, i, cond * k, 0);
@@ -306,13 +696,23 @@ void knni::compute(
 
     }}}
 
-    if (heap_pq[i] < utils::square(gl * r + min)) {
+    const Tf bound = utils::bmin(gl[0] * r + min_dx, 
+                                 gl[1] * r + min_dy, 
+                                 gl[2] * r + min_dz);
+    if (heap_pq[i] < utils::square(bound) || 
+        utils::square(bound) >= cutoff) {
       break; 
     }
 
   }
 
   heap::sort<Ti,Tf>(heap_id, heap_pq, hoffs, i, k);
+
+  for (Ti j = 0; j < k; j++) {
+    if (!(heap_pq[hoffs * j + i] < cutoff)) {
+      heap_id[hoffs * j + i] = __INTERNAL__K_UNDEFINED;
+    }
+  }
   return;
 
 }
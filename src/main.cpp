@@ -10,6 +10,9 @@
 #include <array>
 #include <functional>
 #include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <limits>
 
 #include <getopt.h>
 
@@ -47,9 +50,25 @@ print_help(const char* const executable) {
 " -c, --chunksize  <n>         Specify chunk size for processing.\n"
 " -u, --use-chunking           Enable chunking for processing.\n"
 " -r, --use-recompute          Enable CPU fallback to ensure valid Voronoi cells.\n"
+" -a, --use-adaptive-k         Scale k per cell with the local point density (CPU only).\n"
+" -R, --use-radius-recompute   Resume failed cells from their security radius instead of doubling k.\n"
+" -s, --use-knn-stream         Stream neighbors to the convex cell algorithm (CPU only).\n"
+" -P, --use-periodic           Wrap the box around on itself in every direction.\n"
+" -e, --use-precision-retry    Rerun the cells with orientation tests too close to call in double.\n"
+" -C, --use-recentering        Clip each cell in coordinates relative to its point.\n"
+" -S, --use-perturbation       Break ties in the orientation tests by the point indices.\n"
+" -D, --use-duplicate-check    Count the points that coincide with another one.\n"
+" -U, --use-duplicate-merge    Merge the points that coincide with another one before tesellating.\n"
+" -T, --duplicate-tolerance <t> Treat points within <t> of each other as coincident.\n"
+" -L, --use-int64              Index the points with 64 bit integers, as done past 2^31 - 1 points.\n"
+" -f, --use-double             Read and tessellate the points in double precision.\n"
+" -b, --box <box>              Specify the box holding the points as xmin,xmax,ymin,ymax,zmin,zmax.\n"
+" -M, --max-radius <r>         Bound each cell by the cube of half side <r> around its point.\n"
+" -w, --walls <file>           Cut the box with the half-spaces a*x+b*y+c*z+d >= 0 in <file>, one a,b,c,d per line.\n"
 " -p, --p-maxsize <n>          Specify maximum P parameter size for convex cell algorithm.\n"
 " -m, --t-maxsize <n>          Specify maximum T parameter size for convex cell algorithm.\n"
 " -x, --use-device <cpu|gpu>   Specify the device to use (cpu or gpu).\n"
+" -o, --mesh-outfile <file>    Stream the cell polyhedra to a binary VTK file, or PLY for a .ply file.\n"
   << std::endl;
 }
 
@@ -67,7 +86,8 @@ static int grid_resolution = 24;
 /// Main
 ///////////////////////////////////////////////////////////////////////////////
 
-static std::tuple <std::string, struct votess::vtargs, enum votess::device>
+static std::tuple <std::string, struct votess::vtargs, enum votess::device, 
+                   bool, bool>
 parse_args(int argc, char* argv[]) {
 
   int opt = 0;
@@ -76,6 +96,8 @@ parse_args(int argc, char* argv[]) {
   std::string infile = "";
   struct votess::vtargs vtargs;
   votess::device device = votess::device::gpu;
+  bool use_int64 = false;
+  bool use_double = false;
 
   int k_init = ARGS_DEFAULT_K;
   int chunksize = ARGS_DEFAULT_CHUNKSIZE;
@@ -85,7 +107,22 @@ parse_args(int argc, char* argv[]) {
   int gpu_ndsize = ARGS_DEFAULT_GPU_NDWORKSIZE;
   bool use_chunking = ARGS_DEFAULT_USE_CHUNKING;
   bool use_recompute = ARGS_DEFAULT_USE_RECOMPUTE;
+  bool use_adaptive_k = ARGS_DEFAULT_USE_ADAPTIVE_K;
+  bool use_radius_recompute = ARGS_DEFAULT_USE_RADIUS_RECOMPUTE;
+  bool use_knn_stream = ARGS_DEFAULT_USE_KNN_STREAM;
+  bool use_periodic = ARGS_DEFAULT_USE_PERIODIC;
+  bool use_precision_retry = ARGS_DEFAULT_USE_PRECISION_RETRY;
+  bool use_recentering = ARGS_DEFAULT_USE_RECENTERING;
+  bool use_perturbation = ARGS_DEFAULT_USE_PERTURBATION;
+  bool use_duplicate_check = ARGS_DEFAULT_USE_DUPLICATE_CHECK;
+  bool use_duplicate_merge = ARGS_DEFAULT_USE_DUPLICATE_MERGE;
+  double duplicate_tolerance = ARGS_DEFAULT_DUPLICATE_TOLERANCE;
   int grid_resolution = ARGS_DEFAULT_GRID_RESOLUTION;
+  std::string mesh_outfile = ARGS_DEFAULT_MESH_OUTFILE;
+  double max_radius = ARGS_DEFAULT_MAX_RADIUS;
+  double box[6] = {ARGS_DEFAULT_BOX_MIN, ARGS_DEFAULT_BOX_MAX,
+                   ARGS_DEFAULT_BOX_MIN, ARGS_DEFAULT_BOX_MAX,
+                   ARGS_DEFAULT_BOX_MIN, ARGS_DEFAULT_BOX_MAX};
 
   struct option long_options[] = {
     {"version",           no_argument,        0,  'v'},
@@ -99,14 +136,30 @@ parse_args(int argc, char* argv[]) {
     {"chunksize",         required_argument,  0,  'c'},
     {"use-chunking",      no_argument,        0,  'u'},
     {"use-recompute",     no_argument,        0,  'r'},
+    {"use-adaptive-k",    no_argument,        0,  'a'},
+    {"use-radius-recompute", no_argument,     0,  'R'},
+    {"use-knn-stream",    no_argument,        0,  's'},
+    {"use-periodic",      no_argument,        0,  'P'},
+    {"use-precision-retry", no_argument,      0,  'e'},
+    {"use-recentering",   no_argument,        0,  'C'},
+    {"use-perturbation",  no_argument,        0,  'S'},
+    {"use-duplicate-check", no_argument,      0,  'D'},
+    {"use-duplicate-merge", no_argument,      0,  'U'},
+    {"duplicate-tolerance", required_argument, 0, 'T'},
+    {"use-int64",         no_argument,        0,  'L'},
+    {"use-double",        no_argument,        0,  'f'},
     {"p-maxsize",         required_argument,  0,  'p'},
     {"t-maxsize",         required_argument,  0,  'm'},
+    {"mesh-outfile",      required_argument,  0,  'o'},
+    {"box",               required_argument,  0,  'b'},
+    {"max-radius",        required_argument,  0,  'M'},
+    {"walls",             required_argument,  0,  'w'},
     {0, 0, 0, 0}
   };
 
 
   while ((opt = getopt_long(argc, (char* const*)argv, 
-          "vhi:x:k:g:t:d:c:urp:m:", long_options, &option_index)) != -1) {
+          "vhi:x:k:g:t:d:c:uarRsPeCSDUT:Lfp:m:o:b:M:w:", long_options, &option_index)) != -1) {
 
     switch (opt) {
       case 'v':
@@ -155,6 +208,52 @@ parse_args(int argc, char* argv[]) {
         use_recompute = true;
         vtargs["use_recompute"] = use_recompute;
         break;
+      case 'a':
+        use_adaptive_k = true;
+        vtargs["use_adaptive_k"] = use_adaptive_k;
+        break;
+      case 'R':
+        use_radius_recompute = true;
+        vtargs["use_radius_recompute"] = use_radius_recompute;
+        break;
+      case 's':
+        use_knn_stream = true;
+        vtargs["use_knn_stream"] = use_knn_stream;
+        break;
+      case 'P':
+        use_periodic = true;
+        vtargs["use_periodic"] = use_periodic;
+        break;
+      case 'e':
+        use_precision_retry = true;
+        vtargs["use_precision_retry"] = use_precision_retry;
+        break;
+      case 'C':
+        use_recentering = true;
+        vtargs["use_recentering"] = use_recentering;
+        break;
+      case 'S':
+        use_perturbation = true;
+        vtargs["use_perturbation"] = use_perturbation;
+        break;
+      case 'D':
+        use_duplicate_check = true;
+        vtargs["use_duplicate_check"] = use_duplicate_check;
+        break;
+      case 'U':
+        use_duplicate_merge = true;
+        vtargs["use_duplicate_merge"] = use_duplicate_merge;
+        break;
+      case 'T':
+        duplicate_tolerance = std::atof(optarg);
+        vtargs["duplicate_tolerance"] = duplicate_tolerance;
+        break;
+      case 'L':
+        use_int64 = true;
+        break;
+      case 'f':
+        use_double = true;
+        break;
       case 'p':
         cc_p_maxsize = std::atoi(optarg);
         vtargs["cc_p_maxsize"] = cc_p_maxsize;
@@ -163,6 +262,41 @@ parse_args(int argc, char* argv[]) {
         cc_t_maxsize = std::atoi(optarg);
         vtargs["cc_t_maxsize"] = cc_t_maxsize;
         break;
+      case 'o':
+        mesh_outfile = optarg;
+        vtargs["mesh_outfile"] = mesh_outfile;
+        break;
+      case 'b':
+        if (std::sscanf(optarg, "%lf,%lf,%lf,%lf,%lf,%lf", 
+                        &box[0], &box[1], &box[2], 
+                        &box[3], &box[4], &box[5]) != 6) {
+          std::cerr << "Error: " 
+                    << "Box must be given as xmin,xmax,ymin,ymax,zmin,zmax." 
+                    << std::endl;
+          break;
+        }
+        vtargs["box_xmin"] = box[0];
+        vtargs["box_xmax"] = box[1];
+        vtargs["box_ymin"] = box[2];
+        vtargs["box_ymax"] = box[3];
+        vtargs["box_zmin"] = box[4];
+        vtargs["box_zmax"] = box[5];
+        break;
+      case 'M':
+        max_radius = std::atof(optarg);
+        vtargs["max_radius"] = max_radius;
+        break;
+      case 'w': {
+        std::ifstream fp(optarg);
+        if (!fp) {
+          std::cerr << "Error: Could not open file: " << optarg << std::endl;
+          break;
+        }
+        std::stringstream walls;
+        walls << fp.rdbuf();
+        vtargs["walls"] = walls.str();
+        break;
+      }
       case '?':
         std::cerr << "Unknown option" << std::endl;
         break;
@@ -172,39 +306,31 @@ parse_args(int argc, char* argv[]) {
     }
   }
 
-  return std::make_tuple(infile, vtargs, device);
+  return std::make_tuple(infile, vtargs, device, use_int64, use_double);
 
 }
 
-int 
-main(int argc, char* argv[]) {
-
-  if (argc == 0) {
-    print_usage(argv[0]);
-  }
+// Reads the points of 'fname' in Tf and prints their direct neighbors,
+// tessellated on 'device'.
+template <typename Tf>
+static int
+run(const std::string& fname, struct votess::vtargs& vtargs,
+    const enum votess::device device, const bool use_int64) {
 
-  auto [infile, vtargs, device] = parse_args(argc, argv); 
+  std::vector<std::array<Tf, 3>> xyzset;
 
-  if (infile == "") {
-    std::cerr << "Error: Input file must be specified." << std::endl;
-    print_usage(argv[0]);
-    return 1;
-  }
-
-  std::vector<std::array<float, 3>> xyzset;
-
-  std::ifstream file(infile);
+  std::ifstream file(fname);
   std::string line;
 
   if (!file) {
-    std::cerr << "Error: Could not open file: " << infile << std::endl;
+    std::cerr << "Error: Could not open file: " << fname << std::endl;
     return 1;
   }
 
   while (std::getline(file, line)) {
 
     std::istringstream iss(line);
-    std::array<float, 3> point;
+    std::array<Tf, 3> point;
 
     if (!(iss >> point[0] >> point[1] >> point[2])) {
       std::cerr << "Error: Incorrect data format in file" << std::endl;
@@ -222,11 +348,40 @@ main(int argc, char* argv[]) {
 
   }
 
-  auto dnn = votess::tesellate<int, float>(xyzset, vtargs);
-
-  dnn.print();
+  // int indices are only kept while they can number every point
+  if (use_int64 || xyzset.size() > std::numeric_limits<int>::max()) {
+    auto dnn = votess::tesellate<int64_t, Tf>(xyzset, vtargs, device);
+    dnn.print();
+  } else {
+    auto dnn = votess::tesellate<int, Tf>(xyzset, vtargs, device);
+    dnn.print();
+  }
 
   return 0;
+
+}
+
+int 
+main(int argc, char* argv[]) {
+
+  if (argc == 0) {
+    print_usage(argv[0]);
+  }
+
+  auto [infile, vtargs, device, use_int64, use_double] = 
+    parse_args(argc, argv); 
+
+  if (infile == "") {
+    std::cerr << "Error: Input file must be specified." << std::endl;
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  if (use_double) {
+    return run<double>(infile, vtargs, device, use_int64);
+  }
+  return run<float>(infile, vtargs, device, use_int64);
+
 }
 
 #else
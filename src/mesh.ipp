@@ -0,0 +1,244 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <limits>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Internal
+///////////////////////////////////////////////////////////////////////////////
+
+namespace mesh {
+namespace internal {
+
+static inline bool little_endian(void) {
+  const uint16_t one = 1;
+  return *reinterpret_cast<const uint8_t*>(&one) == 1;
+}
+
+// Writes 'v' to 'os' in big endian if 'big' is set, in little endian if not.
+template <typename T>
+static inline void put(std::ostream& os, const T v, const bool big) {
+  char b[sizeof(T)];
+  std::memcpy(b, &v, sizeof(T));
+  if (big == little_endian()) std::reverse(b, b + sizeof(T));
+  os.write(b, sizeof(T));
+}
+
+template <typename Tf>
+static inline const char* type_name(void) {
+  return sizeof(Tf) == sizeof(double) ? "double" : "float";
+}
+
+// VTK_POLYHEDRON
+static constexpr int32_t vtk_polyhedron = 42;
+
+} // namespace internal
+} // namespace mesh
+
+///////////////////////////////////////////////////////////////////////////////
+/// Writer
+///////////////////////////////////////////////////////////////////////////////
+
+inline enum mesh::format mesh::get_format(const std::string& fname) {
+  const std::string ext = ".ply";
+  if (fname.size() >= ext.size() &&
+      fname.compare(fname.size() - ext.size(), ext.size(), ext) == 0) {
+    return format::ply;
+  }
+  return format::vtk;
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf>
+mesh::writer<Tf>::writer(const std::string& _fname)
+  : fname(_fname), format(get_format(_fname)), open(true),
+    nvertices(0), ncells(0), nfaces(0), csize(0) {
+
+  if (format == format::vtk) {
+    names = {"points", "cells", "types", "index", "volume", "neighbors"};
+  } else {
+    names = {"vertices", "faces"};
+  }
+
+  for (const auto& name : names) {
+    sections.emplace_back(fname + "." + name + ".tmp", std::ios::binary);
+    if (!sections.back()) {
+      std::cerr << "Failed to open file: "
+                << fname + "." + name + ".tmp" << std::endl;
+      open = false;
+    }
+  }
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf>
+mesh::writer<Tf>::~writer() {
+  close();
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf>
+bool mesh::writer<Tf>::good(void) const {
+  return open;
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf>
+void mesh::writer<Tf>::add(
+  const size_t index,
+  const std::vector<Tf>& vertices,
+  const std::vector<unsigned short int>& loops,
+  const Tf volume,
+  const int nneighbors
+) {
+
+  using internal::put;
+
+  if (!open || vertices.empty()) return;
+
+  const size_t nv = vertices.size() / 3;
+
+  size_t nf = 0;
+  for (size_t c = 0; c < loops.size(); c += loops[c] + 1) nf++;
+
+  const size_t imax = std::numeric_limits<int32_t>::max();
+  if (index > imax || nvertices + nv > imax || nfaces + nf > imax || 
+      csize + 2 + loops.size() > imax) {
+    std::cerr << "Mesh does not fit in 32-bit indices, not written: " 
+              << fname << std::endl;
+    open = false;
+    close();
+    return;
+  }
+
+  const int32_t base = nvertices;
+
+  if (format == format::vtk) {
+
+    auto& points = sections[0];
+    auto& cells = sections[1];
+
+    for (size_t j = 0; j < 3 * nv; j++) put<Tf>(points, vertices[j], true);
+
+    // face stream: size, number of faces, then each face as in loops
+    put<int32_t>(cells, 1 + loops.size(), true);
+    put<int32_t>(cells, nf, true);
+    for (size_t c = 0; c < loops.size(); c += loops[c] + 1) {
+      put<int32_t>(cells, loops[c], true);
+      for (size_t j = 1; j <= loops[c]; j++) {
+        put<int32_t>(cells, base + loops[c + j], true);
+      }
+    }
+
+    put<int32_t>(sections[2], internal::vtk_polyhedron, true);
+    put<int32_t>(sections[3], index, true);
+    put<Tf>(sections[4], volume, true);
+    put<int32_t>(sections[5], nneighbors, true);
+
+    csize += 2 + loops.size();
+
+  } else {
+
+    auto& points = sections[0];
+    auto& faces = sections[1];
+
+    for (size_t j = 0; j < 3 * nv; j++) put<Tf>(points, vertices[j], false);
+
+    for (size_t c = 0; c < loops.size(); c += loops[c] + 1) {
+      put<int32_t>(faces, loops[c], false);
+      for (size_t j = 1; j <= loops[c]; j++) {
+        put<int32_t>(faces, base + loops[c + j], false);
+      }
+      put<int32_t>(faces, index, false);
+      put<Tf>(faces, volume, false);
+      put<int32_t>(faces, nneighbors, false);
+    }
+
+  }
+
+  nvertices += nv;
+  nfaces += nf;
+  ncells += 1;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Tf>
+void mesh::writer<Tf>::close(void) {
+
+  if (sections.empty()) return;
+
+  for (auto& section : sections) section.close();
+
+  std::ofstream fp;
+  if (open) {
+    fp.open(fname, std::ios::binary);
+    if (!fp) {
+      std::cerr << "Failed to open file: " << fname << std::endl;
+    }
+  }
+
+  // text to write before each section
+  std::vector<std::string> heads;
+  const std::string tf = internal::type_name<Tf>();
+
+  if (format == format::vtk) {
+    const std::string nc = std::to_string(ncells);
+    heads = {
+      "# vtk DataFile Version 4.2\n"
+      "votess\n"
+      "BINARY\n"
+      "DATASET UNSTRUCTURED_GRID\n"
+      "POINTS " + std::to_string(nvertices) + " " + tf + "\n",
+      "\nCELLS " + nc + " " + std::to_string(csize) + "\n",
+      "\nCELL_TYPES " + nc + "\n",
+      "\nCELL_DATA " + nc + "\n"
+      "SCALARS index int 1\nLOOKUP_TABLE default\n",
+      "\nSCALARS volume " + tf + " 1\nLOOKUP_TABLE default\n",
+      "\nSCALARS neighbors int 1\nLOOKUP_TABLE default\n",
+    };
+  } else {
+    heads = {
+      "ply\n"
+      "format binary_little_endian 1.0\n"
+      "comment votess\n"
+      "element vertex " + std::to_string(nvertices) + "\n"
+      "property " + tf + " x\n"
+      "property " + tf + " y\n"
+      "property " + tf + " z\n"
+      "element face " + std::to_string(nfaces) + "\n"
+      "property list int int vertex_indices\n"
+      "property int cell\n"
+      "property " + tf + " volume\n"
+      "property int neighbors\n"
+      "end_header\n",
+      "",
+    };
+  }
+
+  for (size_t s = 0; s < sections.size(); s++) {
+    const std::string name = fname + "." + names[s] + ".tmp";
+    if (fp) {
+      std::ifstream in(name, std::ios::binary);
+      fp << heads[s];
+      if (in.peek() != std::ifstream::traits_type::eof()) fp << in.rdbuf();
+    }
+    std::remove(name.c_str());
+  }
+  if (fp && format == format::vtk) fp << "\n";
+
+  sections.clear();
+  open = false;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// End
+///////////////////////////////////////////////////////////////////////////////
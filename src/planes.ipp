@@ -46,6 +46,83 @@ inline T2 planes::dot(
   return dotp;
 }
 
+template <typename T2>
+inline bool planes::uncertain(
+  const T2 dotp,
+  const T2 a1, const T2 b1, const T2 c1, const T2 d1,
+  const T2 a2, const T2 b2, const T2 c2, const T2 d2,
+  const T2 cancelled
+) {
+  const T2 scale = sycl::fabs(a1 * a2) + sycl::fabs(b1 * b2) + 
+                   sycl::fabs(c1 * c2) + sycl::fabs(d1 * d2) + 
+                   sycl::fabs(cancelled);
+  const T2 eps = std::numeric_limits<T2>::epsilon() * 8;
+  return sycl::fabs(dotp) <= eps * scale;
+}
+
+// Writing q as l1 * n1 + l2 * n2 + l3 * n3 in the normals of the vertex,
+// moving the offset of each plane made from point o by (w[o] - w[p]) / 2
+// changes the dot product by half of
+//   w[oq] - l1 w[o1] - l2 w[o2] - l3 w[o3] - (1 - l1 - l2 - l3) w[p],
+// summed over the bisectors only. With each weight infinitely larger than
+// the ones of higher indices, the sign is the one of the first coefficient
+// that is not zero, in index order. The coefficient of oq always is unless
+// a periodic image of it is also on the vertex, so this rarely goes past the
+// first few points.
+template <typename T2, typename Ti>
+inline int planes::perturbed(
+  const T2 a1, const T2 b1, const T2 c1, const Ti o1,
+  const T2 a2, const T2 b2, const T2 c2, const Ti o2,
+  const T2 a3, const T2 b3, const T2 c3, const Ti o3,
+  const T2 aq, const T2 bq, const T2 cq, const Ti oq,
+  const Ti op
+) {
+
+  const auto triple = [](
+    const T2 x1, const T2 y1, const T2 z1,
+    const T2 x2, const T2 y2, const T2 z2,
+    const T2 x3, const T2 y3, const T2 z3
+  ) {
+    return x1 * (y2 * z3 - y3 * z2) - 
+           y1 * (x2 * z3 - x3 * z2) + 
+           z1 * (x2 * y3 - x3 * y2);
+  };
+
+  const T2 det = triple(a1, b1, c1, a2, b2, c2, a3, b3, c3);
+  if (det == 0) return 0;
+
+  const T2 l1 = triple(aq, bq, cq, a2, b2, c2, a3, b3, c3) / det;
+  const T2 l2 = triple(a1, b1, c1, aq, bq, cq, a3, b3, c3) / det;
+  const T2 l3 = triple(a1, b1, c1, a2, b2, c2, aq, bq, cq) / det;
+
+  const Ti id[5] = {oq, o1, o2, o3, op};
+  T2 cf[5] = {1, -l1, -l2, -l3, 1};
+  for (int j = 1; j < 4; j++) {
+    if (id[j] >= 0) cf[4] += cf[j];
+  }
+  cf[4] = -cf[4];
+
+  // coefficients this small are zero up to the rounding of l1, l2 and l3
+  const T2 eps = std::numeric_limits<T2>::epsilon() * 1024 * 
+                 (1 + sycl::fabs(l1) + sycl::fabs(l2) + sycl::fabs(l3));
+
+  // images of the same point share its weight, so their coefficients add up
+  int sign = 0;
+  Ti first = -1;
+  for (int j = 0; j < 5; j++) {
+    if (id[j] < 0 || (first >= 0 && id[j] >= first)) continue;
+    T2 c = 0;
+    for (int m = 0; m < 5; m++) {
+      if (id[m] == id[j]) c += cf[m];
+    }
+    if (sycl::fabs(c) <= eps) continue;
+    first = id[j];
+    sign = c > 0 ? 1 : -1;
+  }
+  return sign;
+
+}
+
 #include <utils.hpp>
 template <typename T2>
 inline void planes::bisect(
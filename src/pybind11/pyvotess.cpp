@@ -1,8 +1,76 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 
 #include "votess.hpp"
 #include "arguments.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+///////////////////////////////////////////////////////////////////////////////
+/// Helper Functions                                                        ///
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Ti>
+static void bind_dnn(pybind11::module& module, 
+                     const char* name, const char* proxy) {
+
+  pybind11::class_<typename votess::dnn<Ti>::proxy>(module, proxy)
+    .def("__getitem__", [](typename votess::dnn<Ti>::proxy &self, int i) 
+        -> Ti & {
+      return self[i];
+    }, pybind11::return_value_policy::reference_internal)
+    .def("size", &votess::dnn<Ti>::proxy::size);
+
+  pybind11::class_<votess::dnn<Ti>>(module, name)
+    .def(pybind11::init<>())
+    .def(pybind11::init<std::vector<Ti>&, std::vector<size_t>&>())
+    .def("size", &votess::dnn<Ti>::size)
+    .def("__getitem__", [](votess::dnn<Ti> &instance, int i) 
+        -> typename votess::dnn<Ti>::proxy {
+      return instance[i];
+    }, pybind11::return_value_policy::reference_internal)
+    .def("print", &votess::dnn<Ti>::print)
+    .def("savetxt", &votess::dnn<Ti>::savetxt)
+    .def_readonly("alias", &votess::dnn<Ti>::alias);
+
+}
+
+// Tessellates an (n, 3) array in its own precision Tf, with int indices
+// while they can number every point. The points are sorted and read in place
+// in the array, as with the C++ interface, without being copied out of it.
+template <typename Tf>
+static pybind11::object tesellate_array(
+  pybind11::array_t<Tf, pybind11::array::c_style>& array,
+  const class votess::vtargs& vtargs,
+  const enum votess::device device,
+  const bool use_int64
+) {
+
+  static_assert(sizeof(std::array<Tf, 3>) == 3 * sizeof(Tf),
+                "rows of the array must map onto std::array<Tf, 3>");
+
+  if (array.ndim() != 2 || array.shape(1) != 3) {
+    throw std::invalid_argument("xyzset must be of shape (n, 3)");
+  }
+
+  const size_t size = array.shape(0);
+  auto* xyzset = reinterpret_cast<std::array<Tf, 3>*>(array.mutable_data());
+
+  const size_t imax = std::numeric_limits<int>::max();
+  if (use_int64 || size > imax) {
+    return pybind11::cast(
+      votess::tesellate<int64_t, Tf>(xyzset, size, vtargs, device)
+    );
+  }
+  return pybind11::cast(
+    votess::tesellate<int, Tf>(xyzset, size, vtargs, device)
+  );
+
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Pybind Module                                                           ///
 ///////////////////////////////////////////////////////////////////////////////
@@ -36,11 +104,13 @@ pybind11::class_<votess::vtargs>(module, "vtargs")
     if (pybind11::isinstance<pybind11::int_>(value)) {
       self[key] = value.cast<int>();
     } else if (pybind11::isinstance<pybind11::float_>(value)) {
-      self[key] = value.cast<float>();
+      self[key] = value.cast<double>();
     } else if (pybind11::isinstance<pybind11::str>(value)) {
       self[key] = value.cast<std::string>();
     } else if (pybind11::isinstance<pybind11::bool_>(value)) {
       self[key] = value.cast<bool>();
+    } else if (pybind11::isinstance<pybind11::sequence>(value)) {
+      self[key] = value.cast<votess::planes_t>();
     } else {
       throw std::invalid_argument("Unsupported value type");
     }
@@ -50,22 +120,8 @@ pybind11::class_<votess::vtargs>(module, "vtargs")
 /* class votess::dnn                                                         */
 /* ------------------------------------------------------------------------- */
 
-pybind11::class_<votess::dnn<int>::proxy>(module, "Proxy")
-  .def("__getitem__", [](votess::dnn<int>::proxy &self, int i) -> int & {
-    return self[i];
-  }, pybind11::return_value_policy::reference_internal)
-  .def("size", &votess::dnn<int>::proxy::size);
-
-pybind11::class_<votess::dnn<int>>(module, "dnn")
-  .def(pybind11::init<>())
-  .def(pybind11::init<std::vector<int>&, std::vector<int>&>())
-  .def("size", &votess::dnn<int>::size)
-  .def("__getitem__", [](votess::dnn<int> &instance, int i) 
-      -> votess::dnn<int>::proxy {
-    return instance[i];
-  }, pybind11::return_value_policy::reference_internal)
-  .def("print", &votess::dnn<int>::print)
-  .def("savetxt", &votess::dnn<int>::savetxt);
+bind_dnn<int>(module, "dnn", "Proxy");
+bind_dnn<int64_t>(module, "dnn64", "Proxy64");
 
 /* ------------------------------------------------------------------------- */
 /*   votess::tesellate                                                       */
@@ -73,15 +129,38 @@ pybind11::class_<votess::dnn<int>>(module, "dnn")
 
 module.def(
   "tesellate",
-  [](std::vector<std::array<float, 3>>& xyzset,
+  [](pybind11::array xyzset,
      class votess::vtargs vtargs, 
-     const enum votess::device device) {
-      return votess::tesellate<int, float>(xyzset, vtargs, device);
+     const enum votess::device device,
+     const bool use_int64) -> pybind11::object {
+      // the points are sorted in place, so arrays that would have to be
+      // copied or converted first are refused rather than sorted unseen
+      if (!(xyzset.flags() & pybind11::array::c_style) || 
+          !xyzset.writeable()) {
+        throw std::invalid_argument(
+          "xyzset must be a writeable C-contiguous array"
+        );
+      }
+      if (pybind11::isinstance<pybind11::array_t<float>>(xyzset)) {
+        auto points = pybind11::array_t<float, pybind11::array::c_style>
+                      ::ensure(xyzset);
+        return tesellate_array<float>(points, vtargs, device, use_int64);
+      }
+      if (pybind11::isinstance<pybind11::array_t<double>>(xyzset)) {
+        auto points = pybind11::array_t<double, pybind11::array::c_style>
+                      ::ensure(xyzset);
+        return tesellate_array<double>(points, vtargs, device, use_int64);
+      }
+      throw std::invalid_argument("xyzset must be a float32 or float64 array");
   }, pybind11::arg("xyzset"),
      pybind11::arg("args"),
      pybind11::arg("device") = votess::device::gpu,
+     pybind11::arg("use_int64") = false,
 
-  "A function to tessellate XYZ datasets."
+  "A function to tessellate XYZ datasets, in the precision of their dtype. "
+  "xyzset must be a writeable C-contiguous float32 or float64 array, and is "
+  "sorted in place. Returns a dnn, or a dnn64 with use_int64 set or past "
+  "2^31 - 1 points."
 
 );
 
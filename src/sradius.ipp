@@ -28,3 +28,8 @@ inline bool sr::is_reached(
   const bool cond = radius > 4.0f * security_radius;
   return cond;
 }
+
+template <typename Tf>
+inline Tf sr::margin(const bool perturb) {
+  return perturb ? 1 + std::numeric_limits<Tf>::epsilon() * 64 : 1;
+}
@@ -4,6 +4,7 @@
 
 #include <knn.hpp>
 #include <cc.hpp>
+#include <mesh.hpp>
 
 #include <iostream>
 #include <chrono>
@@ -13,6 +14,7 @@
 #include <cstdint>
 #include <thread>
 #include <mutex>
+#include <algorithm>
 #include <iomanip>
 #include <fstream>
 
@@ -133,16 +135,237 @@ tmpnn_fill(
 
 }
 
+// Single cell variant, for the CPU paths where each thread keeps the
+// neighbors of the cell it works on at the front of knn.
+template <typename Ti>
+static inline void 
+tmpnn_fill(
+  std::vector<Ti>& nn,
+  const std::vector<Ti>& knn
+) {
+  nn.clear();
+  for (const auto& ki : knn) {
+    if (ki == __INTERNAL__K_UNDEFINED) {
+      break;
+    }
+    nn.push_back(ki);
+  }
+}
+
+// Everything reported for each cell besides its neighbors. The geometry and
+// the faces are only computed when they were asked for. With a writer, the
+// volume and polyhedron of each cell are also computed, to be streamed to it.
+template <typename Tf>
+struct report {
+  bool use_geometry;
+  bool use_faces;
+  bool use_topology;
+  struct cells<Tf> cells;
+  struct faces<Tf> faces;
+  std::vector<std::vector<Tf>> tmpfaces;  // 7 values per neighbor of a cell
+  std::vector<std::vector<Tf>> tmpvertices;
+  std::vector<std::vector<unsigned short int>> tmploops;
+  mesh::writer<Tf>* writer;
+  std::vector<bool> tmpwritten;
+};
+
+template <typename Tf, typename Tu, typename Ts = Tf>
+static inline void
+attach(cci::scratch<Ts, Tu>& buf, const struct report<Tf>& out) {
+  buf.geometry = out.use_geometry || out.writer != nullptr;
+  buf.faces = out.use_faces;
+  buf.topology = out.use_topology || out.writer != nullptr;
+}
+
+// 'buf' may clip in a wider type than the report, Ts, in which case its
+// values are rounded to Tf.
+template <typename Tf, typename Tu, typename Ts = Tf>
+static inline void
+store(
+  struct report<Tf>& out,
+  const size_t index,
+  const cci::scratch<Ts, Tu>& buf
+) {
+  out.cells.radius[index] = buf.radius;
+  if (buf.geometry) {
+    out.cells.volume[index] = buf.volume;
+    out.cells.centroid[index] = {static_cast<Tf>(buf.centroid[0]), 
+                                 static_cast<Tf>(buf.centroid[1]), 
+                                 static_cast<Tf>(buf.centroid[2])};
+    out.cells.area[index] = buf.area;
+  }
+  if (out.use_faces) {
+    out.tmpfaces[index].assign(buf.records.begin(), buf.records.end());
+  }
+  if (buf.topology) {
+    out.tmpvertices[index].assign(buf.vertices.begin(), buf.vertices.end());
+    out.tmploops[index] = buf.loops;
+  }
+}
+
+// Streams the cells in [begin, end) that have a polyhedron and were not
+// written yet to out.writer. Their polyhedron is then let go of, unless it
+// was asked for as well. Cells flagged to be rerun in higher precision are
+// left for after the rerun.
+template <typename Ti, typename Tf>
+static void
+tmpmesh_put(
+  struct report<Tf>& out,
+  const std::vector<std::vector<Ti>>& tmpnn,
+  const std::vector<cc::state>& states,
+  const size_t begin, const size_t end
+) {
+  for (size_t i = begin; i < end; i++) {
+
+    if (out.tmpwritten[i] || out.tmpvertices[i].empty()) continue;
+    if (states[i].get(cc::uncertain_orientation)) continue;
+
+    int nneighbors = 0;
+    for (const auto& neighbor : tmpnn[i]) {
+      if (neighbor == cc::k_undefined) break;
+      nneighbors++;
+    }
+
+    out.writer->add(i, out.tmpvertices[i], out.tmploops[i], 
+                    out.cells.volume[i], nneighbors);
+    out.tmpwritten[i] = true;
+
+    if (!out.use_topology) {
+      out.tmpvertices[i].clear();
+      out.tmpvertices[i].shrink_to_fit();
+      out.tmploops[i].clear();
+      out.tmploops[i].shrink_to_fit();
+    }
+
+  }
+}
+
+// Lays the faces out like tmpnn_getdnn() does the neighbors. Must be called
+// before it, as it clears tmpnn. Neighbors without a face, i.e. those of
+// cells that could not be completed, get NaN.
+template <typename Ti, typename Tf>
+static void
+tmpfaces_get(
+  const std::vector<std::vector<Ti>>& tmpnn,
+  std::vector<std::vector<Tf>>& tmpfaces,
+  struct faces<Tf>& faces
+) {
+
+  const Tf nan = std::numeric_limits<Tf>::quiet_NaN();
+
+  faces.area.clear();
+  faces.centroid.clear();
+  faces.normal.clear();
+
+  for (size_t i = 0; i < tmpnn.size(); i++) {
+
+    const auto& r = tmpfaces[i];
+    for (size_t j = 0; j < tmpnn[i].size(); j++) {
+      if (tmpnn[i][j] == cc::k_undefined) break;
+      if (7 * j + 7 > r.size()) {
+        faces.area.push_back(nan);
+        faces.centroid.push_back({nan, nan, nan});
+        faces.normal.push_back({nan, nan, nan});
+        continue;
+      }
+      faces.area.push_back(r[7 * j + 0]);
+      faces.centroid.push_back({r[7 * j + 1], r[7 * j + 2], r[7 * j + 3]});
+      faces.normal.push_back({r[7 * j + 4], r[7 * j + 5], r[7 * j + 6]});
+    }
+
+    tmpfaces[i].clear();
+    tmpfaces[i].shrink_to_fit();
+
+  }
+
+}
+
+// Lays the vertices and faces of every cell out in 'polyhedra'. The offsets
+// are summed up first, so that the cells can then be copied over in
+// parallel, each to its own range.
+template <typename Ti, typename Tf>
+static void
+tmppolyhedra_get(
+  std::vector<std::vector<Tf>>& tmpvertices,
+  std::vector<std::vector<unsigned short int>>& tmploops,
+  const class dnn<Ti>& dnn,
+  struct polyhedra<Ti, Tf>& polyhedra,
+  const size_t nthreads
+) {
+
+  const size_t size = tmpvertices.size();
+
+  // loop entries of cell i start at lbase[i]
+  std::vector<size_t> lbase(size + 1, 0);
+  polyhedra.voffs.assign(size + 1, 0);
+  polyhedra.foffs.assign(size + 1, 0);
+
+  for (size_t i = 0; i < size; i++) {
+    size_t nfaces = 0;
+    const auto& l = tmploops[i];
+    for (size_t c = 0; c < l.size(); c += l[c] + 1) nfaces++;
+    polyhedra.voffs[i + 1] = polyhedra.voffs[i] + tmpvertices[i].size() / 3;
+    polyhedra.foffs[i + 1] = polyhedra.foffs[i] + nfaces;
+    lbase[i + 1] = lbase[i] + l.size() - nfaces;
+  }
+
+  polyhedra.vertices.resize(polyhedra.voffs[size]);
+  polyhedra.loffs.resize(polyhedra.foffs[size] + 1);
+  polyhedra.loops.resize(lbase[size]);
+  polyhedra.neighbor.resize(polyhedra.foffs[size]);
+  polyhedra.loffs[0] = 0;
+
+  const size_t threadsize = size / nthreads;
+
+  std::vector<std::thread> threads(nthreads);
+  for (size_t n = 0; n < nthreads; n++) {
+
+    const size_t _tstart = n * threadsize;
+    const size_t _tend = (n != nthreads - 1) ? _tstart + threadsize : size;
+
+    threads[n] = std::thread([&,_tstart,_tend]() {
+      for (size_t i = _tstart; i < _tend; i++) {
+
+        const auto& v = tmpvertices[i];
+        for (size_t j = 0; j < v.size() / 3; j++) {
+          polyhedra.vertices[polyhedra.voffs[i] + j] = 
+            {v[3 * j + 0], v[3 * j + 1], v[3 * j + 2]};
+        }
+
+        const auto& l = tmploops[i];
+        const size_t nsize = dnn.offs[i + 1] - dnn.offs[i];
+        size_t f = polyhedra.foffs[i];
+        size_t e = lbase[i];
+        for (size_t c = 0; c < l.size(); c += l[c] + 1, f++) {
+          for (size_t j = 1; j <= l[c]; j++) polyhedra.loops[e++] = l[c + j];
+          polyhedra.loffs[f + 1] = e;
+          const size_t j = f - polyhedra.foffs[i];
+          polyhedra.neighbor[f] = j < nsize ? dnn.list[dnn.offs[i] + j] : -1;
+        }
+
+        tmpvertices[i].clear();
+        tmpvertices[i].shrink_to_fit();
+        tmploops[i].clear();
+        tmploops[i].shrink_to_fit();
+
+      }
+    });
+
+  }
+  for (auto& thread : threads) thread.join();
+
+}
+
 template <typename Ti>
 static class dnn<Ti>
 tmpnn_getdnn(std::vector<std::vector<Ti>>& tmpnn) {
 
-  const Ti xyzsize =  tmpnn.size();
+  const size_t xyzsize =  tmpnn.size();
   std::vector<Ti> _list(0);
-  std::vector<Ti> _offs(xyzsize + 1);
+  std::vector<size_t> _offs(xyzsize + 1);
   _offs[0] = 0;
 
-  for (Ti i = 0; i < xyzsize; i++) {
+  for (size_t i = 0; i < xyzsize; i++) {
 
     for (const auto& neighbor : tmpnn[i]) {
       if (neighbor == cc::k_undefined) {
@@ -157,7 +380,7 @@ tmpnn_getdnn(std::vector<std::vector<Ti>>& tmpnn) {
 
   }
 
-  for (Ti i = 1; i < xyzsize + 1; i++) {
+  for (size_t i = 1; i < xyzsize + 1; i++) {
     _offs[i] += _offs[i - 1];
   }
 
@@ -173,41 +396,41 @@ template <typename Ti, typename Tf, typename Tu>
 static void
 __gpu__tesellate(
 
-  const std::vector<std::array<Tf,3>>& _xyzset,
+  const xyzset::span<const std::array<Tf,3>>& _xyzset,
   const std::vector<Ti>& id,
   const std::vector<Ti>& offset,
 
-  const std::vector<std::array<Tf,3>>& _refset,
+  const xyzset::span<const std::array<Tf,3>>& _refset,
   std::vector<std::vector<Ti>>& tmpnn,
+  struct report<Tf>& out,
   std::vector<cc::state>& states, 
 
   const class vtargs& args
 
 ) {
 
-  const int k = args["k"];
+  const size_t k = args["k"];
   const int p_maxsize = args["cc_p_maxsize"];
   const int t_maxsize = args["cc_t_maxsize"];
 
-  const Ti xyzsize = _xyzset.size();
-  const Ti refsize = _refset.size();
+  // offsets into the buffers below run past the range of Ti, so they are
+  // all computed in size_t
+  const size_t xyzsize = _xyzset.size();
+  const size_t refsize = _refset.size();
 
   const int ndsize = args["gpu_ndsize"].get<int>() > 0 ?
                      args["gpu_ndsize"] : 1;
 
-  const int chunksize = args["use_chunking"].get<bool>() ? 
-                        args["chunksize"] : refsize + 1;
+  const int nchunk = args["chunksize"];
+  const size_t chunksize = args["use_chunking"].get<bool>() && nchunk > 0 ? 
+                           nchunk : refsize + 1;
 
-  const int nruns = (chunksize > 0) && 
-                    (chunksize < refsize) ? 
-                    refsize / chunksize + 1: 1;
+  const size_t nruns = chunksize < refsize ? refsize / chunksize + 1 : 1;
 
-  Ti subsize = (chunksize > 0) && 
-               (chunksize < refsize) ? 
-               chunksize : refsize;
+  size_t subsize = chunksize < refsize ? chunksize : refsize;
 
   std::vector<Tf> xyzset(3 * xyzsize);
-  for (int i = 0; i < xyzsize; i++) {
+  for (size_t i = 0; i < xyzsize; i++) {
     xyzset[xyzsize * 0 + i] = _xyzset[i][0];
     xyzset[xyzsize * 1 + i] = _xyzset[i][1];
     xyzset[xyzsize * 2 + i] = _xyzset[i][2];
@@ -234,7 +457,11 @@ __gpu__tesellate(
   sycl::buffer<Tf,1>      bP(sycl::range<1>(subsize * p_maxsize * 4));
   sycl::buffer<Tu,1> bT(sycl::range<1>(subsize * t_maxsize * 3));
 
-  for (int run = 0; run < nruns; run++) {
+  // face of each neighbor, only written to when faces were asked for
+  const bool use_faces = out.use_faces;
+  sycl::buffer<Tf,1> bF(sycl::range<1>(use_faces ? subsize * k * 7 : 1));
+
+  for (size_t run = 0; run < nruns; run++) {
     
     std::cout << "[chunking] run : " << run << "/" << nruns << std::endl;
 
@@ -266,6 +493,14 @@ __gpu__tesellate(
       });
     });
 
+    queue.submit([&](sycl::handler& cgh) {
+      auto a = sycl::accessor(bF, cgh, sycl::write_only, sycl::no_init);
+      cgh.parallel_for<class fill_faces>
+      (sycl::range<1>(bF.size()), [=](sycl::id<1> idx) {
+        a[idx] = std::numeric_limits<Tf>::quiet_NaN();
+      });
+    });
+
     queue.submit([&](sycl::handler& cgh) {
       auto a = sycl::accessor(bindices, cgh, sycl::write_only, sycl::no_init);
       cgh.parallel_for<class indices_init>
@@ -276,8 +511,9 @@ __gpu__tesellate(
 
     queue.wait();
 
-    auto args_cc = args.get_cc();
-    auto args_knn = args.get_knn();
+    // in Tf, so that the kernel does no double arithmetic
+    const args::device_cc<Tf> args_cc(args.get_cc());
+    const args::device_knn<Tf> args_knn(args.get_knn());
     
     queue.submit([&](sycl::handler& cgh) {
 
@@ -292,6 +528,7 @@ __gpu__tesellate(
       auto aheap_id = sycl::accessor(bheap_id, cgh, read_write);
       auto aheap_pq = sycl::accessor(bheap_pq, cgh, read_write);
       auto adknn = sycl::accessor(bdknn, cgh, read_write);
+      auto aF = sycl::accessor(bF, cgh, read_write);
 
       auto aP  = sycl::accessor(bP,  cgh, read_write, property::no_init());
       auto aT  = sycl::accessor(bT,  cgh, read_write, property::no_init());
@@ -299,6 +536,8 @@ __gpu__tesellate(
 
       sycl::local_accessor<Tu, 1> 
       ldR(sycl::range<1>(ndsize * p_maxsize), cgh);
+      sycl::local_accessor<Tu, 1> 
+      ldE(sycl::range<1>(ndsize * 2 * boundary::table_size), cgh);
 
       auto aargs_knn = args_knn;
       auto aargs_cc = args_cc;
@@ -310,10 +549,12 @@ __gpu__tesellate(
         const size_t g_index = it.get_global_linear_id();
         const size_t l_index = it.get_local_linear_id();
 
+        // the buffers hold the cells of the chunk, with a stride of subsize,
+        // and refset every point, with a stride of refsize
         knni::compute<Ti, Tf>(
           g_index, aindices[g_index],
           axyzset, xyzsize, aid, aoffset,
-          axyzset, subsize,
+          axyzset, refsize,
           aheap_id, aheap_pq, subsize,
           aargs_knn
         );
@@ -322,11 +563,12 @@ __gpu__tesellate(
         cci::compute<Ti, Tf, Tu>(
           g_index, l_index, aindices[g_index],
           astates,
-          aP, aT, ldR,
+          aP, subsize, aT, ldR, ldE,
           aheap_id, subsize,
           adknn,
+          aF, use_faces,
           axyzset, xyzsize,
-          axyzset, subsize,
+          axyzset, refsize,
           aargs_cc
         );
         #endif
@@ -344,14 +586,25 @@ __gpu__tesellate(
 
     std::vector<Ti> _knn(hknn.begin(), hknn.end());
     std::vector<Ti> knn(_knn.size());
-    for (int si = 0; si < subsize; si++) {
-      for (int ki = 0; ki < k; ki++) {
+    for (size_t si = 0; si < subsize; si++) {
+      for (size_t ki = 0; ki < k; ki++) {
         knn[k * si + ki] = _knn[subsize * ki + si];
       }
     }
 
     tmpnn_fill(tmpnn, indices, subsize, knn, args);
 
+    if (use_faces) {
+      auto hF = bF.get_host_access();
+      for (size_t si = 0; si < subsize; si++) {
+        auto& r = out.tmpfaces[indices[si]];
+        r.resize(7 * tmpnn[indices[si]].size());
+        for (size_t j = 0; j < r.size(); j++) {
+          r[j] = hF[subsize * j + si];
+        }
+      }
+    }
+
   }
 
 
@@ -365,61 +618,58 @@ template <typename Ti, typename Tf, typename Tu>
 static void
 __cpu__tesellate(
 
-  const std::vector<std::array<Tf,3>>& xyzset,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
   const std::vector<Ti>& id,
   const std::vector<Ti>& offset,
 
-  const std::vector<std::array<Tf,3>>& refset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
   std::vector<std::vector<Ti>>& tmpnn,
+  struct report<Tf>& out,
   std::vector<cc::state>& states, 
 
-  const class vtargs& args
+  const class vtargs& args,
+
+  std::vector<cci::snapshot<Ti, Tf, Tu>>* snapshots = nullptr
 
 ) {
   
   const Ti xyzsize = xyzset.size();
-  const Ti refsize = refset.size();
+  const size_t refsize = refset.size();
 
   const size_t nthreads = args["cpu_nthreads"].get<size_t>() != 0 ?
                           args["cpu_nthreads"] : 
                           std::thread::hardware_concurrency(); 
 
-  const int chunksize = args["use_chunking"].get<bool>() ? 
-                        args["chunksize"] : refsize + 1;
+  const int nchunk = args["chunksize"];
+  const size_t chunksize = args["use_chunking"].get<bool>() && nchunk > 0 ? 
+                           nchunk : refsize + 1;
 
-  const int nruns = (chunksize > 0) && 
-                    (chunksize < refsize) ? 
-                    refsize / chunksize + 1: 1;
+  const size_t nruns = chunksize < refsize ? refsize / chunksize + 1 : 1;
 
-  Ti subsize = (chunksize > 0) && 
-               (chunksize < refsize) ?
-               chunksize : refsize;
+  size_t subsize = chunksize < refsize ? chunksize : refsize;
 
   std::cout << "nthread = " << nthreads << std::endl; 
   std::cout << "chunksize = " << chunksize << std::endl; 
   std::cout << "nruns = " << nruns << std::endl; 
 
+  // one snapshot store per thread, appended to across runs.
+  if (snapshots != nullptr) {
+    snapshots->resize(nthreads);
+  }
+
   const int k = args["k"];
-  const int p_maxsize = args["cc_p_maxsize"];
-  const int t_maxsize = args["cc_t_maxsize"];
+  const bool use_knn_stream = args["use_knn_stream"];
+  const bool use_adaptive_k = args["use_adaptive_k"].get<bool>() && 
+                              !use_knn_stream;
+  const int k_min = args["k_min"];
+  const int k_max = args["k_max"];
 
   std::vector<Ti> indices(subsize);
 
-  std::vector<Ti> heap_id(subsize * k);
-  std::vector<Tf> heap_pq(subsize * k);
-  std::vector<Ti> dknn(subsize * k);
-  std::vector<Ti>& knn = heap_id;
-
-  std::vector<Tf>       P(subsize * p_maxsize * 4);
-  std::vector<Tu>  T(subsize * t_maxsize * 3);
-  std::vector<Tu> dR(subsize * p_maxsize);
+  const auto args_knn = args.get_knn();
+  const auto args_cc  = args.get_cc();
 
-  for (int run = 0; run < nruns; run++) {
-
-    std::fill(dknn.begin(), dknn.end(), __INTERNAL__K_UNDEFINED);
-    std::fill(heap_id.begin(), heap_id.end(), 0);
-    std::fill(heap_pq.begin(), heap_pq.end(), 
-              std::numeric_limits<Tf>::infinity());
+  for (size_t run = 0; run < nruns; run++) {
 
     const size_t threadsize  = subsize / nthreads;
 
@@ -427,13 +677,10 @@ __cpu__tesellate(
     const size_t _cend = (run == nruns - 1) ? refsize : _cstart + chunksize;
     subsize = _cend - _cstart;
 
-    for (Ti i = 0; i < subsize; i++) {
+    for (size_t i = 0; i < subsize; i++) {
       indices[i] = _cstart + i;
     }
 
-    const auto args_knn = args.get_knn();
-    const auto args_cc  = args.get_cc();
-
     std::vector<std::thread> threads(nthreads);
     for (size_t i = 0; i < nthreads; i++) {
 
@@ -441,37 +688,213 @@ __cpu__tesellate(
       const size_t _tend = (i != nthreads - 1) ? _tstart + threadsize 
                                                : subsize;
 
-      threads[i] = std::thread([&,_tstart,_tend]() {
+      threads[i] = std::thread([&,i,_tstart,_tend]() {
+
+        // scratch for the single cell the thread works on, so that the
+        // working set stays in cache whatever the chunk size.
+        cci::scratch<Tf, Tu> buf(args_cc);
+        attach<Tf, Tu>(buf, out);
+
+        if (use_knn_stream) {
+          std::vector<Ti> dknn(args_cc.p_maxsize);
+          knni::stream<Ti, Tf> stream(xyzset, id, offset, args_knn);
+          for (size_t idx = _tstart; idx < _tend; idx++) {
+            cci::compute<Ti, Tf, Tu>(
+              0, indices[idx],
+              states,
+              buf,
+              stream, dknn, tmpnn[indices[idx]],
+              xyzset, xyzsize,
+              refset, subsize,
+              args_cc
+            );
+            store<Tf, Tu>(out, indices[idx], buf);
+          }
+          return;
+        }
+
+        auto* snap = snapshots != nullptr ? &(*snapshots)[i] : nullptr;
+
+        std::vector<Ti> heap_id(k);
+        std::vector<Tf> heap_pq(k);
+        std::vector<Ti> dknn(k);
+        std::vector<Ti>& knn = heap_id;
+
+        // the same arguments, with the k of each cell
+        struct args::knn args_knn_ki = args_knn;
+        struct args::cc args_cc_ki = args_cc;
+
         for (size_t idx = _tstart; idx < _tend; idx++) {
+
+          const int ki = use_adaptive_k ? 
+                         knni::budget<Ti>(indices[idx], id, offset, 
+                                          k_min, k_max, args_knn) : k;
+
+          heap_id.assign(ki, 0);
+          heap_pq.assign(ki, std::numeric_limits<Tf>::infinity());
+          dknn.assign(ki, __INTERNAL__K_UNDEFINED);
+          args_knn_ki.k = ki;
+          args_cc_ki.k = ki;
+
           knni::compute<Ti,Tf>(
-            idx, indices[idx], 
+            0, indices[idx], 
             xyzset, xyzsize, id, offset, 
             refset, subsize,
             heap_id, heap_pq,
-            args_knn
+            args_knn_ki
           );
 
           cci::compute<Ti, Tf, Tu>( 
-            idx, indices[idx],
+            0, indices[idx],
             states, 
-            P.data(), T.data(), dR.data(),
+            buf,
             knn, dknn,
             xyzset, xyzsize,
             refset, subsize,
-            args_cc
+            args_cc_ki,
+            snap
           );
+
+          tmpnn_fill(tmpnn[indices[idx]], knn);
+          store<Tf, Tu>(out, indices[idx], buf);
+
         }
       });
 
     }
     for (auto& thread : threads) thread.join();
 
-    tmpnn_fill(tmpnn, indices, subsize, knn, args);
+    // the cells of this chunk that are done can be written out already
+    if (out.writer != nullptr) {
+      tmpmesh_put<Ti, Tf>(out, tmpnn, states, _cstart, _cend);
+    }
 
   }
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/// CPU Overflow                                                            ///
+///////////////////////////////////////////////////////////////////////////////
+
+// The GPU kernels clip in fixed size buffers, so the cells that overflow them
+// are finished here with growable scratch and the same k. Recompute is then
+// only left with the cells that ran out of neighbors. This is also how cells
+// with more planes than an 8 bit Tu can index are promoted to a wider Tu.
+
+template <typename Ti, typename Tf, typename Tu>
+static void
+__cpu__overflow(
+
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const std::vector<Ti>& id,
+  const std::vector<Ti>& offset,
+
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  std::vector<std::vector<Ti>>& tmpnn,
+  struct report<Tf>& out,
+  std::vector<cc::state>& states, 
+
+  const class vtargs& args
+
+) {
+
+  const Ti xyzsize = xyzset.size();
+  const Ti refsize = refset.size();
+
+  const size_t nthreads = args["cpu_nthreads"].get<size_t>() != 0 ?
+                          args["cpu_nthreads"] : 
+                          std::thread::hardware_concurrency(); 
+
+  std::vector<Ti> indices;
+  for (Ti i = 0; i < refsize; i++) {
+    if (states[i].get(cc::error_p_overflow) || 
+        states[i].get(cc::error_t_overflow)) {
+      indices.push_back(i);
+    }
+  }
+
+  const size_t subsize = indices.size();
+  const size_t threadsize = subsize / nthreads;
+
+  const int k = args["k"];
+  const bool use_knn_stream = args["use_knn_stream"];
+  const auto args_knn = args.get_knn();
+  const auto args_cc  = args.get_cc();
+
+  std::vector<std::thread> threads(nthreads);
+  for (size_t i = 0; i < nthreads; i++) {
+
+    const size_t _tstart = i * threadsize;
+    const size_t _tend = (i != nthreads - 1) ? _tstart + threadsize : subsize;
+
+    threads[i] = std::thread([&,_tstart,_tend]() {
+
+      cci::scratch<Tf, Tu> buf(args_cc);
+      attach<Tf, Tu>(buf, out);
+
+      if (use_knn_stream) {
+        std::vector<Ti> dknn(buf.p_maxsize);
+        knni::stream<Ti, Tf> stream(xyzset, id, offset, args_knn);
+        for (size_t idx = _tstart; idx < _tend; idx++) {
+          states[indices[idx]].reset();
+          cci::compute<Ti, Tf, Tu>(
+            0, indices[idx],
+            states,
+            buf,
+            stream, dknn, tmpnn[indices[idx]],
+            xyzset, xyzsize,
+            refset, refsize,
+            args_cc
+          );
+          store<Tf, Tu>(out, indices[idx], buf);
+        }
+        return;
+      }
+
+      std::vector<Ti> heap_id(k);
+      std::vector<Tf> heap_pq(k);
+      std::vector<Ti> dknn(k);
+      std::vector<Ti>& knn = heap_id;
+
+      for (size_t idx = _tstart; idx < _tend; idx++) {
+
+        std::fill(heap_id.begin(), heap_id.end(), 0);
+        std::fill(heap_pq.begin(), heap_pq.end(), 
+                  std::numeric_limits<Tf>::infinity());
+        std::fill(dknn.begin(), dknn.end(), __INTERNAL__K_UNDEFINED);
+
+        states[indices[idx]].reset();
+
+        knni::compute<Ti,Tf>(
+          0, indices[idx], 
+          xyzset, xyzsize, id, offset, 
+          refset, refsize,
+          heap_id, heap_pq,
+          args_knn
+        );
+
+        cci::compute<Ti, Tf, Tu>( 
+          0, indices[idx],
+          states, 
+          buf,
+          knn, dknn,
+          xyzset, xyzsize,
+          refset, refsize,
+          args_cc
+        );
+
+        tmpnn_fill(tmpnn[indices[idx]], knn);
+        store<Tf, Tu>(out, indices[idx], buf);
+
+      }
+    });
+
+  }
+  for (auto& thread : threads) thread.join();
+
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// CPU Recompute                                                           ///
 ///////////////////////////////////////////////////////////////////////////////
@@ -489,12 +912,13 @@ template <typename Ti, typename Tf, typename Tu>
 static void
 __cpu__recompute(
 
-  const std::vector<std::array<Tf,3>>& xyzset,
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
   const std::vector<Ti>& id,
   const std::vector<Ti>& offset,
 
-  const std::vector<std::array<Tf,3>>& refset,
+  const xyzset::span<const std::array<Tf,3>>& refset,
   std::vector<std::vector<Ti>>& tmpnn,
+  struct report<Tf>& out,
   std::vector<cc::state>& states, 
 
   class vtargs args
@@ -525,15 +949,7 @@ __cpu__recompute(
   int k = args["k"];
   int p_maxsize = args["cc_p_maxsize"];
   int t_maxsize = args["cc_t_maxsize"];
-
-  std::vector<Ti> heap_id(subsize * k, 0);
-  std::vector<Tf> heap_pq(subsize * k, std::numeric_limits<Tf>::infinity());
-  std::vector<Ti> dknn(subsize * k, __INTERNAL__K_UNDEFINED);
-  std::vector<Ti>& knn = heap_id;
-
-  std::vector<Tf>       P(subsize * p_maxsize * 4);
-  std::vector<Tu>  T(subsize * t_maxsize * 3);
-  std::vector<Tu> dR(subsize * p_maxsize);
+  const bool use_knn_stream = args["use_knn_stream"];
 
   while (1) {
 
@@ -554,8 +970,13 @@ __cpu__recompute(
       } 
     } 
 
+    // cells flagged for a rerun in higher precision stay flagged
     subsize = cur;
-    for (Ti i = 0; i < refsize; i++) states[i].reset();
+    for (Ti i = 0; i < refsize; i++) {
+      const bool uncertain = states[i].get(cc::uncertain_orientation);
+      states[i].reset();
+      if (uncertain) states[i].set_true(cc::uncertain_orientation);
+    }
 
     if (subsize <= 0) {
       break;
@@ -569,21 +990,6 @@ __cpu__recompute(
     args["cc_p_maxsize"] = p_maxsize;
     args["cc_t_maxsize"] = t_maxsize;
 
-    heap_id.clear();
-    heap_pq.clear();
-    dknn.clear();
-    P.clear();
-    T.clear();
-    dR.clear();
-
-    heap_id.resize(subsize * k, 0);
-    heap_pq.resize(subsize * k, std::numeric_limits<Tf>::infinity());
-    dknn.resize(subsize * k, __INTERNAL__K_UNDEFINED);
-
-    P.resize(subsize * p_maxsize * 4);
-    T.resize(subsize * t_maxsize * 3);
-    dR.resize(subsize * p_maxsize);
-
     const size_t threadsize  = subsize / nthreads;
 
     const auto args_knn = args.get_knn();
@@ -596,9 +1002,42 @@ __cpu__recompute(
       const size_t _tend = (i != nthreads - 1) ? _tstart + threadsize : subsize;
 
       threads[i] = std::thread([&,_tstart,_tend]() {
+
+        cci::scratch<Tf, Tu> buf(args_cc);
+        attach<Tf, Tu>(buf, out);
+
+        if (use_knn_stream) {
+          std::vector<Ti> dknn(p_maxsize);
+          knni::stream<Ti, Tf> stream(xyzset, id, offset, args_knn);
+          for (size_t idx = _tstart; idx < _tend; idx++) {
+            cci::compute<Ti, Tf, Tu>(
+              0, indices[idx],
+              states,
+              buf,
+              stream, dknn, tmpnn[indices[idx]],
+              xyzset, xyzsize,
+              refset, subsize,
+              args_cc
+            );
+            store<Tf, Tu>(out, indices[idx], buf);
+          }
+          return;
+        }
+
+        std::vector<Ti> heap_id(k);
+        std::vector<Tf> heap_pq(k);
+        std::vector<Ti> dknn(k);
+        std::vector<Ti>& knn = heap_id;
+
         for (size_t idx = _tstart; idx < _tend; idx++) {
+
+          std::fill(heap_id.begin(), heap_id.end(), 0);
+          std::fill(heap_pq.begin(), heap_pq.end(), 
+                    std::numeric_limits<Tf>::infinity());
+          std::fill(dknn.begin(), dknn.end(), __INTERNAL__K_UNDEFINED);
+
           knni::compute<Ti,Tf>(
-            idx, indices[idx], 
+            0, indices[idx], 
             xyzset, xyzsize, id, offset, 
             refset, subsize,
             heap_id, heap_pq,
@@ -606,22 +1045,24 @@ __cpu__recompute(
           );
 
           cci::compute<Ti, Tf, Tu>( 
-            idx, indices[idx],
+            0, indices[idx],
             states, 
-            P.data(), T.data(), dR.data(),
+            buf,
             knn, dknn,
             xyzset, xyzsize,
             refset, subsize,
             args_cc
           );
+
+          tmpnn_fill(tmpnn[indices[idx]], knn);
+          store<Tf, Tu>(out, indices[idx], buf);
+
         }
       });
 
     }
     for (auto& thread : threads) thread.join();
 
-    tmpnn_fill(tmpnn, indices, subsize, knn, args);
-
     if (k >= (refsize - 1)) {
       break;
     }
@@ -630,6 +1071,319 @@ __cpu__recompute(
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/// CPU Radius Recompute                                                    ///
+///////////////////////////////////////////////////////////////////////////////
+
+// Instead of doubling k for every failed cell, cells that ran out of
+// neighbors without an error are resumed from their snapshot. Their current
+// vertices give the exact security radius, so a single range query returns
+// every remaining candidate. Cells that failed with an error, or that were
+// computed on the GPU, are restarted through the neighbor stream.
+
+template <typename Ti, typename Tf, typename Tu>
+static void
+__cpu__recompute_radius(
+
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const std::vector<Ti>& id,
+  const std::vector<Ti>& offset,
+
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  std::vector<std::vector<Ti>>& tmpnn,
+  struct report<Tf>& out,
+  std::vector<cc::state>& states, 
+
+  const std::vector<cci::snapshot<Ti, Tf, Tu>>& snapshots,
+
+  const class vtargs& args
+
+) {
+
+  const Ti xyzsize = xyzset.size();
+  const Ti refsize = refset.size();
+
+  const size_t nthreads = args["cpu_nthreads"].get<size_t>() != 0 ?
+                          args["cpu_nthreads"] : 
+                          std::thread::hardware_concurrency(); 
+
+  const auto args_knn = args.get_knn();
+  const auto args_cc  = args.get_cc();
+
+  /* ---------------------------------------------------------------------- */
+  /// Resume cells from their snapshot
+  /* ---------------------------------------------------------------------- */
+
+  std::vector<std::pair<size_t, size_t>> entries;
+  for (size_t s = 0; s < snapshots.size(); s++) {
+    for (size_t j = 0; j < snapshots[s].size(); j++) {
+      entries.emplace_back(s, j);
+    }
+  }
+
+  {
+
+    const size_t threadsize = entries.size() / nthreads;
+
+    std::vector<std::thread> threads(nthreads);
+    for (size_t i = 0; i < nthreads; i++) {
+
+      const size_t _tstart = i * threadsize;
+      const size_t _tend = (i != nthreads - 1) ? _tstart + threadsize 
+                                               : entries.size();
+
+      threads[i] = std::thread([&,_tstart,_tend]() {
+
+        std::vector<Ti> heap_id;
+        std::vector<Tf> heap_pq;
+        std::vector<Ti> owners;
+
+        cci::scratch<Tf, Tu> buf(args_cc);
+        attach<Tf, Tu>(buf, out);
+        std::vector<Ti> owner;
+
+        for (size_t e = _tstart; e < _tend; e++) {
+
+          const auto& snap = snapshots[entries[e].first];
+          const size_t j = entries[e].second;
+          const Ti index = snap.index[j];
+
+          const size_t p0 = snap.poffs[j];
+          const size_t t0 = snap.toffs[j];
+          const auto p_size = 
+            static_cast<unsigned short int>(snap.poffs[j + 1] - p0);
+          const auto t_size = 
+            static_cast<unsigned short int>(snap.toffs[j + 1] - t0);
+
+          const Tf sradius = cci::radius<Tf, Tu>(
+            snap.P.data() + 4 * p0, snap.T.data() + 3 * t0, t_size,
+            refset[index], args_cc
+          );
+
+          const size_t csize = knni::range<Ti, Tf>(
+            index, refset[index], xyzset, offset,
+            snap.pq[j], 4 * sradius * sr::margin<Tf>(args_cc.perturb),
+            heap_id, heap_pq, 0,
+            args_knn
+          );
+
+          // neighbors that already own a plane are not clipped again.
+          owners.assign(snap.owner.begin() + p0, 
+                        snap.owner.begin() + p0 + p_size);
+          std::sort(owners.begin(), owners.end());
+
+          size_t cur = 0;
+          for (size_t c = 0; c < csize; c++) {
+            if (std::binary_search(owners.begin(), owners.end(), 
+                                   heap_id[c])) {
+              continue;
+            }
+            heap_id[cur] = heap_id[c];
+            heap_pq[cur] = heap_pq[c];
+            cur++;
+          }
+
+          heap::sort<Ti, Tf>(heap_id, heap_pq, 0, cur);
+
+          buf.reserve(p_size, t_size);
+
+          std::copy(snap.P.begin() + 4 * p0, 
+                    snap.P.begin() + 4 * (p0 + p_size), buf.P.begin());
+          std::copy(snap.T.begin() + 3 * t0, 
+                    snap.T.begin() + 3 * (t0 + t_size), buf.T.begin());
+          owner.assign(snap.owner.begin() + p0, 
+                       snap.owner.begin() + p0 + p_size);
+
+          states[index].reset();
+          (void)cci::resume<Ti, Tf, Tu>(
+            index, states,
+            buf, owner,
+            p_size, t_size,
+            heap_id, cur,
+            tmpnn[index],
+            xyzset, refset,
+            args_cc
+          );
+          store<Tf, Tu>(out, index, buf);
+
+        }
+
+      });
+
+    }
+    for (auto& thread : threads) thread.join();
+
+  }
+
+  /* ---------------------------------------------------------------------- */
+  /// Restart the remaining cells
+  /* ---------------------------------------------------------------------- */
+
+  std::vector<Ti> indices;
+  for (Ti i = 0; i < refsize; i++) {
+    if (!states[i].get(cc::security_radius_reached)) {
+      indices.push_back(i);
+    }
+  }
+
+  const size_t subsize = indices.size();
+  const size_t threadsize = subsize / nthreads;
+
+  std::vector<std::thread> threads(nthreads);
+  for (size_t i = 0; i < nthreads; i++) {
+
+    const size_t _tstart = i * threadsize;
+    const size_t _tend = (i != nthreads - 1) ? _tstart + threadsize : subsize;
+
+    threads[i] = std::thread([&,_tstart,_tend]() {
+
+      knni::stream<Ti, Tf> stream(xyzset, id, offset, args_knn);
+
+      cci::scratch<Tf, Tu> buf(args_cc);
+      attach<Tf, Tu>(buf, out);
+      cci::scratch<Tf, uint16_t> wide(args_cc);
+      attach<Tf, uint16_t>(wide, out);
+      std::vector<Ti> dknn(args_cc.p_maxsize);
+
+      for (size_t idx = _tstart; idx < _tend; idx++) {
+
+        const Ti index = indices[idx];
+
+        states[index].reset();
+        cci::compute<Ti, Tf, Tu>(
+          0, index,
+          states,
+          buf,
+          stream, dknn, tmpnn[index],
+          xyzset, xyzsize,
+          refset, refsize,
+          args_cc
+        );
+        store<Tf, Tu>(out, index, buf);
+
+        if (!states[index].get(cc::error_p_overflow)) {
+          continue;
+        }
+
+        // more planes than Tu can index
+        states[index].reset();
+        cci::compute<Ti, Tf, uint16_t>(
+          0, index,
+          states,
+          wide,
+          stream, dknn, tmpnn[index],
+          xyzset, xyzsize,
+          refset, refsize,
+          args_cc
+        );
+        store<Tf, uint16_t>(out, index, wide);
+
+      }
+
+    });
+
+  }
+  for (auto& thread : threads) thread.join();
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// CPU Precision                                                           ///
+///////////////////////////////////////////////////////////////////////////////
+
+// Cells flagged with cc::uncertain_orientation, and those that broke on a
+// degenerate configuration, are rerun here in double, in one batch once
+// every other pass is done. They pull their neighbors from a stream, so that
+// they do not depend on the k they were first run with. The points are
+// widened as they are, so the grid they were sorted into still holds.
+
+template <typename Ti, typename Tf, typename Tu>
+static void
+__cpu__precision(
+
+  const xyzset::span<const std::array<Tf,3>>& xyzset,
+  const std::vector<Ti>& id,
+  const std::vector<Ti>& offset,
+
+  const xyzset::span<const std::array<Tf,3>>& refset,
+  std::vector<std::vector<Ti>>& tmpnn,
+  struct report<Tf>& out,
+  std::vector<cc::state>& states, 
+
+  const class vtargs& args
+
+) {
+
+  const Ti xyzsize = xyzset.size();
+  const Ti refsize = refset.size();
+
+  const size_t nthreads = args["cpu_nthreads"].get<size_t>() != 0 ?
+                          args["cpu_nthreads"] : 
+                          std::thread::hardware_concurrency(); 
+
+  std::vector<Ti> indices;
+  for (Ti i = 0; i < refsize; i++) {
+    if (states[i].get(cc::uncertain_orientation) || 
+        states[i].get(cc::error_infinite_boundary) ||
+        states[i].get(cc::error_nonvalid_vertices)) {
+      indices.push_back(i);
+    }
+  }
+
+  if (indices.empty()) return;
+
+  const auto widen = [](const xyzset::span<const std::array<Tf,3>>& set) {
+    std::vector<std::array<double,3>> wide(set.size());
+    for (size_t i = 0; i < set.size(); i++) {
+      wide[i] = {set[i][0], set[i][1], set[i][2]};
+    }
+    return wide;
+  };
+  const auto xyzset_d = widen(xyzset);
+  const auto refset_d = widen(refset);
+
+  const size_t subsize = indices.size();
+  const size_t threadsize = subsize / nthreads;
+
+  const auto args_knn = args.get_knn();
+  auto args_cc = args.get_cc();
+  args_cc.flag_uncertain = false;
+
+  std::vector<std::thread> threads(nthreads);
+  for (size_t i = 0; i < nthreads; i++) {
+
+    const size_t _tstart = i * threadsize;
+    const size_t _tend = (i != nthreads - 1) ? _tstart + threadsize : subsize;
+
+    threads[i] = std::thread([&,_tstart,_tend]() {
+
+      cci::scratch<double, Tu> buf(args_cc);
+      attach<Tf, Tu>(buf, out);
+
+      std::vector<Ti> dknn(buf.p_maxsize);
+      knni::stream<Ti, double> stream(xyzset_d, id, offset, args_knn);
+
+      for (size_t idx = _tstart; idx < _tend; idx++) {
+        states[indices[idx]].reset();
+        cci::compute<Ti, double, Tu>(
+          0, indices[idx],
+          states,
+          buf,
+          stream, dknn, tmpnn[indices[idx]],
+          xyzset_d, xyzsize,
+          refset_d, refsize,
+          args_cc
+        );
+        store<Tf, Tu>(out, indices[idx], buf);
+      }
+
+    });
+
+  }
+  for (auto& thread : threads) thread.join();
+
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Tesellate internal functions                                            ///
 ///////////////////////////////////////////////////////////////////////////////
@@ -644,9 +1398,10 @@ static bool device_found(void) {
 ///////////////////////////////////////////////////////////////////////////////
 
 template <typename Ti, typename Tf>
-class dnn<Ti>
-tesellate(
-  std::vector<std::array<Tf,3>>& xyzset,
+static class dnn<Ti>
+__tesellate(
+  xyzset::span<std::array<Tf,3>> _xyzset,
+  struct report<Tf>& out,
   class vtargs args,
   const enum device device
 ) {
@@ -665,10 +1420,15 @@ tesellate(
   "Template type Tf must be a floating-point type."
   );
 
-  const auto [id,offset] = xyzset::sort<Ti,Tf>(xyzset, args.get_xyzset());
+  // cells clipped in double already have nothing wider to be rerun in
+  if constexpr (sizeof(Tf) >= sizeof(double)) {
+    args["use_precision_retry"] = false;
+  }
+
+  auto [id,offset] = xyzset::sort<Ti,Tf>(_xyzset, args.get_xyzset());
 
   // TODO : Make errors actually good
-  if (!xyzset::validate_xyzset<Tf>(xyzset)) {
+  if (!xyzset::validate_xyzset<Tf>(_xyzset, args.get_box())) {
     std::cerr<<"oops1"<<std::endl;
   }
   if (!xyzset::validate_id<Ti>(id)) {
@@ -678,49 +1438,130 @@ tesellate(
     std::cerr<<"oops3"<<std::endl;
   }
 
+  // coincident points have no bisector between them. Merged points are
+  // moved to the end of the set, and only the others are tesellated.
+  size_t nunique = _xyzset.size();
+  const bool use_duplicate_merge = args["use_duplicate_merge"].get<bool>();
+  const bool use_duplicate_check = args["use_duplicate_check"].get<bool>() ||
+                                   use_duplicate_merge;
+  std::vector<Ti> alias;
+  if (use_duplicate_check) {
+    const size_t nthreads = args["cpu_nthreads"].get<size_t>() != 0 ?
+                            args["cpu_nthreads"] : 
+                            std::thread::hardware_concurrency(); 
+    const Tf tolerance = args["duplicate_tolerance"].get<double>();
+    alias = xyzset::duplicates<Ti,Tf>(_xyzset, offset, args.get_knn(), 
+                                      tolerance, nthreads);
+    size_t nduplicates = 0;
+    for (size_t i = 0; i < alias.size(); i++) {
+      if (alias[i] != static_cast<Ti>(i)) nduplicates++;
+    }
+    std::cout << "duplicates = " << nduplicates << std::endl;
+    if (use_duplicate_merge && nduplicates != 0) {
+      nunique = xyzset::merge<Ti,Tf>(_xyzset, id, offset, alias);
+      id.resize(nunique);
+    }
+  }
+
+  const xyzset::span<const std::array<Tf,3>> xyzset(_xyzset.data(), nunique);
   const auto& refset = xyzset;
   const size_t refsize = refset.size();
 
   std::vector<std::vector<Ti>>  tmpnn(refsize);
   std::vector<struct cc::state> states(refsize);
 
+  // cells are streamed to the mesh file as they are finished
+  std::unique_ptr<mesh::writer<Tf>> writer;
+  const std::string mesh_outfile = args["mesh_outfile"];
+  if (!mesh_outfile.empty()) {
+    writer = std::make_unique<mesh::writer<Tf>>(mesh_outfile);
+  }
+  out.writer = writer.get();
+  const bool use_polyhedra = out.use_topology || writer != nullptr;
+
+  // cells finished by the GPU kernels have no geometry to report
+  const Tf nan = std::numeric_limits<Tf>::quiet_NaN();
+  const size_t gsize = out.use_geometry || writer != nullptr ? refsize : 0;
+  out.cells.radius.assign(refsize, nan);
+  out.cells.volume.assign(gsize, nan);
+  out.cells.centroid.assign(gsize, {nan, nan, nan});
+  out.cells.area.assign(gsize, nan);
+  out.tmpfaces.assign(out.use_faces ? refsize : 0, {});
+  out.tmpvertices.assign(use_polyhedra ? refsize : 0, {});
+  out.tmploops.assign(use_polyhedra ? refsize : 0, {});
+  out.tmpwritten.assign(writer != nullptr ? refsize : 0, false);
+
+  const bool use_radius_recompute = args["use_recompute"].get<bool>() &&
+                                    args["use_radius_recompute"].get<bool>();
+
+  std::vector<cci::snapshot<Ti, Tf, uint8_t>> snapshots;
+  auto* snap = use_radius_recompute ? &snapshots : nullptr;
+
   for (size_t i = 0; i < states.size(); i++) states[i].reset();
 
   switch (device) {
 
     case (device::gpu): 
       
-      if (device_found()) {
+      // the GPU kernels do not build the polyhedra the mesh file is made of
+      if (device_found() && writer == nullptr) {
 
         __gpu__tesellate<Ti, Tf, uint8_t>(xyzset, id, offset, refset, 
-                                          tmpnn, states, args);
+                                          tmpnn, out, states, args);
+
+        __cpu__overflow<Ti, Tf, uint8_t>(xyzset, id, offset, refset, 
+                                         tmpnn, out, states, args);
 
         break;
 
       } 
 
-      std::cerr << "\033[1m\033[93mWarning: "
-                << "No GPU device found. Running CPU as fallback"
-                << "\033[0m\n";
+      if (writer != nullptr) {
+        std::cerr << "\033[1m\033[93mWarning: "
+                  << "mesh_outfile is not supported on the GPU. "
+                  << "Running CPU instead"
+                  << "\033[0m\n";
+      } else {
+        std::cerr << "\033[1m\033[93mWarning: "
+                  << "No GPU device found. Running CPU as fallback"
+                  << "\033[0m\n";
+      }
       
       __cpu__tesellate<Ti, Tf, uint8_t>(xyzset, id, offset, refset, 
-                                        tmpnn, states, args);
+                                        tmpnn, out, states, args, snap);
 
       break;
 
     case (device::cpu): 
 
       __cpu__tesellate<Ti, Tf, uint8_t>(xyzset, id, offset, refset, 
-                                        tmpnn, states, args);
+                                        tmpnn, out, states, args, snap);
 
       break;
 
   }
   
-  if (args["use_recompute"].get<bool>()) {
+  // cells with more planes than uint8_t can index are rerun with uint16_t
+  __cpu__overflow<Ti, Tf, uint16_t>(xyzset, id, offset, refset, 
+                                    tmpnn, out, states, args);
+
+  if (use_radius_recompute) {
+
+    __cpu__recompute_radius<Ti, Tf, uint8_t>(xyzset, id, offset, refset, 
+                                             tmpnn, out, states, 
+                                             snapshots, args);
+
+  } else if (args["use_recompute"].get<bool>()) {
 
     __cpu__recompute<Ti, Tf, uint8_t>(xyzset, id, offset, refset, 
-                                      tmpnn, states, args);
+                                      tmpnn, out, states, args);
+
+  }
+
+  if (args["use_precision_retry"].get<bool>()) {
+
+    __cpu__precision<Ti, Tf, uint16_t>(xyzset, id, offset, refset, 
+                                       tmpnn, out, states, args);
 
   }
 
@@ -751,8 +1592,153 @@ tesellate(
   std::cout << "       " << "nerrors : " << n_error << "\n";
   std::cout << std::endl;
 
-  return tmpnn_getdnn(tmpnn);
+  if (writer != nullptr) {
+    tmpmesh_put<Ti, Tf>(out, tmpnn, states, 0, refsize);
+    writer->close();
+    out.writer = nullptr;
+  }
+
+  // merged points come back with no neighbors and no cell
+  if (nunique != _xyzset.size()) {
+    const size_t size = _xyzset.size();
+    tmpnn.resize(size);
+    out.cells.radius.resize(size, nan);
+    out.cells.volume.resize(gsize != 0 ? size : 0, nan);
+    out.cells.centroid.resize(gsize != 0 ? size : 0, {nan, nan, nan});
+    out.cells.area.resize(gsize != 0 ? size : 0, nan);
+    out.tmpfaces.resize(out.use_faces ? size : 0);
+    out.tmpvertices.resize(use_polyhedra ? size : 0);
+    out.tmploops.resize(use_polyhedra ? size : 0);
+  }
+
+  if (out.use_faces) {
+    tmpfaces_get<Ti, Tf>(tmpnn, out.tmpfaces, out.faces);
+  }
+
+  auto dnn = tmpnn_getdnn(tmpnn);
+  dnn.alias = std::move(alias);
+  return dnn;
+
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+class dnn<Ti>
+tesellate(
+  std::vector<std::array<Tf,3>>& xyzset,
+  class vtargs args,
+  const enum device device
+) {
+  struct report<Tf> out = {false, false, false, {}, {}, {}, {}, {}, 
+                           nullptr, {}};
+  return __tesellate<Ti, Tf>(xyzset, out, args, device);
+}
+
+/* ------------------------------------------------------------------------- */
 
+template <typename Ti, typename Tf>
+class dnn<Ti>
+tesellate(
+  std::array<Tf,3>* xyzset,
+  const size_t size,
+  class vtargs args,
+  const enum device device
+) {
+  struct report<Tf> out = {false, false, false, {}, {}, {}, {}, {}, 
+                           nullptr, {}};
+  return __tesellate<Ti, Tf>({xyzset, size}, out, args, device);
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+class dnn<Ti>
+tesellate(
+  std::vector<std::array<Tf,3>>& xyzset,
+  std::vector<Tf>& radius,
+  class vtargs args,
+  const enum device device
+) {
+  struct report<Tf> out = {false, false, false, {}, {}, {}, {}, {}, 
+                           nullptr, {}};
+  auto dnn = __tesellate<Ti, Tf>(xyzset, out, args, device);
+  radius = std::move(out.cells.radius);
+  return dnn;
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+class dnn<Ti>
+tesellate(
+  std::vector<std::array<Tf,3>>& xyzset,
+  struct cells<Tf>& cells,
+  class vtargs args,
+  const enum device device
+) {
+  struct report<Tf> out = {true, false, false, {}, {}, {}, {}, {}, 
+                           nullptr, {}};
+  auto dnn = __tesellate<Ti, Tf>(xyzset, out, args, device);
+  cells = std::move(out.cells);
+  return dnn;
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+class dnn<Ti>
+tesellate(
+  std::vector<std::array<Tf,3>>& xyzset,
+  struct faces<Tf>& faces,
+  class vtargs args,
+  const enum device device
+) {
+  struct report<Tf> out = {false, true, false, {}, {}, {}, {}, {}, 
+                           nullptr, {}};
+  auto dnn = __tesellate<Ti, Tf>(xyzset, out, args, device);
+  faces = std::move(out.faces);
+  return dnn;
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+class dnn<Ti>
+tesellate(
+  std::vector<std::array<Tf,3>>& xyzset,
+  struct cells<Tf>& cells,
+  struct faces<Tf>& faces,
+  class vtargs args,
+  const enum device device
+) {
+  struct report<Tf> out = {true, true, false, {}, {}, {}, {}, {}, 
+                           nullptr, {}};
+  auto dnn = __tesellate<Ti, Tf>(xyzset, out, args, device);
+  cells = std::move(out.cells);
+  faces = std::move(out.faces);
+  return dnn;
+}
+
+/* ------------------------------------------------------------------------- */
+
+template <typename Ti, typename Tf>
+class dnn<Ti>
+tesellate(
+  std::vector<std::array<Tf,3>>& xyzset,
+  struct polyhedra<Ti, Tf>& polyhedra,
+  class vtargs args,
+  const enum device device
+) {
+  struct report<Tf> out = {false, false, true, {}, {}, {}, {}, {}, 
+                           nullptr, {}};
+  auto dnn = __tesellate<Ti, Tf>(xyzset, out, args, device);
+  const size_t nthreads = args["cpu_nthreads"].get<size_t>() != 0 ?
+                          args["cpu_nthreads"] : 
+                          std::thread::hardware_concurrency(); 
+  tmppolyhedra_get<Ti, Tf>(out.tmpvertices, out.tmploops, dnn, polyhedra, 
+                           nthreads);
+  return dnn;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
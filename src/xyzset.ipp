@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <thread>
+#include <cmath>
 #include <libsycl.hpp>
 
 #include <utils.hpp>
@@ -13,22 +15,35 @@ inline T2 get_distance(
   return square(p0 - q0) + square(p1 - q1) + square(p2 - q2);
 }
 
+template <typename T2>
+inline T2 get_image(const T2 a, const T2 b, const T2 l) {
+  const T2 d = b - a;
+  return a + l * static_cast<T2>(d > l / 2) - l * static_cast<T2>(d < -l / 2);
+}
+
+// Grid cell of coordinate x along axis c of the box, points on the upper face
+// of the box included.
+template <typename T1, typename T2>
+inline T1 get_cell(const T2 x, const args::box& box, const int c) {
+  const T1 g = static_cast<T1>(std::floor((x - box.lo[c]) / box.cell(c)));
+  return std::max<T1>(0, std::min<T1>(g, box.gr[c] - 1));
+}
+
 template <typename T1, typename T2>
 const std::pair<std::vector<T1>, std::vector<T1>>
-sort(std::vector<std::array<T2,3>>& xyzset, const args::xyzset& args) {
+sort(span<std::array<T2,3>> xyzset, const args::xyzset& args) {
 
-  const auto gr = args.grid_resolution;
-  const T2 gl = 1.0f / gr; // TODO: make this template safe
-  const T1 idmax = gr * gr * gr;
+  const auto& box = args.box;
+  const T1 idmax = box.size();
 
   std::vector<T1> id(xyzset.size());
   std::vector<T1> offset(0,0);
-  
+
   // init
   for (size_t i = 0; i < xyzset.size(); i++) {
-    id[i] = static_cast<T1>(std::floor(xyzset[i][0] / gl))
-          + static_cast<T1>(std::floor(xyzset[i][1] / gl)) * gr  
-          + static_cast<T1>(std::floor(xyzset[i][2] / gl)) * gr * gr; 
+    id[i] = get_cell<T1, T2>(xyzset[i][0], box, 0)
+          + get_cell<T1, T2>(xyzset[i][1], box, 1) * box.gr[0]
+          + get_cell<T1, T2>(xyzset[i][2], box, 2) * box.gr[0] * box.gr[1];
   };
   
   // sort
@@ -44,7 +59,7 @@ sort(std::vector<std::array<T2,3>>& xyzset, const args::xyzset& args) {
     for (int i = 1; i < 256; i++) {
       count[i] += count[i - 1];
     }
-    for (int i = size - 1; i >= 0; i--) {
+    for (size_t i = size; i-- > 0; ) {
       const size_t idx = (id[i] >> shift) & 0xFF;
       const size_t sortedIdx = --count[idx];
       tmp_id[sortedIdx] = id[i];
@@ -69,12 +84,148 @@ sort(std::vector<std::array<T2,3>>& xyzset, const args::xyzset& args) {
   return std::make_pair(id, offset);
 }
 
+template <typename T1, typename T2>
+std::vector<T1> duplicates(
+  const span<const std::array<T2,3>>& xyzset,
+  const std::vector<T1>& offset,
+  const args::knn& args,
+  const T2 tolerance,
+  const size_t nthreads
+) {
+
+  const auto& box = args.box;
+  const size_t size = xyzset.size();
+  const T2 tolerance2 = tolerance * tolerance;
+
+  std::vector<T1> alias(size);
+
+  const size_t threadsize = size / nthreads;
+
+  std::vector<std::thread> threads(nthreads);
+  for (size_t n = 0; n < nthreads; n++) {
+
+    const size_t _tstart = n * threadsize;
+    const size_t _tend = (n != nthreads - 1) ? _tstart + threadsize : size;
+
+    threads[n] = std::thread([&,_tstart,_tend]() {
+      for (size_t i = _tstart; i < _tend; i++) {
+
+        const auto& p = xyzset[i];
+        alias[i] = static_cast<T1>(i);
+
+        // cells within the tolerance of p, wrapped around with periodicity
+        int lo[3], hi[3];
+        for (int c = 0; c < 3; c++) {
+          const T2 l = (p[c] - tolerance - box.lo[c]) / box.cell(c);
+          const T2 h = (p[c] + tolerance - box.lo[c]) / box.cell(c);
+          const int g = get_cell<int, T2>(p[c], box, c);
+          lo[c] = std::min(static_cast<int>(std::floor(l)), g);
+          hi[c] = std::max(static_cast<int>(std::floor(h)), g);
+          if (args.periodic) {
+            hi[c] = std::min(hi[c], lo[c] + box.gr[c] - 1);
+          } else {
+            lo[c] = std::max(lo[c], 0);
+            hi[c] = std::min(hi[c], box.gr[c] - 1);
+          }
+        }
+
+        for (int z = lo[2]; z <= hi[2]; z++) {
+          for (int y = lo[1]; y <= hi[1]; y++) {
+            for (int x = lo[0]; x <= hi[0]; x++) {
+
+              const int cx = (x % box.gr[0] + box.gr[0]) % box.gr[0];
+              const int cy = (y % box.gr[1] + box.gr[1]) % box.gr[1];
+              const int cz = (z % box.gr[2] + box.gr[2]) % box.gr[2];
+              const T1 cell = cx + cy * box.gr[0] + cz * box.gr[0] * box.gr[1];
+
+              // points of a cell are in index order
+              for (T1 j = offset[cell]; j < offset[cell + 1]; j++) {
+                if (j >= alias[i]) break;
+                T2 q[3] = {xyzset[j][0], xyzset[j][1], xyzset[j][2]};
+                if (args.periodic) {
+                  for (int c = 0; c < 3; c++) {
+                    q[c] = get_image<T2>(q[c], p[c], box.length(c));
+                  }
+                }
+                if (get_distance<T2>(p[0], p[1], p[2], q[0], q[1], q[2]) <=
+                    tolerance2) {
+                  alias[i] = j;
+                }
+              }
+
+            }
+          }
+        }
+
+      }
+    });
+
+  }
+  for (auto& thread : threads) thread.join();
+
+  // each point only looked below itself, so its group is known by now
+  for (size_t i = 0; i < size; i++) {
+    alias[i] = alias[alias[i]];
+  }
+
+  return alias;
+
+}
+
+template <typename T1, typename T2>
+size_t merge(
+  span<std::array<T2,3>> xyzset,
+  std::vector<T1>& id,
+  std::vector<T1>& offset,
+  std::vector<T1>& alias
+) {
+
+  const size_t size = xyzset.size();
+
+  // kept points first, then the others, both in their current order
+  std::vector<T1> position(size);
+  size_t nunique = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (alias[i] == static_cast<T1>(i)) position[i] = nunique++;
+  }
+  size_t next = nunique;
+  for (size_t i = 0; i < size; i++) {
+    if (alias[i] != static_cast<T1>(i)) position[i] = next++;
+  }
+
+  std::vector<std::array<T2,3>> tmp_xyzset(size);
+  std::vector<T1> tmp_id(size);
+  std::vector<T1> tmp_alias(size);
+  for (size_t i = 0; i < size; i++) {
+    tmp_xyzset[position[i]] = xyzset[i];
+    tmp_id[position[i]] = id[i];
+    tmp_alias[position[i]] = position[alias[i]];
+  }
+  std::copy(tmp_xyzset.begin(), tmp_xyzset.end(), xyzset.begin());
+  id = std::move(tmp_id);
+  alias = std::move(tmp_alias);
+
+  std::fill(offset.begin(), offset.end(), 0);
+  for (size_t i = 0; i < nunique; i++) {
+    offset[id[i] + 1]++;
+  }
+  for (size_t i = 1; i < offset.size(); i++) {
+    offset[i] += offset[i - 1];
+  }
+
+  return nunique;
+
+}
+
 template <typename T2>
 bool
-validate_xyzset(const std::vector<std::array<T2,3>>& xyzset) {
+validate_xyzset(
+  const span<const std::array<T2,3>>& xyzset, 
+  const args::box& box
+) {
   for (size_t i = 0; i < xyzset.size(); i++) {
     for (size_t j = 0; j < xyzset[0].size(); j++) {
-      if (xyzset[i][j] >= 1.0f || xyzset[i][j] <= 0.0f) {
+      if (xyzset[i][j] >= box.hi[j] || xyzset[i][j] <= box.lo[j]) {
         return false;
       }
     }
@@ -106,11 +257,11 @@ bool validate_sort(
   const std::vector<T1>& id,
   const T1 gr
 ) {
-  T2 gl = 1.0f / gr;
+  const args::box box(gr);
   for (size_t i = 0; i < xyzset.size(); ++i) {
-    T1 cid = static_cast<T1>(std::floor(xyzset[i][0] / gl)) +
-             static_cast<T1>(std::floor(xyzset[i][1] / gl) * gr) +
-             static_cast<T1>(std::floor(xyzset[i][2] / gl) * gr * gr);
+    T1 cid = get_cell<T1, T2>(xyzset[i][0], box, 0) +
+             get_cell<T1, T2>(xyzset[i][1], box, 1) * gr +
+             get_cell<T1, T2>(xyzset[i][2], box, 2) * gr * gr;
     if (cid != id[i]) {
       return false;
     }
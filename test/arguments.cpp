@@ -1,6 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 #include "arguments.hpp"
 
+#include <type_traits>
+
 TEST_CASE("vtargref assignment and conversion", "[vtargs]") {
   votess::vtargref obj;
 
@@ -119,10 +121,22 @@ TEST_CASE("vtargs initialization and assignment", "[vtargs]") {
 
   SECTION("Default values initialization") {
     REQUIRE(args["k"].get<int>() == ARGS_DEFAULT_K);
+    REQUIRE(args["k_min"].get<int>() == ARGS_DEFAULT_K_MIN);
+    REQUIRE(args["k_max"].get<int>() == ARGS_DEFAULT_K_MAX);
     REQUIRE(args["cpu_nthreads"].get<int>() == ARGS_DEFAULT_CPU_NTHREADS);
     REQUIRE(args["gpu_ndsize"].get<int>() == ARGS_DEFAULT_GPU_NDWORKSIZE);
     REQUIRE(args["chunksize"].get<int>() == ARGS_DEFAULT_CHUNKSIZE);
     REQUIRE(args["use_recompute"].get<bool>() == ARGS_DEFAULT_USE_RECOMPUTE);
+    REQUIRE(args["use_adaptive_k"].get<bool>() == ARGS_DEFAULT_USE_ADAPTIVE_K);
+    REQUIRE(args["use_radius_recompute"].get<bool>() == 
+            ARGS_DEFAULT_USE_RADIUS_RECOMPUTE);
+    REQUIRE(args["use_knn_stream"].get<bool>() == ARGS_DEFAULT_USE_KNN_STREAM);
+    REQUIRE(args["use_duplicate_check"].get<bool>() == 
+            ARGS_DEFAULT_USE_DUPLICATE_CHECK);
+    REQUIRE(args["use_duplicate_merge"].get<bool>() == 
+            ARGS_DEFAULT_USE_DUPLICATE_MERGE);
+    REQUIRE(args["duplicate_tolerance"].get<double>() == 
+            ARGS_DEFAULT_DUPLICATE_TOLERANCE);
     REQUIRE(args["knn_grid_resolution"].get<int>() == ARGS_DEFAULT_GRID_RESOLUTION);
     REQUIRE(args["cc_p_maxsize"].get<int>() == ARGS_DEFAULT_P_MAXSIZE);
     REQUIRE(args["cc_t_maxsize"].get<int>() == ARGS_DEFAULT_T_MAXSIZE);
@@ -177,6 +191,10 @@ TEST_CASE("vtargs get_knn", "[vtargs]") {
   knn = args.get_knn();
   REQUIRE(knn.k == 21);
   REQUIRE(knn.grid_resolution == 128);
+  REQUIRE(knn.max_radius == 0.00);
+
+  args["max_radius"] = 0.125;
+  REQUIRE(args.get_knn().max_radius == 0.125);
 }
 
 TEST_CASE("vtargs get_cc", "[vtargs]") {
@@ -198,4 +216,114 @@ TEST_CASE("vtargs get_cc", "[vtargs]") {
   REQUIRE(cc.k == 84);
   REQUIRE(cc.p_maxsize == 256);
   REQUIRE(cc.t_maxsize == 512);
+  REQUIRE(cc.max_radius == 0.00);
+
+  args["max_radius"] = 0.125;
+  REQUIRE(args.get_cc().max_radius == 0.125);
+
+  REQUIRE(!cc.flag_uncertain);
+  args["use_precision_retry"] = true;
+  REQUIRE(args.get_cc().flag_uncertain);
+
+  REQUIRE(!cc.recenter);
+  args["use_recentering"] = true;
+  REQUIRE(args.get_cc().recenter);
+
+  REQUIRE(!cc.perturb);
+  args["use_perturbation"] = true;
+  REQUIRE(args.get_cc().perturb);
+}
+
+TEST_CASE("vtargs get_box", "[vtargs]") {
+  votess::vtargs args;
+  args["knn_grid_resolution"] = 24;
+
+  auto box = args.get_box();
+  for (int c = 0; c < 3; c++) {
+    REQUIRE(box.lo[c] == 0.0);
+    REQUIRE(box.hi[c] == 1.0);
+    REQUIRE(box.gr[c] == 24);
+  }
+
+  // a slab gets fewer grid cells along its short sides, at least one
+  args["box_xmin"] = 1234.56789012;
+  args["box_xmax"] = 1246.56789012;
+  args["box_ymin"] = -3.0;
+  args["box_ymax"] = 3.0;
+  args["box_zmin"] = 0.0;
+  args["box_zmax"] = 0.1;
+  box = args.get_box();
+  REQUIRE(box.lo[0] == 1234.56789012);
+  REQUIRE(box.hi[0] == 1246.56789012);
+  REQUIRE(box.gr[0] == 24);
+  REQUIRE(box.gr[1] == 12);
+  REQUIRE(box.gr[2] == 1);
+  REQUIRE(box.size() == 24 * 12);
+
+  REQUIRE(args.get_knn().box.gr[1] == 12);
+  REQUIRE(args.get_cc().box.hi[2] == 0.1);
+}
+
+TEST_CASE("vtargs walls", "[vtargs]") {
+  votess::vtargs args;
+  REQUIRE(args.get_cc().nwalls == 0);
+
+  const votess::planes_t walls = {{1, 0, 0, -0.25}, {0, -1, 0, 0.1234567891}};
+  args["walls"] = walls;
+  REQUIRE(args["walls"].get<votess::planes_t>() == walls);
+
+  auto cc = args.get_cc();
+  REQUIRE(cc.nwalls == 2);
+  REQUIRE(cc.walls[0] == 1.0);
+  REQUIRE(cc.walls[3] == -0.25);
+  REQUIRE(cc.walls[7] == 0.1234567891);
+
+  // as a string, with commas or spaces
+  args["walls"] = "0,0,1,-0.5\n0 0 -1 0.75";
+  cc = args.get_cc();
+  REQUIRE(cc.nwalls == 2);
+  REQUIRE(cc.walls[6] == -1.0);
+  REQUIRE(cc.walls[7] == 0.75);
+
+  args["walls"] = "0 0 1";
+  REQUIRE_THROWS_AS(args.get_cc(), std::invalid_argument);
+  args["walls"] = "0 0 1 x";
+  REQUIRE_THROWS_AS(args.get_cc(), std::invalid_argument);
+
+  args["walls"] = votess::planes_t(args::cc::walls_maxsize + 1, {1, 0, 0, 0});
+  REQUIRE_THROWS_AS(args.get_cc(), std::invalid_argument);
+
+  args["walls"] = walls;
+  args["use_periodic"] = true;
+  REQUIRE_THROWS_AS(args.get_cc(), std::invalid_argument);
+}
+
+TEST_CASE("vtargs device_cc and device_knn", "[vtargs]") {
+  votess::vtargs args;
+  args["k"] = 24;
+  args["box_xmin"] = -2.0;
+  args["box_xmax"] = 6.0;
+  args["max_radius"] = 0.1;
+  args["walls"] = votess::planes_t{{1, 0, 0, -0.25}, {0, -1, 0, 0.5}};
+
+  const args::device_cc<float> cc(args.get_cc());
+  const args::device_knn<float> knn(args.get_knn());
+
+  // every length is a float, taken from its double on the host
+  static_assert(std::is_same<decltype(cc.walls[0]), const float&>::value, "");
+  static_assert(std::is_same<decltype(cc.box.length(0)), float>::value, "");
+  static_assert(std::is_same<decltype(knn.max_radius), float>::value, "");
+
+  REQUIRE(cc.k == 24);
+  REQUIRE(cc.nwalls == 2);
+  REQUIRE(cc.walls[3] == -0.25f);
+  REQUIRE(cc.walls[7] == 0.5f);
+  REQUIRE(cc.max_radius == 0.1f);
+  REQUIRE(cc.box.lo[0] == -2.0f);
+  REQUIRE(cc.box.length(0) == 8.0f);
+  REQUIRE(cc.box.cell(0) == static_cast<float>(args.get_box().cell(0)));
+  REQUIRE(knn.k == 24);
+  REQUIRE(knn.max_radius == 0.1f);
+  REQUIRE(knn.box.gr[0] == args.get_box().gr[0]);
+  REQUIRE(knn.box.size() == args.get_box().size());
 }
@@ -539,3 +539,87 @@ TEST_CASE("[GPU] boundary tests: case 1", "[boundary]") {
   }
 
 }
+TEST_CASE("[CPU] boundary tests: 16 bit plane indices", "[boundary]") {
+
+  // case 1, with every plane index moved past what uint8_t can hold
+  const uint16_t shift = 300;
+  const short int dR_size = shift + 16;
+  std::vector<uint16_t> dR(dR_size, boundary::sentinel<uint16_t>());
+  std::vector<int> ans = {0, 2, 1, 3};
+  for (auto& a : ans) a += shift;
+
+  short int head = -1;
+  short int T_size = 4;
+  short int ulimit = 10;
+
+  std::vector<uint16_t> T = { 2, 5, 0, 5, 3, 0, 1, 5, 2, 5, 1, 3 };
+  for (auto& t : T) t += shift;
+
+  const auto bstat = boundary::compute<short int, uint16_t>(
+    dR.data(), 0, dR_size, head, T.data(), 0, T_size
+  );
+  REQUIRE(bstat == boundary::bstatus::success);
+
+  std::vector<int> vec(dR.begin(), dR.end());
+  boundary::test(vec, head, ans, ulimit);
+
+}
+TEST_CASE("[CPU] boundary tests: edge keyed extraction", "[boundary]") {
+
+  const short int dR_size = 16;
+  const int none = boundary::sentinel<int>();
+  std::vector<int> dR(dR_size, none);
+  std::vector<int> table(2 * boundary::table_size, none);
+
+  const auto clean = [&](const std::vector<int>& v) {
+    return std::all_of(v.begin(), v.end(), [&](int x) { return x == none; });
+  };
+
+  SECTION("case 1, every order of the triangles") {
+
+    std::vector<int> ans = {0, 2, 1, 3};
+    std::vector<int> order = {0, 1, 2, 3};
+    const std::vector<int> tri = { 2, 5, 0, 5, 3, 0, 1, 5, 2, 5, 1, 3 };
+
+    do {
+      std::vector<int> T;
+      for (const int j : order) {
+        T.insert(T.end(), tri.begin() + 3 * j, tri.begin() + 3 * j + 3);
+      }
+
+      short int head = -1;
+      const auto bstat = boundary::extract<short int, int>(
+        dR.data(), 0, head, T.data(), 0, 4, table.data(), 0
+      );
+      REQUIRE(bstat == boundary::bstatus::success);
+      REQUIRE(clean(table));
+
+      boundary::test(dR, head, ans, 10);
+      std::fill(dR.begin(), dR.end(), none);
+    } while (std::next_permutation(order.begin(), order.end()));
+
+  }
+
+  SECTION("disconnected region") {
+    std::vector<int> T = { 0, 1, 2, 3, 4, 5 };
+    short int head = -1;
+    const auto bstat = boundary::extract<short int, int>(
+      dR.data(), 0, head, T.data(), 0, 2, table.data(), 0
+    );
+    REQUIRE(bstat == boundary::bstatus::unreachable);
+    REQUIRE(clean(table));
+    REQUIRE(clean(dR));
+  }
+
+  SECTION("region too large for the table") {
+    const short int r_size = boundary::table_size / 6 + 1;
+    std::vector<int> T(3 * r_size, 0);
+    short int head = -1;
+    const auto bstat = boundary::extract<short int, int>(
+      dR.data(), 0, head, T.data(), 0, r_size, table.data(), 0
+    );
+    REQUIRE(bstat == boundary::bstatus::overflow);
+    REQUIRE(clean(table));
+  }
+
+}
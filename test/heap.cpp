@@ -4,6 +4,7 @@
 #include <vector>
 #include <utility>
 #include <limits>
+#include <algorithm>
 
 ///////////////////////////////////////////////////////////////////////////////
 /// heap:swap()                                                             ///
@@ -1234,3 +1235,72 @@ TEST_CASE("[CPU] heap::sort", "[heap]") {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
+/// heap::minheapify(), heap::minpush(), heap::minpop()                     ///
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("[CPU] heap::minheapify", "[heap]") {
+
+  SECTION("root is the smallest element") {
+
+    std::vector<int> hid = {1, 2, 3, 4, 5};
+    std::vector<float> hpq = {5.0f, 1.0f, 4.0f, 2.0f, 3.0f};
+
+    for (int i = hid.size() / 2 - 1; i >= 0; i--) {
+      heap::minheapify(hid, hpq, 0, hid.size(), i);
+    }
+
+    REQUIRE(hid[0] == 2);
+    REQUIRE_THAT(hpq[0], Catch::Matchers::WithinRel(1.0f));
+    for (size_t i = 1; i < hpq.size(); i++) {
+      REQUIRE(hpq[(i - 1) / 2] <= hpq[i]);
+    }
+
+  }
+
+  SECTION("offset heap") {
+
+    std::vector<int> hid = {7, 7, 1, 2, 3};
+    std::vector<float> hpq = {0.0f, 0.0f, 3.0f, 2.0f, 1.0f};
+
+    heap::minheapify(hid, hpq, 2, 3, 0);
+
+    REQUIRE(hid[0] == 7);
+    REQUIRE(hid[1] == 7);
+    REQUIRE(hid[2] == 3);
+    REQUIRE_THAT(hpq[2], Catch::Matchers::WithinRel(1.0f));
+
+  }
+
+}
+
+TEST_CASE("[CPU] heap::minpush and heap::minpop", "[heap]") {
+
+  const std::vector<float> values = {
+    0.5f, 0.25f, 0.75f, 0.125f, 0.875f, 0.375f, 0.625f, 0.0f, 1.0f
+  };
+
+  std::vector<int> hid(values.size());
+  std::vector<float> hpq(values.size());
+
+  size_t size = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    heap::minpush(hid, hpq, 0, size, static_cast<int>(i), values[i]);
+    size += 1;
+    REQUIRE(hpq[0] == *std::min_element(values.begin(), 
+                                        values.begin() + i + 1));
+  }
+
+  std::vector<float> popped;
+  while (size > 0) {
+    REQUIRE(values[hid[0]] == hpq[0]);
+    popped.push_back(hpq[0]);
+    heap::minpop(hid, hpq, 0, size);
+    size -= 1;
+  }
+
+  REQUIRE(popped.size() == values.size());
+  REQUIRE(std::is_sorted(popped.begin(), popped.end()));
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
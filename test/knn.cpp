@@ -0,0 +1,469 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <knn.hpp>
+
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <type_traits>
+
+///////////////////////////////////////////////////////////////////////////////
+/// knni::stream                                                            ///
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Tf>
+static std::vector<std::array<Tf, 3>>
+generate_xyzset(const size_t N, const unsigned int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<Tf> dis(0.0 + 0.001, 1.0 - 0.001);
+  std::vector<std::array<Tf, 3>> xyzset(N);
+  for (auto& p : xyzset) {
+    p = {dis(gen), dis(gen), dis(gen)};
+  }
+  return xyzset;
+}
+
+template <typename Tf>
+static void test_stream(const size_t N, const int gr) {
+
+  auto xyzset = generate_xyzset<Tf>(N, 42);
+  const auto [id, offset] = xyzset::sort<int, Tf>(xyzset, args::xyzset(gr));
+
+  knni::stream<int, Tf> stream(xyzset, id, offset, args::knn(4, gr));
+
+  for (int index = 0; index < static_cast<int>(N); index++) {
+
+    std::vector<Tf> expected;
+    for (int p = 0; p < static_cast<int>(N); p++) {
+      if (p == index) continue;
+      expected.push_back(xyzset::get_distance(
+        xyzset[p][0], xyzset[p][1], xyzset[p][2],
+        xyzset[index][0], xyzset[index][1], xyzset[index][2]
+      ));
+    }
+    std::sort(expected.begin(), expected.end());
+
+    stream.reset(index, xyzset[index]);
+
+    int p = 0;
+    Tf pq = 0;
+    std::vector<int> seen;
+    std::vector<Tf> received;
+    while (stream.next(p, pq)) {
+      REQUIRE(p != index);
+      seen.push_back(p);
+      received.push_back(pq);
+    }
+
+    std::sort(seen.begin(), seen.end());
+    REQUIRE(std::adjacent_find(seen.begin(), seen.end()) == seen.end());
+    REQUIRE(received.size() == expected.size());
+    REQUIRE(received == expected);
+
+  }
+
+}
+
+TEST_CASE("[CPU] knni::stream yields every point in ascending order",
+          "[knn]") {
+
+  for (const auto gr : {1, 2, 3, 5, 8}) {
+    SECTION("[float] grid_resolution = " + std::to_string(gr)) {
+      test_stream<float>(96, gr);
+    }
+    SECTION("[double] grid_resolution = " + std::to_string(gr)) {
+      test_stream<double>(96, gr);
+    }
+  }
+
+}
+
+TEST_CASE("[CPU] knni::stream matches knni::compute", "[knn]") {
+
+  const size_t N = 128;
+  const int k = 16;
+  const int gr = 4;
+
+  auto xyzset = generate_xyzset<float>(N, 7);
+  const auto [id, offset] = xyzset::sort<int, float>(xyzset,
+                                                     args::xyzset(gr));
+
+  std::vector<int> heap_id(N * k, 0);
+  std::vector<float> heap_pq(N * k, std::numeric_limits<float>::infinity());
+
+  knni::stream<int, float> stream(xyzset, id, offset, args::knn(k, gr));
+
+  for (int i = 0; i < static_cast<int>(N); i++) {
+
+    knni::compute<int, float>(
+      i, i, xyzset, N, id, offset, xyzset, N,
+      heap_id, heap_pq, args::knn(k, gr)
+    );
+
+    stream.reset(i, xyzset[i]);
+    for (int j = 0; j < k; j++) {
+      int p = 0;
+      float pq = 0;
+      REQUIRE(stream.next(p, pq));
+      REQUIRE(pq == heap_pq[k * i + j]);
+    }
+
+  }
+
+}
+
+TEST_CASE("[CPU] knni::compute with int64_t indices matches int", "[knn]") {
+
+  // Offsets past 2^31 need more points than a test can hold, so this pins the
+  // int64_t path down by type instead, and checks it against the int one.
+  const size_t N = 128;
+  const int k = 16;
+  const int gr = 4;
+
+  auto xyzset_i = generate_xyzset<float>(N, 49);
+  auto xyzset_l = xyzset_i;
+  const auto [id_i, offset_i] = xyzset::sort<int, float>(xyzset_i,
+                                                         args::xyzset(gr));
+  const auto [id_l, offset_l] = xyzset::sort<int64_t, float>(xyzset_l,
+                                                             args::xyzset(gr));
+
+  static_assert(std::is_same<std::decay_t<decltype(offset_l)>,
+                             std::vector<int64_t>>::value,
+                "int64_t offsets must stay int64_t");
+  REQUIRE(xyzset_i == xyzset_l);
+  REQUIRE(std::equal(offset_i.begin(), offset_i.end(), offset_l.begin(),
+                     offset_l.end()));
+
+  std::vector<int> heap_id_i(N * k, 0);
+  std::vector<int64_t> heap_id_l(N * k, 0);
+  std::vector<float> heap_pq_i(N * k, std::numeric_limits<float>::infinity());
+  std::vector<float> heap_pq_l(N * k, std::numeric_limits<float>::infinity());
+
+  for (size_t i = 0; i < N; i++) {
+    knni::compute<int, float>(
+      i, i, xyzset_i, N, id_i, offset_i, xyzset_i, N,
+      heap_id_i, heap_pq_i, args::knn(k, gr)
+    );
+    knni::compute<int64_t, float>(
+      i, i, xyzset_l, N, id_l, offset_l, xyzset_l, N,
+      heap_id_l, heap_pq_l, args::knn(k, gr)
+    );
+  }
+
+  REQUIRE(heap_pq_i == heap_pq_l);
+  REQUIRE(std::equal(heap_id_i.begin(), heap_id_i.end(), heap_id_l.begin(),
+                     heap_id_l.end()));
+
+}
+
+TEST_CASE("[CPU] knni::range returns every point within the shell", "[knn]") {
+
+  const size_t N = 256;
+  const int gr = 5;
+
+  auto xyzset = generate_xyzset<double>(N, 11);
+  const auto [id, offset] = xyzset::sort<int, double>(xyzset,
+                                                      args::xyzset(gr));
+
+  std::vector<int> heap_id;
+  std::vector<double> heap_pq;
+
+  for (const auto& [pq_min, pq_max] : {std::pair<double, double>{0.0, 0.01},
+                                      std::pair<double, double>{0.01, 0.05},
+                                      std::pair<double, double>{0.0, 3.0}}) {
+
+    for (int index = 0; index < static_cast<int>(N); index += 7) {
+
+      const auto& q = xyzset[index];
+
+      std::vector<int> expected;
+      for (int p = 0; p < static_cast<int>(N); p++) {
+        if (p == index) continue;
+        const double pq = xyzset::get_distance(
+          xyzset[p][0], xyzset[p][1], xyzset[p][2], q[0], q[1], q[2]
+        );
+        if (pq >= pq_min && pq <= pq_max) expected.push_back(p);
+      }
+
+      const size_t size = knni::range<int, double>(
+        index, q, xyzset, offset, pq_min, pq_max,
+        heap_id, heap_pq, 0, args::knn(4, gr)
+      );
+
+      std::vector<int> received(heap_id.begin(), heap_id.begin() + size);
+      std::sort(received.begin(), received.end());
+
+      CAPTURE(index, pq_min, pq_max);
+      REQUIRE(received == expected);
+
+    }
+
+  }
+
+}
+
+TEST_CASE("[CPU] knni::budget scales k with the local density", "[knn]") {
+
+  const int gr = 4;
+  const int k = 32;
+
+  // dense cluster in the first grid cell, uniform points elsewhere
+  auto xyzset = generate_xyzset<float>(512, 3);
+  for (size_t i = 0; i < 256; i++) {
+    for (auto& c : xyzset[i]) c *= 0.2f;
+  }
+
+  const auto [id, offset] = xyzset::sort<int, float>(xyzset,
+                                                     args::xyzset(gr));
+
+  int k_dense = 0;
+  int k_sparse = 0;
+  for (int index = 0; index < static_cast<int>(xyzset.size()); index++) {
+    const int ki = knni::budget<int>(index, id, offset, 8, 128,
+                                     args::knn(k, gr));
+    REQUIRE(ki >= 8);
+    REQUIRE(ki <= 128);
+    if (id[index] == 0) k_dense = ki;
+    if (id[index] == gr * gr * gr - 1) k_sparse = ki;
+  }
+
+  REQUIRE(k_dense > k);
+  REQUIRE(k_sparse < k);
+
+  // bounded by the number of points
+  REQUIRE(knni::budget<int>(0, id, offset, 8, 4096, 
+                            args::knn(4096, gr)) == 511);
+
+}
+
+TEST_CASE("[CPU] knni with periodic boundaries", "[knn]") {
+
+  const size_t N = 160;
+  const int k = 12;
+
+  auto xyzset = generate_xyzset<double>(N, 19);
+
+  // squared distance to the nearest image
+  const auto distance = [&](const int p, const int q) {
+    double pq = 0;
+    for (int c = 0; c < 3; c++) {
+      const double d = std::abs(xyzset[p][c] - xyzset[q][c]);
+      pq += std::min(d, 1.0 - d) * std::min(d, 1.0 - d);
+    }
+    return pq;
+  };
+
+  for (const auto gr : {1, 2, 3, 4, 6}) {
+
+    SECTION("grid_resolution = " + std::to_string(gr)) {
+
+      const auto [id, offset] = xyzset::sort<int, double>(xyzset,
+                                                          args::xyzset(gr));
+
+      const struct args::knn args(k, gr, true);
+
+      std::vector<int> heap_id(N * k, 0);
+      std::vector<double> heap_pq(N * k, 
+                                  std::numeric_limits<double>::infinity());
+      knni::stream<int, double> stream(xyzset, id, offset, args);
+
+      std::vector<int> range_id;
+      std::vector<double> range_pq;
+
+      for (int i = 0; i < static_cast<int>(N); i++) {
+
+        std::vector<double> expected;
+        for (int p = 0; p < static_cast<int>(N); p++) {
+          if (p != i) expected.push_back(distance(p, i));
+        }
+        std::sort(expected.begin(), expected.end());
+
+        CAPTURE(i);
+
+        knni::compute<int, double>(
+          i, i, xyzset, N, id, offset, xyzset, N,
+          heap_id, heap_pq, args
+        );
+        for (int j = 0; j < k; j++) {
+          REQUIRE_THAT(heap_pq[k * i + j], 
+                       Catch::Matchers::WithinAbs(expected[j], 1e-12));
+        }
+
+        stream.reset(i, xyzset[i]);
+        size_t count = 0;
+        int p = 0;
+        double pq = 0;
+        while (stream.next(p, pq)) {
+          REQUIRE(count < expected.size());
+          REQUIRE_THAT(pq, Catch::Matchers::WithinAbs(expected[count], 1e-12));
+          count++;
+        }
+        REQUIRE(count == expected.size());
+
+        const double pq_max = (expected[N / 4] + expected[N / 4 + 1]) / 2;
+        const size_t size = knni::range<int, double>(
+          i, xyzset[i], xyzset, offset, 0.0, pq_max,
+          range_id, range_pq, 0, args
+        );
+        std::vector<int> received(range_id.begin(), range_id.begin() + size);
+        std::sort(received.begin(), received.end());
+        std::vector<int> within;
+        for (int q = 0; q < static_cast<int>(N); q++) {
+          if (q != i && distance(q, i) <= pq_max) within.push_back(q);
+        }
+        REQUIRE(received == within);
+
+      }
+
+    }
+
+  }
+
+}
+
+TEST_CASE("[CPU] knni in a non-cubic box", "[knn]") {
+
+  const size_t N = 200;
+  const int k = 12;
+  const args::box box(-1.0, 3.0, 0.5, 1.0, 2.0, 3.0, 8);
+
+  std::mt19937 gen(23);
+  std::vector<std::array<double, 3>> xyzset(N);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) {
+      std::uniform_real_distribution<double> dis(box.lo[c], box.hi[c]);
+      p[c] = dis(gen);
+    }
+  }
+
+  for (const bool periodic : {false, true}) {
+
+    SECTION(periodic ? "periodic" : "bounded") {
+
+      const auto [id, offset] = 
+        xyzset::sort<int, double>(xyzset, args::xyzset(box, 8));
+      const struct args::knn args(k, box, 8, periodic);
+
+      const auto distance = [&](const int p, const int q) {
+        double pq = 0;
+        for (int c = 0; c < 3; c++) {
+          double d = std::abs(xyzset[p][c] - xyzset[q][c]);
+          if (periodic) d = std::min(d, box.length(c) - d);
+          pq += d * d;
+        }
+        return pq;
+      };
+
+      std::vector<int> heap_id(N * k, 0);
+      std::vector<double> heap_pq(N * k, 
+                                  std::numeric_limits<double>::infinity());
+      knni::stream<int, double> stream(xyzset, id, offset, args);
+
+      std::vector<int> range_id;
+      std::vector<double> range_pq;
+
+      for (int i = 0; i < static_cast<int>(N); i++) {
+
+        std::vector<double> expected;
+        for (int p = 0; p < static_cast<int>(N); p++) {
+          if (p != i) expected.push_back(distance(p, i));
+        }
+        std::sort(expected.begin(), expected.end());
+
+        CAPTURE(i);
+
+        knni::compute<int, double>(
+          i, i, xyzset, N, id, offset, xyzset, N,
+          heap_id, heap_pq, args
+        );
+        for (int j = 0; j < k; j++) {
+          REQUIRE_THAT(heap_pq[k * i + j], 
+                       Catch::Matchers::WithinAbs(expected[j], 1e-12));
+        }
+
+        stream.reset(i, xyzset[i]);
+        for (int j = 0; j < k; j++) {
+          int p = 0;
+          double pq = 0;
+          REQUIRE(stream.next(p, pq));
+          REQUIRE_THAT(pq, Catch::Matchers::WithinAbs(expected[j], 1e-12));
+        }
+
+        const double pq_max = (expected[k] + expected[k + 1]) / 2;
+        const size_t size = knni::range<int, double>(
+          i, xyzset[i], xyzset, offset, 0.0, pq_max,
+          range_id, range_pq, 0, args
+        );
+        REQUIRE(size == static_cast<size_t>(k + 1));
+
+      }
+
+    }
+
+  }
+
+}
+
+TEST_CASE("[CPU] knni with a maximum radius", "[knn]") {
+
+  const size_t N = 200;
+  const int k = 12;
+  const int gr = 8;
+  const double max_radius = 0.05;
+  const double cutoff = 12 * max_radius * max_radius;
+
+  auto xyzset = generate_xyzset<double>(N, 29);
+  const auto [id, offset] = xyzset::sort<int, double>(xyzset, 
+                                                       args::xyzset(gr));
+  const struct args::knn args(k, args::box(gr), gr, false, max_radius);
+
+  std::vector<int> heap_id(N * k, 0);
+  std::vector<double> heap_pq(N * k, std::numeric_limits<double>::infinity());
+  knni::stream<int, double> stream(xyzset, id, offset, args);
+
+  for (int i = 0; i < static_cast<int>(N); i++) {
+
+    std::vector<double> expected;
+    for (int p = 0; p < static_cast<int>(N); p++) {
+      const double pq = xyzset::get_distance(
+        xyzset[p][0], xyzset[p][1], xyzset[p][2],
+        xyzset[i][0], xyzset[i][1], xyzset[i][2]
+      );
+      if (p != i && pq < cutoff) expected.push_back(pq);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    CAPTURE(i);
+
+    // points out of reach leave their slot undefined
+    knni::compute<int, double>(
+      i, i, xyzset, N, id, offset, xyzset, N, heap_id, heap_pq, args
+    );
+    for (int j = 0; j < k; j++) {
+      if (j < static_cast<int>(expected.size())) {
+        REQUIRE(heap_pq[k * i + j] == expected[j]);
+      } else {
+        REQUIRE(heap_id[k * i + j] == cc::k_undefined);
+      }
+    }
+
+    stream.reset(i, xyzset[i]);
+    int p = 0;
+    double pq = 0;
+    size_t size = 0;
+    while (stream.next(p, pq)) {
+      REQUIRE(size < expected.size());
+      REQUIRE(pq == expected[size]);
+      size++;
+    }
+    REQUIRE(size == expected.size());
+
+  }
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,244 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <votess.hpp>
+#include <mesh.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>
+
+// Unit cube as a cell: its vertices, and its faces as the number of
+// vertices of each followed by its vertices, counterclockwise from outside.
+static const std::vector<float> cube_vertices = {
+  0,0,0, 1,0,0, 1,1,0, 0,1,0,
+  0,0,1, 1,0,1, 1,1,1, 0,1,1,
+};
+static const std::vector<unsigned short int> cube_loops = {
+  4, 0,3,2,1,  4, 4,5,6,7,  4, 0,1,5,4,
+  4, 2,3,7,6,  4, 1,2,6,5,  4, 0,4,7,3,
+};
+
+template <typename T>
+static T get(std::istream& is, const bool big) {
+  char b[sizeof(T)];
+  is.read(b, sizeof(T));
+  if (big == mesh::internal::little_endian()) std::reverse(b, b + sizeof(T));
+  T v;
+  std::memcpy(&v, b, sizeof(T));
+  return v;
+}
+
+static std::string line(std::istream& is) {
+  std::string s;
+  std::getline(is, s);
+  return s;
+}
+
+static bool exists(const std::string& fname) {
+  std::ifstream fp(fname);
+  return fp.good();
+}
+
+TEST_CASE("mesh::get_format", "[mesh]") {
+  REQUIRE(mesh::get_format("cells.ply") == mesh::format::ply);
+  REQUIRE(mesh::get_format("cells.vtk") == mesh::format::vtk);
+  REQUIRE(mesh::get_format("ply") == mesh::format::vtk);
+  REQUIRE(mesh::get_format("cells") == mesh::format::vtk);
+}
+
+TEST_CASE("mesh::writer", "[mesh]") {
+
+  SECTION("vtk") {
+    const std::string fname = "__test__mesh.vtk";
+    {
+      mesh::writer<float> writer(fname);
+      REQUIRE(writer.good());
+      writer.add(3, cube_vertices, cube_loops, 1.0f, 6);
+      writer.add(5, cube_vertices, cube_loops, 0.5f, 2);
+      writer.add(7, {}, {}, 0.0f, 0);
+    }
+    REQUIRE(!exists(fname + ".points.tmp"));
+
+    std::ifstream fp(fname, std::ios::binary);
+    REQUIRE(line(fp) == "# vtk DataFile Version 4.2");
+    REQUIRE(line(fp) == "votess");
+    REQUIRE(line(fp) == "BINARY");
+    REQUIRE(line(fp) == "DATASET UNSTRUCTURED_GRID");
+    REQUIRE(line(fp) == "POINTS 16 float");
+    for (int j = 0; j < 16 * 3; j++) {
+      REQUIRE(get<float>(fp, true) == cube_vertices[j % 24]);
+    }
+    REQUIRE(line(fp) == "");
+    REQUIRE(line(fp) == "CELLS 2 64");
+    for (int c = 0; c < 2; c++) {
+      REQUIRE(get<int32_t>(fp, true) == 31);
+      REQUIRE(get<int32_t>(fp, true) == 6);
+      for (size_t j = 0; j < cube_loops.size(); j++) {
+        const int v = cube_loops[j] + (j % 5 == 0 ? 0 : 8 * c);
+        REQUIRE(get<int32_t>(fp, true) == v);
+      }
+    }
+    REQUIRE(line(fp) == "");
+    REQUIRE(line(fp) == "CELL_TYPES 2");
+    REQUIRE(get<int32_t>(fp, true) == 42);
+    REQUIRE(get<int32_t>(fp, true) == 42);
+    REQUIRE(line(fp) == "");
+    REQUIRE(line(fp) == "CELL_DATA 2");
+    REQUIRE(line(fp) == "SCALARS index int 1");
+    REQUIRE(line(fp) == "LOOKUP_TABLE default");
+    REQUIRE(get<int32_t>(fp, true) == 3);
+    REQUIRE(get<int32_t>(fp, true) == 5);
+    REQUIRE(line(fp) == "");
+    REQUIRE(line(fp) == "SCALARS volume float 1");
+    REQUIRE(line(fp) == "LOOKUP_TABLE default");
+    REQUIRE(get<float>(fp, true) == 1.0f);
+    REQUIRE(get<float>(fp, true) == 0.5f);
+    REQUIRE(line(fp) == "");
+    REQUIRE(line(fp) == "SCALARS neighbors int 1");
+    REQUIRE(line(fp) == "LOOKUP_TABLE default");
+    REQUIRE(get<int32_t>(fp, true) == 6);
+    REQUIRE(get<int32_t>(fp, true) == 2);
+    REQUIRE(line(fp) == "");
+    REQUIRE(fp.peek() == std::ifstream::traits_type::eof());
+
+    fp.close();
+    std::remove(fname.c_str());
+  }
+
+  SECTION("ply") {
+    const std::string fname = "__test__mesh.ply";
+    {
+      mesh::writer<double> writer(fname);
+      std::vector<double> vertices(cube_vertices.begin(), cube_vertices.end());
+      writer.add(3, vertices, cube_loops, 1.0, 6);
+      writer.close();
+      writer.add(5, vertices, cube_loops, 1.0, 6);
+    }
+
+    std::ifstream fp(fname, std::ios::binary);
+    REQUIRE(line(fp) == "ply");
+    REQUIRE(line(fp) == "format binary_little_endian 1.0");
+    REQUIRE(line(fp) == "comment votess");
+    REQUIRE(line(fp) == "element vertex 8");
+    REQUIRE(line(fp) == "property double x");
+    REQUIRE(line(fp) == "property double y");
+    REQUIRE(line(fp) == "property double z");
+    REQUIRE(line(fp) == "element face 6");
+    REQUIRE(line(fp) == "property list int int vertex_indices");
+    REQUIRE(line(fp) == "property int cell");
+    REQUIRE(line(fp) == "property double volume");
+    REQUIRE(line(fp) == "property int neighbors");
+    REQUIRE(line(fp) == "end_header");
+    for (int j = 0; j < 8 * 3; j++) {
+      REQUIRE(get<double>(fp, false) == cube_vertices[j]);
+    }
+    for (size_t c = 0; c < cube_loops.size(); c += 5) {
+      REQUIRE(get<int32_t>(fp, false) == 4);
+      for (int j = 1; j <= 4; j++) {
+        REQUIRE(get<int32_t>(fp, false) == cube_loops[c + j]);
+      }
+      REQUIRE(get<int32_t>(fp, false) == 3);
+      REQUIRE(get<double>(fp, false) == 1.0);
+      REQUIRE(get<int32_t>(fp, false) == 6);
+    }
+    REQUIRE(fp.peek() == std::ifstream::traits_type::eof());
+
+    fp.close();
+    std::remove(fname.c_str());
+  }
+
+  // indices are written as int32, so one past them leaves no file at all
+  SECTION("int32 overflow") {
+    const std::string fname = "__test__overflow.vtk";
+    std::ostringstream sink;
+    auto* cerr = std::cerr.rdbuf(sink.rdbuf());
+    {
+      mesh::writer<float> writer(fname);
+      writer.add(3, cube_vertices, cube_loops, 1.0f, 6);
+      REQUIRE(writer.good());
+      writer.add(size_t(1) << 31, cube_vertices, cube_loops, 1.0f, 6);
+      REQUIRE(!writer.good());
+      writer.add(5, cube_vertices, cube_loops, 1.0f, 6);
+    }
+    std::cerr.rdbuf(cerr);
+    REQUIRE(sink.str().find("32-bit") != std::string::npos);
+    REQUIRE(!exists(fname));
+    REQUIRE(!exists(fname + ".points.tmp"));
+  }
+
+}
+
+TEST_CASE("mesh: tesellate streams every cell", "[mesh]") {
+
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> dis(0.001f, 0.999f);
+  std::vector<std::array<float, 3>> xyzset(500);
+  for (auto& p : xyzset) p = {dis(gen), dis(gen), dis(gen)};
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 4;
+  vtargs["use_recompute"] = true;
+  vtargs["use_chunking"] = true;
+  vtargs["chunksize"] = 128;
+
+  std::ostringstream sink;
+  auto* cout = std::cout.rdbuf(sink.rdbuf());
+
+  struct votess::polyhedra<int, float> poly;
+  (void)votess::tesellate<int, float>(xyzset, poly, vtargs);
+
+  // the GPU kernels do not build polyhedra, so the file is written on the CPU
+  enum votess::device device = votess::device::cpu;
+  SECTION("[CPU]") {}
+  SECTION("[GPU]") {
+    device = votess::device::gpu;
+  }
+
+  const std::string fname = "__test__tesellate.ply";
+  vtargs["mesh_outfile"] = fname;
+  (void)votess::tesellate<int, float>(xyzset, vtargs, device);
+
+  std::cout.rdbuf(cout);
+
+  std::ifstream fp(fname, std::ios::binary);
+  std::string s;
+  size_t nvertices = 0, nfaces = 0;
+  while ((s = line(fp)) != "end_header") {
+    std::istringstream iss(s);
+    std::string a, b;
+    iss >> a >> b;
+    if (a == "element" && b == "vertex") iss >> nvertices;
+    if (a == "element" && b == "face") iss >> nfaces;
+  }
+  REQUIRE(nvertices == poly.vertices.size());
+  REQUIRE(nfaces == poly.neighbor.size());
+
+  // every cell is there, once, with its faces
+  std::vector<size_t> count(xyzset.size(), 0);
+  fp.seekg(3 * sizeof(float) * nvertices, std::ios::cur);
+  for (size_t f = 0; f < nfaces; f++) {
+    const int n = get<int32_t>(fp, false);
+    fp.seekg(n * sizeof(int32_t), std::ios::cur);
+    const int cell = get<int32_t>(fp, false);
+    (void)get<float>(fp, false);
+    (void)get<int32_t>(fp, false);
+    REQUIRE(cell >= 0);
+    REQUIRE(size_t(cell) < xyzset.size());
+    count[cell]++;
+  }
+  REQUIRE(fp.peek() == std::ifstream::traits_type::eof());
+  for (size_t i = 0; i < xyzset.size(); i++) {
+    CAPTURE(i);
+    REQUIRE(count[i] == poly.foffs[i + 1] - poly.foffs[i]);
+  }
+
+  fp.close();
+  std::remove(fname.c_str());
+
+}
@@ -154,3 +154,56 @@ TEST_CASE("intersect", "[planes]") {
 
 }
 
+
+TEST_CASE("uncertain", "[planes]") {
+
+  // a vertex at (0.5, 0.5, 0.5) and planes x = 0.5 + h
+  const auto uncertain = [](const float h, const float cancelled) {
+    const float d = planes::dot<float>(0.5f, 0.5f, 0.5f, 1, 
+                                       1, 0, 0, -0.5f - h);
+    return planes::uncertain<float>(d, 0.5f, 0.5f, 0.5f, 1, 
+                                    1, 0, 0, -0.5f - h, cancelled);
+  };
+
+  REQUIRE(uncertain(0.0f, 0.0f));
+  REQUIRE(uncertain(1e-7f, 0.0f));
+  REQUIRE(!uncertain(1e-3f, 0.0f));
+  REQUIRE(!uncertain(-1e-3f, 0.0f));
+
+  // digits lost before the product widen the bound
+  REQUIRE(!uncertain(1e-5f, 0.0f));
+  REQUIRE(uncertain(1e-5f, 100.0f));
+
+}
+
+TEST_CASE("perturbed", "[planes]") {
+
+  // the vertex of the bisectors along x, y and z, made from points 1, 2 and
+  // 3, level with the bisector along (1, 1, 1) made from point 4
+  const auto perturbed = [](const int o1, const int o2, const int o3,
+                            const int oq, const int op) {
+    return planes::perturbed<float, int>(1, 0, 0, o1, 0, 1, 0, o2, 
+                                         0, 0, 1, o3, 1, 1, 1, oq, op);
+  };
+
+  // the lowest index with a weight that moves the vertex decides
+  REQUIRE(perturbed(1, 2, 3, 4, 0) == 1);
+  REQUIRE(perturbed(1, 2, 3, 4, 5) == -1);
+  REQUIRE(perturbed(5, 6, 7, 4, 8) == 1);
+  REQUIRE(perturbed(5, 6, 7, 8, 4) == 1);
+
+  // planes that are not bisectors do not move
+  REQUIRE(perturbed(-1, -1, -1, 4, 5) == 1);
+  REQUIRE(perturbed(-1, -1, -1, 5, 4) == -1);
+
+  // periodic images of the same point share its weight
+  REQUIRE(planes::perturbed<float, int>(1, 0, 0, 1, 0, 1, 0, 2, 0, 0, 1, 3, 
+                                        1, 0, 0, 1, 0) == 0);
+  REQUIRE(planes::perturbed<float, int>(1, 0, 0, 1, 0, 1, 0, 2, 0, 0, 1, 3, 
+                                        1, 1, 0, 1, 0) == 1);
+
+  // dependent planes have no vertex
+  REQUIRE(planes::perturbed<float, int>(1, 0, 0, 1, 0, 1, 0, 2, 1, 1, 0, 3, 
+                                        1, 1, 1, 4, 0) == 0);
+
+}
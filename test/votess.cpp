@@ -155,6 +155,51 @@ static void test_votess(
     vtargs["knn_grid_resolution"] = gr;
     run_test(xyzset, vtargs, votess::device::gpu);
   }
+  SECTION("[GPU] [chunking] case : grid_resolution = " 
+          + std::to_string(gr)) {
+    struct votess::vtargs vtargs;
+    vtargs["k"] = k;
+    vtargs["knn_grid_resolution"] = gr;
+    vtargs["use_chunking"] = true;
+    vtargs["chunksize"] = 48;
+    run_test(xyzset, vtargs, votess::device::gpu);
+  }
+  SECTION("[CPU] [stream] case : grid_resolution = " 
+          + std::to_string(gr)) {
+    struct votess::vtargs vtargs;
+    vtargs["k"] = k;
+    vtargs["knn_grid_resolution"] = gr;
+    vtargs["use_knn_stream"] = true;
+    vtargs["use_recompute"] = true;
+    run_test(xyzset, vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [small buffers] case : grid_resolution = " 
+          + std::to_string(gr)) {
+    struct votess::vtargs vtargs;
+    vtargs["k"] = k;
+    vtargs["knn_grid_resolution"] = gr;
+    vtargs["cc_p_maxsize"] = 8;
+    vtargs["cc_t_maxsize"] = 8;
+    run_test(xyzset, vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [adaptive k] case : grid_resolution = " 
+          + std::to_string(gr)) {
+    struct votess::vtargs vtargs;
+    vtargs["k"] = k;
+    vtargs["knn_grid_resolution"] = gr;
+    vtargs["use_adaptive_k"] = true;
+    vtargs["use_recompute"] = true;
+    run_test(xyzset, vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [radius recompute] case : grid_resolution = " 
+          + std::to_string(gr)) {
+    struct votess::vtargs vtargs;
+    vtargs["k"] = k;
+    vtargs["knn_grid_resolution"] = gr;
+    vtargs["use_recompute"] = true;
+    vtargs["use_radius_recompute"] = true;
+    run_test(xyzset, vtargs, votess::device::cpu);
+  }
 }
 
 #include <random>
@@ -175,6 +220,56 @@ xyzset_generate_random(size_t N) {
 
   return xyzset;
 }
+
+// N random points, sorted as votess sorts them with 'vtargs', for the tests
+// that compare a per cell output against voro++. The voro++ cell of each
+// point is passed to 'f' with the index and position of the point.
+template <typename T, typename F>
+static std::vector<std::array<T, 3>> 
+xyzset_generate_voro(
+  const size_t N,
+  const struct votess::vtargs& vtargs,
+  F&& f
+) {
+  auto xyzset = xyzset_generate_random<T>(N);
+  (void)xyzset::sort<int,T>(xyzset, vtargs.get_xyzset());
+
+  using namespace voro;
+  const int gr = vtargs.get_xyzset().grid_resolution;
+  container con(0, 1, 0, 1, 0, 1, gr, gr, gr, false, false, false, 
+                xyzset.size());
+  for (size_t i = 0; i < xyzset.size(); i++) {
+    con.put(i, xyzset[i][0], xyzset[i][1], xyzset[i][2]);
+  }
+
+  c_loop_all cl(con);
+  voronoicell_neighbor c;
+  if (cl.start()) do if (con.compute_cell(c, cl)) {
+    double x, y, z;
+    cl.pos(x, y, z);
+    f(cl.pid(), x, y, z, c);
+  } while (cl.inc());
+
+  return xyzset;
+}
+
+// Runs 'check' with the cells clipped against k neighbors, streamed, and
+// resumed from their security radius, all on the CPU.
+template <typename F>
+static void check_cpu_paths(struct votess::vtargs vtargs, F&& check) {
+  SECTION("[CPU]") {
+    check(vtargs);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs);
+  }
+  SECTION("[CPU] [radius recompute]") {
+    vtargs["k"] = 8;
+    vtargs["use_radius_recompute"] = true;
+    check(vtargs);
+  }
+}
 #if 0
 TEST_CASE("votess regression: inital conditions", 
           "[votess]") {
@@ -3670,3 +3765,1242 @@ TEST_CASE("votess regression 19: imbalanced_classes", "[votess]") {
 
 }
 
+#include <cmath>
+TEST_CASE("votess: cells with more planes than uint8_t can index",
+          "[votess]") {
+
+  // the center point is a neighbor of every point of the sphere around it
+  const int n = 300;
+  const double ga = M_PI * (3.0 - std::sqrt(5.0));
+
+  std::vector<std::array<double, 3>> xyzset;
+  xyzset.push_back({0.5, 0.5, 0.5});
+  for (int i = 0; i < n; i++) {
+    const double y = 1.0 - 2.0 * (i + 0.5) / n;
+    const double r = std::sqrt(1.0 - y * y);
+    xyzset.push_back({
+      0.5 + 0.3 * r * std::cos(ga * i),
+      0.5 + 0.3 * y,
+      0.5 + 0.3 * r * std::sin(ga * i)
+    });
+  }
+  const auto center = xyzset[0];
+
+  struct votess::vtargs vtargs;
+  vtargs["knn_grid_resolution"] = 4;
+  vtargs["use_knn_stream"] = true;
+
+  __internal__suppress_stdout s;
+  auto dnn = votess::tesellate<int, double>(xyzset, vtargs, 
+                                            votess::device::cpu);
+
+  const auto it = std::find(xyzset.begin(), xyzset.end(), center);
+  REQUIRE(it != xyzset.end());
+  REQUIRE(dnn[std::distance(xyzset.begin(), it)].size() == 
+          static_cast<size_t>(n));
+
+}
+
+TEST_CASE("votess: security radius of each cell", "[votess]") {
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 4;
+  vtargs["use_recompute"] = true;
+
+  std::vector<double> vradius(512);
+  auto xyzset = xyzset_generate_voro<float>(512, vtargs, 
+    [&](const int i, double, double, double, voro::voronoicell_neighbor& c) {
+      vradius[i] = c.max_radius_squared();
+    });
+
+  check_cpu_paths(vtargs, [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    std::vector<float> radius;
+    (void)votess::tesellate<int, float>(xyzset, radius, args, 
+                                        votess::device::cpu);
+    REQUIRE(radius.size() == xyzset.size());
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE_THAT(radius[i], 
+                   Catch::Matchers::WithinRel(vradius[i], 1e-3));
+    }
+  });
+
+}
+
+TEST_CASE("votess: neighbors are listed nearest first", "[votess]") {
+
+  auto xyzset = xyzset_generate_random<float>(512);
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 4;
+
+  const auto check = [&](struct votess::vtargs args, 
+                         const votess::device device) {
+    __internal__suppress_stdout s;
+    auto dnn = votess::tesellate<int, float>(xyzset, args, device);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() > 0);
+      float prev = 0.00f;
+      for (size_t j = 0; j < dnn[i].size(); j++) {
+        const auto& q = xyzset[dnn[i][j]];
+        const float d = xyzset::get_distance(
+          xyzset[i][0], xyzset[i][1], xyzset[i][2], q[0], q[1], q[2]
+        );
+        REQUIRE(d >= prev);
+        prev = d;
+      }
+    }
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[GPU]") {
+    check(vtargs, votess::device::gpu);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs, votess::device::cpu);
+  }
+
+}
+
+TEST_CASE("votess: geometry of each cell", "[votess]") {
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 4;
+  vtargs["use_recompute"] = true;
+
+  std::vector<double> vvolume(512);
+  std::vector<double> varea(512);
+  std::vector<std::array<double, 3>> vcentroid(512);
+  auto xyzset = xyzset_generate_voro<float>(512, vtargs, 
+    [&](const int i, double x, double y, double z, 
+        voro::voronoicell_neighbor& c) {
+      double cx, cy, cz;
+      c.centroid(cx, cy, cz);
+      vvolume[i] = c.volume();
+      varea[i] = c.surface_area();
+      vcentroid[i] = {x + cx, y + cy, z + cz};
+    });
+
+  check_cpu_paths(vtargs, [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    struct votess::cells<float> cells;
+    (void)votess::tesellate<int, float>(xyzset, cells, args, 
+                                        votess::device::cpu);
+    REQUIRE(cells.volume.size() == xyzset.size());
+    double total = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      using Catch::Matchers::WithinRel;
+      using Catch::Matchers::WithinAbs;
+      REQUIRE_THAT(cells.volume[i], WithinRel(vvolume[i], 1e-3));
+      REQUIRE_THAT(cells.area[i], WithinRel(varea[i], 1e-3));
+      for (int d = 0; d < 3; d++) {
+        REQUIRE_THAT(cells.centroid[i][d], WithinAbs(vcentroid[i][d], 1e-4));
+      }
+      total += cells.volume[i];
+    }
+    REQUIRE_THAT(total, Catch::Matchers::WithinRel(1.0, 1e-4));
+  });
+
+}
+
+TEST_CASE("votess: failed cells report NaN", "[votess]") {
+
+  // points outside of the box have no cell to clip, and must not report
+  // what is left of the cell clipped before them
+  std::mt19937 gen(37);
+  std::uniform_real_distribution<float> dis(0.001f, 0.999f);
+  std::vector<std::array<float, 3>> xyzset(200);
+  for (auto& p : xyzset) p = {dis(gen), dis(gen), dis(gen)};
+  xyzset[17] = {0.5f, 0.5f, 1.5f};
+  xyzset[18] = {0.5f, 0.5f, -0.7f};
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 2;
+  vtargs["use_recompute"] = true;
+
+  const auto check = [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    auto points = xyzset;
+    struct votess::cells<float> cells;
+    (void)votess::tesellate<int, float>(points, cells, args, 
+                                        votess::device::cpu);
+    auto polypoints = xyzset;
+    struct votess::polyhedra<int, float> poly;
+    (void)votess::tesellate<int, float>(polypoints, poly, args, 
+                                        votess::device::cpu);
+    REQUIRE(points == polypoints);
+    size_t nfailed = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+      CAPTURE(i);
+      const bool outside = points[i][2] < 0.0f || points[i][2] > 1.0f;
+      REQUIRE(std::isnan(cells.volume[i]) == outside);
+      REQUIRE(std::isnan(cells.radius[i]) == outside);
+      REQUIRE(std::isnan(cells.area[i]) == outside);
+      REQUIRE(std::isnan(cells.centroid[i][0]) == outside);
+      REQUIRE((poly.voffs[i + 1] == poly.voffs[i]) == outside);
+      nfailed += outside;
+    }
+    REQUIRE(nfailed == 2);
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs);
+  }
+
+}
+
+TEST_CASE("votess: face of each neighbor pair", "[votess]") {
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 4;
+  vtargs["use_recompute"] = true;
+
+  std::vector<std::vector<int>> vneighbors(512);
+  std::vector<std::vector<double>> vareas(512);
+  auto xyzset = xyzset_generate_voro<float>(512, vtargs, 
+    [&](const int i, double, double, double, voro::voronoicell_neighbor& c) {
+      c.neighbors(vneighbors[i]);
+      c.face_areas(vareas[i]);
+    });
+
+  const auto check = [&](struct votess::vtargs args, 
+                         const votess::device device,
+                         const double min_area) {
+    __internal__suppress_stdout s;
+    struct votess::faces<float> faces;
+    auto dnn = votess::tesellate<int, float>(xyzset, faces, args, device);
+    REQUIRE(faces.area.size() == dnn.list.size());
+    REQUIRE(faces.normal.size() == dnn.list.size());
+
+    size_t j = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      const auto& p = xyzset[i];
+
+      // every face voro++ finds above the threshold is there
+      for (size_t f = 0; f < vneighbors[i].size(); f++) {
+        if (vneighbors[i][f] < 0) continue;
+        if (vareas[i][f] < std::max(2 * min_area, 1e-8)) continue;
+        CAPTURE(vneighbors[i][f], vareas[i][f]);
+        bool found = false;
+        for (size_t n = 0; n < dnn[i].size(); n++) {
+          found = found || dnn[i][n] == vneighbors[i][f];
+        }
+        REQUIRE(found);
+      }
+
+      for (size_t n = 0; n < dnn[i].size(); n++, j++) {
+        const int q = dnn[i][n];
+        CAPTURE(q);
+        const auto it = std::find(vneighbors[i].begin(), 
+                                  vneighbors[i].end(), q);
+        REQUIRE(it != vneighbors[i].end());
+        const double area = vareas[i][it - vneighbors[i].begin()];
+        REQUIRE_THAT(faces.area[j], 
+                     Catch::Matchers::WithinAbs(area, 1e-3 * area + 1e-6));
+        REQUIRE(faces.area[j] >= min_area);
+
+        // the face lies on the bisector, with its normal along p -> q
+        double d[3], m[3], len = 0, dot = 0, off = 0;
+        for (int a = 0; a < 3; a++) {
+          d[a] = xyzset[q][a] - p[a];
+          m[a] = 0.5 * (xyzset[q][a] + p[a]);
+          len += d[a] * d[a];
+        }
+        len = std::sqrt(len);
+        for (int a = 0; a < 3; a++) {
+          dot += faces.normal[j][a] * d[a] / len;
+          off += (faces.centroid[j][a] - m[a]) * d[a] / len;
+        }
+        REQUIRE_THAT(dot, Catch::Matchers::WithinAbs(1.0, 1e-4));
+        REQUIRE_THAT(off, Catch::Matchers::WithinAbs(0.0, 1e-4));
+      }
+    }
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs, votess::device::cpu, 0.00);
+  }
+  SECTION("[GPU]") {
+    check(vtargs, votess::device::gpu, 0.00);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs, votess::device::cpu, 0.00);
+  }
+  SECTION("[CPU] minimum face area") {
+    vtargs["cc_min_face_area"] = 1e-3;
+    check(vtargs, votess::device::cpu, 1e-3);
+  }
+  SECTION("[GPU] minimum face area") {
+    vtargs["cc_min_face_area"] = 1e-3;
+    check(vtargs, votess::device::gpu, 1e-3);
+  }
+
+}
+
+TEST_CASE("votess: vertices and faces of each cell", "[votess]") {
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 4;
+  vtargs["use_recompute"] = true;
+
+  std::vector<double> vvolume(512);
+  auto xyzset = xyzset_generate_voro<float>(512, vtargs, 
+    [&](const int i, double, double, double, voro::voronoicell_neighbor& c) {
+      vvolume[i] = c.volume();
+    });
+
+  check_cpu_paths(vtargs, [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    struct votess::polyhedra<int, float> poly;
+    auto dnn = votess::tesellate<int, float>(xyzset, poly, args, 
+                                             votess::device::cpu);
+    REQUIRE(poly.voffs.size() == xyzset.size() + 1);
+    REQUIRE(poly.foffs.size() == xyzset.size() + 1);
+    REQUIRE(poly.loffs.size() == poly.foffs.back() + 1);
+
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      const auto& p = xyzset[i];
+      const size_t nvertices = poly.voffs[i + 1] - poly.voffs[i];
+      const size_t nfaces = poly.foffs[i + 1] - poly.foffs[i];
+      REQUIRE(nfaces >= dnn[i].size());
+
+      double volume = 0;
+      size_t nedges = 0;
+      for (size_t f = poly.foffs[i]; f < poly.foffs[i + 1]; f++) {
+        const size_t j = f - poly.foffs[i];
+        REQUIRE(poly.neighbor[f] == (j < dnn[i].size() ? dnn[i][j] : -1));
+
+        // fan the face from its first vertex, which also gives its normal
+        const auto& a = poly.vertices[poly.voffs[i] + poly.loops[poly.loffs[f]]];
+        double n[3] = {0, 0, 0};
+        for (size_t l = poly.loffs[f]; l < poly.loffs[f + 1]; l++) {
+          REQUIRE(poly.loops[l] >= 0);
+          REQUIRE(size_t(poly.loops[l]) < nvertices);
+          const size_t m = l + 1 < poly.loffs[f + 1] ? l + 1 : poly.loffs[f];
+          const auto& u = poly.vertices[poly.voffs[i] + poly.loops[l]];
+          const auto& w = poly.vertices[poly.voffs[i] + poly.loops[m]];
+          double du[3], dw[3];
+          for (int d = 0; d < 3; d++) {
+            du[d] = u[d] - a[d];
+            dw[d] = w[d] - a[d];
+          }
+          n[0] += du[1] * dw[2] - du[2] * dw[1];
+          n[1] += du[2] * dw[0] - du[0] * dw[2];
+          n[2] += du[0] * dw[1] - du[1] * dw[0];
+        }
+        nedges += poly.loffs[f + 1] - poly.loffs[f];
+        volume += ((a[0] - p[0]) * n[0] + 
+                   (a[1] - p[1]) * n[1] + 
+                   (a[2] - p[2]) * n[2]) / 6.0;
+
+        // counterclockwise seen from outside, i.e. facing the neighbor
+        const int q = poly.neighbor[f];
+        if (q < 0) continue;
+        double dot = 0;
+        for (int d = 0; d < 3; d++) dot += n[d] * (xyzset[q][d] - p[d]);
+        REQUIRE(dot > 0);
+      }
+
+      // every edge is shared by two faces, and the cell is a polyhedron
+      REQUIRE(nedges % 2 == 0);
+      REQUIRE(int(nvertices) - int(nedges / 2) + int(nfaces) == 2);
+      REQUIRE_THAT(volume, Catch::Matchers::WithinRel(vvolume[i], 1e-3));
+    }
+  });
+
+}
+
+TEST_CASE("votess: periodic boundaries", "[votess]") {
+
+  std::mt19937 gen(41);
+  std::uniform_real_distribution<double> dis(0.001, 0.999);
+  std::vector<std::array<double, 3>> xyzset(512);
+  for (auto& p : xyzset) p = {dis(gen), dis(gen), dis(gen)};
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 4;
+  vtargs["use_recompute"] = true;
+  vtargs["cc_min_face_area"] = 1e-10;
+
+  (void)xyzset::sort<int,double>(xyzset, vtargs.get_xyzset());
+
+  // the 27 images of the set, scaled back into the unit box. The cells of
+  // the central images are those of the periodic set, scaled by a third.
+  // There are enough points for no cell to reach a quarter of the box, past
+  // which the nearest images of the neighbors are not enough.
+  std::vector<std::array<double, 3>> ghosts;
+  for (int z = 0; z < 3; z++) {
+  for (int y = 0; y < 3; y++) {
+  for (int x = 0; x < 3; x++) {
+    for (const auto& p : xyzset) {
+      ghosts.push_back({(p[0] + x) / 3, (p[1] + y) / 3, (p[2] + z) / 3});
+    }
+  }}}
+
+  struct votess::vtargs gargs;
+  gargs["k"] = 16;
+  gargs["knn_grid_resolution"] = 12;
+  gargs["use_recompute"] = true;
+  gargs["cc_min_face_area"] = 1e-10 / 9;
+  (void)xyzset::sort<int,double>(ghosts, gargs.get_xyzset());
+
+  struct votess::cells<double> gcells;
+  std::vector<size_t> gnn(xyzset.size());
+  std::vector<size_t> image(xyzset.size());
+  {
+    __internal__suppress_stdout s;
+    auto dnn = votess::tesellate<int, double>(ghosts, gcells, gargs,
+                                             votess::device::cpu);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      double best = 1;
+      for (size_t g = 0; g < ghosts.size(); g++) {
+        const double pq = xyzset::get_distance<double>(
+          3 * ghosts[g][0] - 1, 3 * ghosts[g][1] - 1, 3 * ghosts[g][2] - 1,
+          xyzset[i][0], xyzset[i][1], xyzset[i][2]
+        );
+        if (pq < best) {
+          best = pq;
+          image[i] = g;
+        }
+      }
+      gnn[i] = dnn[image[i]].size();
+    }
+  }
+
+  const auto check = [&](struct votess::vtargs args,
+                         const votess::device device) {
+    __internal__suppress_stdout s;
+    args["use_periodic"] = true;
+    struct votess::cells<double> cells;
+    auto dnn = votess::tesellate<int, double>(xyzset, cells, args, device);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() == gnn[i]);
+    }
+    if (device != votess::device::cpu) return;
+    double total = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      using Catch::Matchers::WithinRel;
+      using Catch::Matchers::WithinAbs;
+      const size_t g = image[i];
+      REQUIRE_THAT(cells.volume[i], WithinRel(27 * gcells.volume[g], 1e-6));
+      for (int d = 0; d < 3; d++) {
+        REQUIRE_THAT(cells.centroid[i][d], 
+                     WithinAbs(3 * gcells.centroid[g][d] - 1, 1e-6));
+      }
+      total += cells.volume[i];
+    }
+    REQUIRE_THAT(total, Catch::Matchers::WithinRel(1.0, 1e-6));
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [radius recompute]") {
+    vtargs["k"] = 8;
+    vtargs["use_radius_recompute"] = true;
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[GPU]") {
+    check(vtargs, votess::device::gpu);
+  }
+
+}
+
+TEST_CASE("votess: cells in a non-cubic box", "[votess]") {
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+  vtargs["box_xmin"] = -1.0;
+  vtargs["box_xmax"] = 1.0;
+  vtargs["box_ymin"] = 0.0;
+  vtargs["box_ymax"] = 1.0;
+  vtargs["box_zmin"] = 3.0;
+  vtargs["box_zmax"] = 4.0;
+  const auto box = vtargs.get_box();
+
+  std::mt19937 gen(17);
+  std::vector<std::array<double, 3>> xyzset(512);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) {
+      std::uniform_real_distribution<double> dis(box.lo[c] + 1e-3, 
+                                                 box.hi[c] - 1e-3);
+      p[c] = dis(gen);
+    }
+  }
+
+  (void)xyzset::sort<int,double>(xyzset, vtargs.get_xyzset());
+
+  using namespace voro;
+  container con(-1, 1, 0, 1, 3, 4, 8, 4, 4, false, false, false, 
+                xyzset.size());
+  for (size_t i = 0; i < xyzset.size(); i++) {
+    con.put(i, xyzset[i][0], xyzset[i][1], xyzset[i][2]);
+  }
+
+  std::vector<double> vvolume(xyzset.size());
+  c_loop_all cl(con);
+  voronoicell_neighbor c;
+  if (cl.start()) do if (con.compute_cell(c, cl)) {
+    vvolume[cl.pid()] = c.volume();
+  } while (cl.inc());
+
+  const auto check = [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    struct votess::cells<double> cells;
+    (void)votess::tesellate<int, double>(xyzset, cells, args, 
+                                         votess::device::cpu);
+    double total = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      if (!args["use_periodic"].get<bool>()) {
+        REQUIRE_THAT(cells.volume[i], 
+                     Catch::Matchers::WithinRel(vvolume[i], 1e-6));
+      }
+      total += cells.volume[i];
+    }
+    REQUIRE_THAT(total, Catch::Matchers::WithinRel(2.0, 1e-6));
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs);
+  }
+  SECTION("[CPU] [periodic]") {
+    vtargs["use_periodic"] = true;
+    check(vtargs);
+  }
+  SECTION("[GPU]") {
+    __internal__suppress_stdout s;
+    auto dnn = votess::tesellate<int, double>(xyzset, vtargs, 
+                                              votess::device::gpu);
+    auto cpu = votess::tesellate<int, double>(xyzset, vtargs, 
+                                              votess::device::cpu);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() == cpu[i].size());
+    }
+  }
+
+}
+
+TEST_CASE("votess: cells cut by walls", "[votess]") {
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+
+  // a 12 sided prism around the z axis, standing on z = 0.1
+  const int n = 12;
+  const double r = 0.4;
+  votess::planes_t walls;
+  for (int j = 0; j < n; j++) {
+    const double t = 2 * M_PI * j / n;
+    walls.push_back({-std::cos(t), -std::sin(t), 0, 
+                     r + 0.5 * std::cos(t) + 0.5 * std::sin(t)});
+  }
+  walls.push_back({0, 0, 1, -0.1});
+  vtargs["walls"] = walls;
+  const double volume = n * r * r * std::tan(M_PI / n) * 0.9;
+
+  const auto inside = [&](const double x, const double y, const double z,
+                          const double eps) {
+    for (const auto& w : walls) {
+      if (w[0] * x + w[1] * y + w[2] * z + w[3] < eps) return false;
+    }
+    return true;
+  };
+
+  std::mt19937 gen(23);
+  std::uniform_real_distribution<double> dis(0.001, 0.999);
+  std::vector<std::array<double, 3>> xyzset;
+  while (xyzset.size() < 512) {
+    const std::array<double, 3> p = {dis(gen), dis(gen), dis(gen)};
+    if (inside(p[0], p[1], p[2], 1e-3)) xyzset.push_back(p);
+  }
+
+  const auto check = [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    struct votess::cells<double> cells;
+    (void)votess::tesellate<int, double>(xyzset, cells, args, 
+                                         votess::device::cpu);
+    double total = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(cells.volume[i] > 0.0);
+      const auto& c = cells.centroid[i];
+      REQUIRE(inside(c[0], c[1], c[2], 0.0));
+      total += cells.volume[i];
+    }
+    REQUIRE_THAT(total, Catch::Matchers::WithinRel(volume, 1e-6));
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs);
+  }
+  SECTION("[GPU]") {
+    __internal__suppress_stdout s;
+    auto dnn = votess::tesellate<int, double>(xyzset, vtargs, 
+                                              votess::device::gpu);
+    auto cpu = votess::tesellate<int, double>(xyzset, vtargs, 
+                                              votess::device::cpu);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() == cpu[i].size());
+    }
+  }
+  SECTION("[CPU] walls along the box") {
+    // the same cells as a box with these faces
+    __internal__suppress_stdout s;
+    for (auto& p : xyzset) {
+      p[0] = 0.25 + 0.75 * p[0];
+      p[1] = 0.75 * p[1];
+    }
+    vtargs["walls"] = "1 0 0 -0.25  0 -1 0 0.75";
+    struct votess::cells<double> cells;
+    (void)votess::tesellate<int, double>(xyzset, cells, vtargs, 
+                                         votess::device::cpu);
+    struct votess::vtargs bargs = vtargs;
+    bargs["walls"] = "";
+    bargs["box_xmin"] = 0.25;
+    bargs["box_ymax"] = 0.75;
+    struct votess::cells<double> bcells;
+    (void)votess::tesellate<int, double>(xyzset, bcells, bargs, 
+                                         votess::device::cpu);
+    std::sort(cells.volume.begin(), cells.volume.end());
+    std::sort(bcells.volume.begin(), bcells.volume.end());
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE_THAT(cells.volume[i], 
+                   Catch::Matchers::WithinRel(bcells.volume[i], 1e-9));
+    }
+  }
+
+}
+
+TEST_CASE("votess: cells bounded by a maximum radius", "[votess]") {
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 16;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+
+  // a dense corner and a few points out in the void
+  std::mt19937 gen(31);
+  std::uniform_real_distribution<double> dis(0.001, 0.299);
+  std::vector<std::array<double, 3>> xyzset(500);
+  for (auto& p : xyzset) p = {dis(gen), dis(gen), dis(gen)};
+  xyzset.push_back({0.9, 0.9, 0.9});
+  xyzset.push_back({0.9, 0.1, 0.6});
+  xyzset.push_back({0.5, 0.8, 0.2});
+
+  const double max_radius = 0.05;
+  const double cube = 8 * max_radius * max_radius * max_radius;
+
+  struct votess::cells<double> free;
+  {
+    __internal__suppress_stdout s;
+    (void)votess::tesellate<int, double>(xyzset, free, vtargs, 
+                                         votess::device::cpu);
+  }
+
+  vtargs["max_radius"] = max_radius;
+
+  const auto check = [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    struct votess::cells<double> cells;
+    auto dnn = votess::tesellate<int, double>(xyzset, cells, args, 
+                                              votess::device::cpu);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(cells.radius[i] <= 3 * max_radius * max_radius * (1 + 1e-9));
+      REQUIRE(cells.volume[i] <= cube * (1 + 1e-9));
+      if (free.radius[i] < max_radius * max_radius) {
+        REQUIRE_THAT(cells.volume[i], 
+                     Catch::Matchers::WithinRel(free.volume[i], 1e-9));
+      } else {
+        REQUIRE(cells.volume[i] <= free.volume[i] * (1 + 1e-9));
+      }
+      // the points out in the void are alone in their cube
+      if (xyzset[i][0] > 0.4 || xyzset[i][1] > 0.4 || xyzset[i][2] > 0.4) {
+        REQUIRE(dnn[i].size() == 0);
+        REQUIRE_THAT(cells.volume[i], Catch::Matchers::WithinRel(cube, 1e-9));
+      }
+    }
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs);
+  }
+  SECTION("[GPU]") {
+    __internal__suppress_stdout s;
+    auto dnn = votess::tesellate<int, double>(xyzset, vtargs, 
+                                              votess::device::gpu);
+    auto cpu = votess::tesellate<int, double>(xyzset, vtargs, 
+                                              votess::device::cpu);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() == cpu[i].size());
+    }
+  }
+
+}
+
+TEST_CASE("votess: doubtful float cells rerun in double", "[votess]") {
+
+  // a lattice shaken far below the spacing, so that most vertices of a cell
+  // are shared with its neighbors up to the rounding of float
+  std::mt19937 gen(37);
+  std::uniform_real_distribution<double> dis(-1e-7, 1e-7);
+  const int n = 10;
+  std::vector<std::array<float, 3>> xyzset;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      for (int l = 0; l < n; l++) {
+        xyzset.push_back({static_cast<float>((i + 0.5) / n + dis(gen)),
+                          static_cast<float>((j + 0.5) / n + dis(gen)),
+                          static_cast<float>((l + 0.5) / n + dis(gen))});
+      }
+    }
+  }
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+
+  (void)xyzset::sort<int,float>(xyzset, vtargs.get_xyzset());
+
+  std::vector<std::array<double, 3>> xyzset_d;
+  for (const auto& p : xyzset) xyzset_d.push_back({p[0], p[1], p[2]});
+  struct votess::cells<double> expected;
+  {
+    __internal__suppress_stdout s;
+    (void)votess::tesellate<int, double>(xyzset_d, expected, vtargs, 
+                                         votess::device::cpu);
+  }
+
+  vtargs["use_precision_retry"] = true;
+
+  const auto check = [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    struct votess::cells<float> cells;
+    (void)votess::tesellate<int, float>(xyzset, cells, args, 
+                                        votess::device::cpu);
+    double total = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE_THAT(cells.volume[i], 
+                   Catch::Matchers::WithinRel(expected.volume[i], 1e-5));
+      total += cells.volume[i];
+    }
+    REQUIRE_THAT(total, Catch::Matchers::WithinRel(1.0, 1e-5));
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs);
+  }
+  SECTION("[GPU]") {
+    // cells the kernels are sure of are reported as NaN
+    __internal__suppress_stdout s;
+    struct votess::cells<float> cells;
+    (void)votess::tesellate<int, float>(xyzset, cells, vtargs, 
+                                        votess::device::gpu);
+    size_t nrerun = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      if (std::isnan(cells.volume[i])) continue;
+      REQUIRE_THAT(cells.volume[i], 
+                   Catch::Matchers::WithinRel(expected.volume[i], 1e-5));
+      nrerun++;
+    }
+    REQUIRE(nrerun > 0);
+  }
+
+}
+
+TEST_CASE("votess: cells clipped around their point", "[votess]") {
+
+  // a box far from the origin, where float has few bits left for the cells
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+  vtargs["box_xmin"] = 100.0;
+  vtargs["box_xmax"] = 101.0;
+  vtargs["box_ymin"] = 100.0;
+  vtargs["box_ymax"] = 101.0;
+  vtargs["box_zmin"] = 100.0;
+  vtargs["box_zmax"] = 101.0;
+
+  std::mt19937 gen(41);
+  std::uniform_real_distribution<double> dis(100.001, 100.999);
+  std::vector<std::array<float, 3>> xyzset(1000);
+  for (auto& p : xyzset) {
+    p = {static_cast<float>(dis(gen)), static_cast<float>(dis(gen)), 
+         static_cast<float>(dis(gen))};
+  }
+
+  (void)xyzset::sort<int,float>(xyzset, vtargs.get_xyzset());
+
+  std::vector<std::array<double, 3>> xyzset_d;
+  for (const auto& p : xyzset) xyzset_d.push_back({p[0], p[1], p[2]});
+  struct votess::cells<double> expected;
+  struct votess::faces<double> expected_faces;
+  auto expected_dnn = [&]() {
+    __internal__suppress_stdout s;
+    return votess::tesellate<int, double>(xyzset_d, expected, expected_faces, 
+                                          vtargs, votess::device::cpu);
+  }();
+
+  vtargs["use_recentering"] = true;
+
+  const auto check = [&](struct votess::vtargs args) {
+    __internal__suppress_stdout s;
+    struct votess::cells<float> cells;
+    (void)votess::tesellate<int, float>(xyzset, cells, args, 
+                                        votess::device::cpu);
+    double total = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE_THAT(cells.volume[i], 
+                   Catch::Matchers::WithinRel(expected.volume[i], 1e-4));
+      for (int c = 0; c < 3; c++) {
+        REQUIRE_THAT(cells.centroid[i][c], 
+                     Catch::Matchers::WithinAbs(expected.centroid[i][c], 1e-4));
+      }
+      total += cells.volume[i];
+    }
+    REQUIRE_THAT(total, Catch::Matchers::WithinRel(1.0, 1e-4));
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs);
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs);
+  }
+  SECTION("[CPU] [polyhedra]") {
+    __internal__suppress_stdout s;
+    struct votess::polyhedra<int, float> poly;
+    (void)votess::tesellate<int, float>(xyzset, poly, vtargs, 
+                                        votess::device::cpu);
+    REQUIRE(!poly.vertices.empty());
+    for (const auto& v : poly.vertices) {
+      for (int c = 0; c < 3; c++) {
+        REQUIRE(v[c] >= 100.0f - 1e-4f);
+        REQUIRE(v[c] <= 101.0f + 1e-4f);
+      }
+    }
+  }
+  SECTION("[GPU]") {
+    __internal__suppress_stdout s;
+    struct votess::faces<float> faces;
+    auto dnn = votess::tesellate<int, float>(xyzset, faces, vtargs, 
+                                             votess::device::gpu);
+    size_t f = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() == expected_dnn[i].size());
+      for (size_t j = 0; j < dnn[i].size(); j++, f++) {
+        REQUIRE(dnn[i][j] == expected_dnn[i][j]);
+        for (int c = 0; c < 3; c++) {
+          REQUIRE_THAT(faces.centroid[f][c], Catch::Matchers::WithinAbs(
+                       expected_faces.centroid[f][c], 1e-4));
+        }
+      }
+    }
+  }
+
+}
+
+TEST_CASE("votess: lattice ties broken by index", "[votess]") {
+
+  // the lattice spacing is not exact in float, so every tie between a vertex
+  // and a bisector goes either way up to rounding
+  const int n = 10;
+  std::vector<std::array<float, 3>> xyzset;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      for (int l = 0; l < n; l++) {
+        xyzset.push_back({static_cast<float>((i + 0.5) / n),
+                          static_cast<float>((j + 0.5) / n),
+                          static_cast<float>((l + 0.5) / n)});
+      }
+    }
+  }
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+  vtargs["use_perturbation"] = true;
+
+  (void)xyzset::sort<int,float>(xyzset, vtargs.get_xyzset());
+
+  // neighbors are found from both sides, and ties only add faces of no area
+  const auto check = [&](struct votess::vtargs args, 
+                         const enum votess::device device) {
+    __internal__suppress_stdout s;
+    auto dnn = votess::tesellate<int, float>(xyzset, args, device);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() >= 3);
+      REQUIRE(dnn[i].size() <= 14);
+      for (size_t j = 0; j < dnn[i].size(); j++) {
+        const int q = dnn[i][j];
+        CAPTURE(q);
+        bool found = false;
+        for (size_t m = 0; m < dnn[q].size(); m++) {
+          found = found || dnn[q][m] == static_cast<int>(i);
+        }
+        REQUIRE(found);
+      }
+    }
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs, votess::device::cpu);
+    __internal__suppress_stdout s;
+    struct votess::cells<float> cells;
+    (void)votess::tesellate<int, float>(xyzset, cells, vtargs, 
+                                        votess::device::cpu);
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      CAPTURE(i);
+      REQUIRE_THAT(cells.volume[i], Catch::Matchers::WithinRel(1e-3, 1e-4));
+    }
+  }
+  SECTION("[CPU] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [radius]") {
+    vtargs["k"] = 16;
+    vtargs["use_radius_recompute"] = true;
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[GPU]") {
+    check(vtargs, votess::device::gpu);
+  }
+
+}
+
+TEST_CASE("votess: coincident points merged", "[votess]") {
+
+  const int size = 500;
+  const float tolerance = 1e-5f;
+
+  std::mt19937 gen(23);
+  std::uniform_real_distribution<float> dis(0.1f, 0.9f);
+  std::uniform_real_distribution<float> jitter(-2e-6f, 2e-6f);
+  std::vector<std::array<float, 3>> xyzset(size);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) p[c] = dis(gen);
+  }
+  for (int n = 0; n < 60; n++) {
+    auto p = xyzset[3 * n];
+    if (n % 2) for (int c = 0; c < 3; c++) p[c] += jitter(gen);
+    xyzset.push_back(p);
+  }
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 6;
+  vtargs["use_recompute"] = true;
+  vtargs["duplicate_tolerance"] = tolerance;
+
+  SECTION("[CPU] [check]") {
+    vtargs["use_duplicate_check"] = true;
+    __internal__suppress_stdout s;
+    auto dnn = votess::tesellate<int, float>(xyzset, vtargs, 
+                                             votess::device::cpu);
+    REQUIRE(dnn.size() == xyzset.size());
+    REQUIRE(dnn.alias.size() == xyzset.size());
+    int nduplicates = 0;
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      nduplicates += dnn.alias[i] != static_cast<int>(i);
+    }
+    REQUIRE(nduplicates == 60);
+  }
+
+  // the points kept tessellate as if the others were never there
+  const auto check = [&](struct votess::vtargs args,
+                         const enum votess::device device) {
+    args["use_duplicate_merge"] = true;
+    __internal__suppress_stdout s;
+
+    auto merged = xyzset;
+    struct votess::cells<float> cells;
+    auto dnn = votess::tesellate<int, float>(merged, cells, args, device);
+    REQUIRE(merged.size() == xyzset.size());
+    REQUIRE(dnn.size() == xyzset.size());
+    REQUIRE(dnn.alias.size() == xyzset.size());
+
+    const size_t nunique = size;
+    for (size_t i = 0; i < merged.size(); i++) {
+      CAPTURE(i);
+      const auto& p = merged[i];
+      const auto& q = merged[dnn.alias[i]];
+      REQUIRE((dnn.alias[i] == static_cast<int>(i)) == (i < nunique));
+      REQUIRE(std::abs(p[0] - q[0]) <= tolerance);
+      REQUIRE(std::abs(p[1] - q[1]) <= tolerance);
+      REQUIRE(std::abs(p[2] - q[2]) <= tolerance);
+      if (i >= nunique) REQUIRE(dnn[i].size() == 0);
+    }
+
+    std::vector<std::array<float, 3>> unique(merged.begin(), 
+                                             merged.begin() + nunique);
+    auto args_unique = args;
+    args_unique["use_duplicate_merge"] = false;
+    auto expected = votess::tesellate<int, float>(unique, args_unique, 
+                                                  votess::device::cpu);
+    REQUIRE(unique == std::vector<std::array<float, 3>>(
+                         merged.begin(), merged.begin() + nunique));
+    for (size_t i = 0; i < nunique; i++) {
+      CAPTURE(i);
+      REQUIRE(dnn[i].size() == expected[i].size());
+      for (size_t j = 0; j < dnn[i].size(); j++) {
+        REQUIRE(dnn[i][j] == expected[i][j]);
+      }
+    }
+
+    if (device == votess::device::cpu) {
+      REQUIRE(cells.volume.size() == xyzset.size());
+      float volume = 0.0f;
+      for (size_t i = 0; i < nunique; i++) volume += cells.volume[i];
+      REQUIRE_THAT(volume, Catch::Matchers::WithinRel(1.0f, 1e-4f));
+      for (size_t i = nunique; i < merged.size(); i++) {
+        REQUIRE(std::isnan(cells.volume[i]));
+      }
+    }
+  };
+
+  SECTION("[CPU] [merge]") {
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [merge] [stream]") {
+    vtargs["use_knn_stream"] = true;
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[GPU] [merge]") {
+    check(vtargs, votess::device::gpu);
+  }
+
+}
+
+TEST_CASE("votess: int64 indices", "[votess]") {
+
+  std::mt19937 gen(29);
+  std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+  std::vector<std::array<float, 3>> xyzset(2000);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) p[c] = dis(gen);
+  }
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+
+  static_assert(std::is_same<decltype(votess::dnn<int>::offs), 
+                             std::vector<size_t>>::value,
+                "dnn offsets must not depend on the index type");
+
+  // the same cells come out whatever the index type
+  const auto check = [&](struct votess::vtargs args, 
+                         const enum votess::device device) {
+    __internal__suppress_stdout s;
+    auto xyzset_i = xyzset;
+    auto xyzset_l = xyzset;
+    auto dnn_i = votess::tesellate<int, float>(xyzset_i, args, device);
+    auto dnn_l = votess::tesellate<int64_t, float>(xyzset_l, args, device);
+    REQUIRE(xyzset_i == xyzset_l);
+    REQUIRE(dnn_i.offs == dnn_l.offs);
+    REQUIRE(dnn_i.list.size() == dnn_l.list.size());
+    for (size_t j = 0; j < dnn_i.list.size(); j++) {
+      REQUIRE(static_cast<int64_t>(dnn_i.list[j]) == dnn_l.list[j]);
+    }
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [chunking]") {
+    vtargs["use_chunking"] = true;
+    vtargs["chunksize"] = 300;
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[GPU]") {
+    check(vtargs, votess::device::gpu);
+  }
+  SECTION("[GPU] [faces]") {
+    __internal__suppress_stdout s;
+    auto xyzset_i = xyzset;
+    auto xyzset_l = xyzset;
+    struct votess::cells<float> cells_i, cells_l;
+    struct votess::faces<float> faces_i, faces_l;
+    auto dnn_i = votess::tesellate<int, float>(xyzset_i, cells_i, faces_i, 
+                                               vtargs, votess::device::gpu);
+    auto dnn_l = votess::tesellate<int64_t, float>(xyzset_l, cells_l, faces_l,
+                                                   vtargs, 
+                                                   votess::device::gpu);
+    REQUIRE(dnn_i.offs == dnn_l.offs);
+    REQUIRE(faces_i.area.size() == faces_l.area.size());
+    for (size_t j = 0; j < faces_i.area.size(); j++) {
+      REQUIRE(faces_i.area[j] == faces_l.area[j]);
+    }
+  }
+
+}
+
+TEST_CASE("votess: double precision entry points", "[votess]") {
+
+  std::mt19937 gen(31);
+  std::uniform_real_distribution<double> dis(0.0, 1.0);
+  std::vector<std::array<double, 3>> xyzset(2000);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) p[c] = static_cast<float>(dis(gen));
+  }
+  std::vector<std::array<float, 3>> xyzset_f(xyzset.size());
+  for (size_t i = 0; i < xyzset.size(); i++) {
+    for (int c = 0; c < 3; c++) xyzset_f[i][c] = xyzset[i][c];
+  }
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 8;
+  vtargs["use_recompute"] = true;
+
+  // <int, double> and <int64_t, double> give the same cells, and the same
+  // neighbors as <int, float> on points exactly representable in float
+  const auto check = [&](const enum votess::device device) {
+    __internal__suppress_stdout s;
+    auto xyzset_i = xyzset;
+    auto xyzset_l = xyzset;
+    auto xyzset_ff = xyzset_f;
+    auto dnn_i = votess::tesellate<int, double>(xyzset_i, vtargs, device);
+    auto dnn_l = votess::tesellate<int64_t, double>(xyzset_l, vtargs, device);
+    auto dnn_f = votess::tesellate<int, float>(xyzset_ff, vtargs, device);
+    REQUIRE(xyzset_i == xyzset_l);
+    REQUIRE(dnn_i.offs == dnn_l.offs);
+    for (size_t j = 0; j < dnn_i.list.size(); j++) {
+      REQUIRE(static_cast<int64_t>(dnn_i.list[j]) == dnn_l.list[j]);
+    }
+    REQUIRE(dnn_i.size() == dnn_f.size());
+    for (size_t i = 0; i < xyzset_i.size(); i++) {
+      for (int c = 0; c < 3; c++) {
+        REQUIRE(static_cast<float>(xyzset_i[i][c]) == xyzset_ff[i][c]);
+      }
+      std::vector<int> row_d, row_f;
+      for (size_t j = 0; j < dnn_i[i].size(); j++) row_d.push_back(dnn_i[i][j]);
+      for (size_t j = 0; j < dnn_f[i].size(); j++) row_f.push_back(dnn_f[i][j]);
+      std::sort(row_d.begin(), row_d.end());
+      std::sort(row_f.begin(), row_f.end());
+      REQUIRE(row_d == row_f);
+    }
+  };
+
+  SECTION("[CPU]") {
+    check(votess::device::cpu);
+  }
+  SECTION("[GPU]") {
+    check(votess::device::gpu);
+  }
+
+}
+
+#include <cstring>
+TEST_CASE("votess: points in caller-owned memory", "[votess]") {
+
+  std::mt19937 gen(50);
+  std::uniform_real_distribution<float> dis(0.1f, 0.9f);
+  std::vector<std::array<float, 3>> xyzset(1000);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) p[c] = dis(gen);
+  }
+  for (int n = 0; n < 20; n++) xyzset.push_back(xyzset[5 * n]);
+
+  struct votess::vtargs vtargs;
+  vtargs["k"] = 32;
+  vtargs["knn_grid_resolution"] = 6;
+  vtargs["use_recompute"] = true;
+
+  // a flat buffer as numpy would hold it, sorted in place to the same order
+  // and tessellated to the same cells as a vector
+  const auto check = [&](struct votess::vtargs args,
+                         const enum votess::device device) {
+    __internal__suppress_stdout s;
+    auto expected_xyzset = xyzset;
+    auto expected = votess::tesellate<int, float>(expected_xyzset, args, 
+                                                  device);
+
+    std::vector<float> buffer(3 * xyzset.size());
+    std::memcpy(buffer.data(), xyzset.data(), buffer.size() * sizeof(float));
+    auto* points = reinterpret_cast<std::array<float, 3>*>(buffer.data());
+    auto dnn = votess::tesellate<int, float>(points, xyzset.size(), args, 
+                                             device);
+
+    for (size_t i = 0; i < xyzset.size(); i++) {
+      REQUIRE(points[i] == expected_xyzset[i]);
+    }
+    REQUIRE(dnn.offs == expected.offs);
+    REQUIRE(dnn.list == expected.list);
+    REQUIRE(dnn.alias == expected.alias);
+  };
+
+  SECTION("[CPU]") {
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[CPU] [merge]") {
+    vtargs["use_duplicate_merge"] = true;
+    check(vtargs, votess::device::cpu);
+  }
+  SECTION("[GPU]") {
+    check(vtargs, votess::device::gpu);
+  }
+
+}
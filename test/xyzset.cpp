@@ -8,6 +8,7 @@
 #include <cmath>
 #include <random>
 #include <limits>
+#include <algorithm>
 
 template <typename Ti, typename Tf>
 static void test_xyzset(
@@ -285,6 +286,158 @@ TEST_CASE("xyzset regression 8: Random Points - double", "[xyzset]") {
   test_xyzset<int, double>(xyzset, k, gr_max);
 }
 
+TEST_CASE("xyzset: sort in a non-cubic box", "[xyzset]") {
+
+  votess::vtargs args;
+  args["knn_grid_resolution"] = 16;
+  args["box_xmin"] = -2.0;
+  args["box_xmax"] = 6.0;
+  args["box_ymin"] = 0.0;
+  args["box_ymax"] = 1.0;
+  args["box_zmin"] = 10.0;
+  args["box_zmax"] = 12.0;
+
+  const auto box = args.get_box();
+  REQUIRE(box.gr[0] == 16);
+  REQUIRE(box.gr[1] == 2);
+  REQUIRE(box.gr[2] == 4);
+
+  std::mt19937 gen(5);
+  std::vector<std::array<double, 3>> xyzset(500);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) {
+      std::uniform_real_distribution<double> dis(box.lo[c], box.hi[c]);
+      p[c] = dis(gen);
+    }
+  }
+  REQUIRE(xyzset::validate_xyzset<double>(xyzset, box) == true);
+  REQUIRE(xyzset::validate_xyzset<double>(xyzset) == false);
+
+  auto [id, offset] = xyzset::sort<int, double>(xyzset, args.get_xyzset());
+
+  REQUIRE(xyzset::validate_id<int>(id) == true);
+  REQUIRE(offset.size() == 16 * 2 * 4 + 1);
+  REQUIRE(offset.back() == 500);
+  for (size_t i = 0; i < xyzset.size(); i++) {
+    CAPTURE(i);
+    int cell[3];
+    for (int c = 0; c < 3; c++) {
+      cell[c] = static_cast<int>((xyzset[i][c] - box.lo[c]) / box.cell(c));
+    }
+    REQUIRE(id[i] == cell[0] + 16 * cell[1] + 16 * 2 * cell[2]);
+    REQUIRE(offset[id[i]] <= static_cast<int>(i));
+    REQUIRE(offset[id[i] + 1] > static_cast<int>(i));
+  }
+
+}
+
+TEST_CASE("xyzset: duplicates and merge", "[xyzset]") {
+
+  const double tolerance = 1e-3;
+
+  // points close to another one, some across a face of the grid or the box
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<double> dis(0.0, 1.0);
+  std::uniform_real_distribution<double> jitter(-0.4 * tolerance,
+                                                 0.4 * tolerance);
+  std::vector<std::array<double, 3>> xyzset(400);
+  for (auto& p : xyzset) {
+    for (int c = 0; c < 3; c++) p[c] = dis(gen);
+  }
+  for (int n = 0; n < 100; n++) {
+    auto p = xyzset[n];
+    if (n % 2) for (int c = 0; c < 3; c++) p[c] += jitter(gen);
+    xyzset.push_back(p);
+  }
+  xyzset.push_back({0.25 - 0.2 * tolerance, 0.5, 0.5});
+  xyzset.push_back({0.25 + 0.2 * tolerance, 0.5, 0.5});
+  xyzset.push_back({0.2 * tolerance, 0.5, 0.5});
+  xyzset.push_back({1.0 - 0.2 * tolerance, 0.5, 0.5});
+
+  for (const bool periodic : {false, true}) {
+    for (const double tol : {0.0, tolerance}) {
+
+      SECTION("case: periodic = " + std::to_string(periodic) + 
+              ", tolerance = " + std::to_string(tol)) {
+
+        votess::vtargs args;
+        args["knn_grid_resolution"] = 4;
+        args["use_periodic"] = periodic;
+
+        auto sorted = xyzset;
+        auto [id, offset] = xyzset::sort<int, double>(sorted, 
+                                                      args.get_xyzset());
+        auto alias = xyzset::duplicates<int, double>(sorted, offset, 
+                                                     args.get_knn(), tol, 3);
+
+        // lowest point within the tolerance, through a chain of others
+        const size_t size = sorted.size();
+        std::vector<int> expected(size);
+        for (size_t i = 0; i < size; i++) {
+          expected[i] = i;
+          for (size_t j = 0; j < i; j++) {
+            double d = 0.0;
+            for (int c = 0; c < 3; c++) {
+              double dc = std::abs(sorted[i][c] - sorted[j][c]);
+              if (periodic) dc = std::min(dc, 1.0 - dc);
+              d += dc * dc;
+            }
+            if (d <= tol * tol) {
+              expected[i] = expected[j];
+              break;
+            }
+          }
+        }
+        REQUIRE(alias == expected);
+
+        size_t nexpected = 0;
+        for (size_t i = 0; i < size; i++) {
+          nexpected += alias[i] == static_cast<int>(i);
+        }
+        if (tol == 0.0) {
+          REQUIRE(nexpected == 454);
+        } else {
+          REQUIRE(nexpected == (periodic ? 402 : 403));
+        }
+
+        const auto unsorted = sorted;
+        const auto unmerged = alias;
+        const size_t nunique = xyzset::merge<int, double>(sorted, id, 
+                                                          offset, alias);
+        REQUIRE(nunique == nexpected);
+        REQUIRE(xyzset::validate_offset<int>(offset) == true);
+        REQUIRE(offset.back() == static_cast<int>(nunique));
+        for (size_t i = 0; i < size; i++) {
+          CAPTURE(i);
+          REQUIRE((alias[i] == static_cast<int>(i)) == (i < nunique));
+          REQUIRE(alias[alias[i]] == alias[i]);
+          if (i < nunique) {
+            REQUIRE(offset[id[i]] <= static_cast<int>(i));
+            REQUIRE(offset[id[i] + 1] > static_cast<int>(i));
+          }
+        }
+        for (size_t i = 1; i < nunique; i++) {
+          REQUIRE(id[i - 1] <= id[i]);
+        }
+        
+        // every point still maps to the same point it was merged into
+        std::vector<size_t> position(size);
+        for (size_t i = 0; i < size; i++) {
+          const auto it = std::find(sorted.begin(), sorted.end(), unsorted[i]);
+          REQUIRE(it != sorted.end());
+          position[i] = it - sorted.begin();
+        }
+        for (size_t i = 0; i < size; i++) {
+          REQUIRE(sorted[alias[position[i]]] == unsorted[unmerged[i]]);
+        }
+
+      }
+
+    }
+  }
+
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #define TEST_XYZSET_USE_ALTER 0